@@ -38,8 +38,14 @@ _gWhisperCompletion()
     fi
 
     # we retrieve completion choices by just executing gWhisper with the
-    # --complete argument in the beginning:
-    SUGGESTIONS=$($COMMANDNAME "--complete $ARGS")
+    # --complete argument in the beginning. If GWHISPER_FUZZY_COMPLETION is
+    # set, --fuzzyComplete also completes names from non-prefix abbreviations:
+    COMPLETE_OPTIONS="--complete"
+    if [ $GWHISPER_FUZZY_COMPLETION ]
+    then
+        COMPLETE_OPTIONS="--complete --fuzzyComplete"
+    fi
+    SUGGESTIONS=$($COMMANDNAME "$COMPLETE_OPTIONS $ARGS")
 
     if [ $GWHISPER_DEBUG_COMPLETION ]
     then
@@ -18,16 +18,25 @@
 #include <libCli/GrammarConstruction.hpp>
 #include <libCli/Call.hpp>
 #include <libCli/Completion.hpp>
+#include <libCli/Snapshot.hpp>
+#include <libCli/Proxy.hpp>
+#include <libCli/Replay.hpp>
+#include <libCli/MockServer.hpp>
+#include <libCli/Shell.hpp>
 #include <versionDefine.h> // generated during build
 
 using namespace ArgParse;
 
-std::string getArgsAsString(int argc, char **argv)
+std::string getArgsAsString(int argc, char **argv, const std::string & f_skippedArg = "")
 {
     std::string result;
     bool first = true;
     for(int i = 1; i<argc; i++)
     {
+        if(argv[i] == f_skippedArg)
+        {
+            continue;
+        }
         if(!first)
         {
             result += " ";
@@ -45,17 +54,10 @@ const char* g_helpString =
 #include <gwhisper/HelpString.h>
 ;
 
-int main(int argc, char **argv)
+/// Acts according to the parse tree of the arguments.
+/// @returns exit code
+int executeCommand(Grammar & grammarPool, ParseRc & rc, ParsedElement & parseTree, const std::string & args)
 {
-    // First we construct the initial Grammar for the CLI tool:
-    Grammar grammarPool;
-    GrammarElement * grammarRoot = cli::constructGrammar(grammarPool);
-
-    // Now we parse the given arguments using the grammar:
-    std::string args = getArgsAsString(argc, argv);
-    ParsedElement parseTree;
-    ParseRc rc = grammarRoot->parse(args.c_str(), parseTree);
-
     // TODO: add option to print parse tree after parsing:
     // // Now we act according to the parse tree:
     //std::cout << parseTree.getDebugString() << "\n";
@@ -85,6 +87,36 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    if(parseTree.findFirstChild("Proxy") != "")
+    {
+        return cli::runProxy(parseTree);
+    }
+
+    if(parseTree.findFirstChild("PrintRecording") != "")
+    {
+        // recordings contain the schema, no server required
+        return cli::printRecording(parseTree);
+    }
+
+    if(parseTree.findFirstChild("ReplayFile") != "")
+    {
+        // only requires the server address, calls are taken from the recording
+        return cli::replayRecording(parseTree);
+    }
+
+    if(parseTree.findFirstChild("ServeAddress") != "")
+    {
+        // the schema is taken from a recording or the server, service and
+        // method are only required for a canned reply
+        return cli::runMockServer(parseTree);
+    }
+
+    if(parseTree.findFirstChild("WriteSnapshot") != "")
+    {
+        // only requires the server address (or a local schema), no service/method
+        return cli::writeSnapshot(parseTree);
+    }
+
     if(rc.isGood() && (rc.lenParsedSuccessfully == args.length()))
     {
         return cli::call(parseTree);
@@ -106,3 +138,23 @@ int main(int argc, char **argv)
 
     return -1;
 }
+
+int main(int argc, char **argv)
+{
+    // First we construct the initial Grammar for the CLI tool:
+    Grammar grammarPool;
+    GrammarElement * grammarRoot = cli::constructGrammar(grammarPool);
+
+    // Now we parse the given arguments using the grammar:
+    std::string args = getArgsAsString(argc, argv);
+    ParsedElement parseTree;
+    ParseRc rc = grammarRoot->parse(args.c_str(), parseTree);
+
+    if(parseTree.findFirstChild("Shell") != "")
+    {
+        // all other arguments are prepended to each command of the shell
+        return cli::runShell(getArgsAsString(argc, argv, "--shell"), executeCommand);
+    }
+
+    return executeCommand(grammarPool, rc, parseTree, args);
+}
@@ -63,20 +63,25 @@ class Alternation : public GrammarElement
 
             std::shared_ptr<ParsedElement> winner;
             std::shared_ptr<ParsedElement> maybeWinner;
-            GrammarElement * maybeWinnerGE;
+            std::vector<GrammarElement *> maybeWinnerGEs;
+            std::vector<ParseRc> maybeWinnerRcs;
             size_t maybeCount = 0;
             size_t newCandidateDepth = candidateDepth;
             if(candidateDepth > 0)
             {
-                // New idea: never allow forks by default.
-                // if we realize in the end, that we are unique, we parse
-                // again, this time allowing forks
+                // Forks are only allowed if we can uniquely select a child.
+                // As this is the common case, we parse with full candidateDepth first
+                // and only parse again with reduced candidateDepth if we realize
+                // that we are not unique.
+                // (Parsing with reduced depth first and parsing again if unique
+                // would double the parse time for each nesting level of
+                // alternations, which is exponential in the input length)
                 newCandidateDepth--;
             }
             for(auto child : m_children)
             {
                 auto newParsedElement = std::make_shared<ParsedElement>(&f_out_ParsedElement);
-                ParseRc childRc = child->parse(f_string, *newParsedElement, newCandidateDepth);
+                ParseRc childRc = child->parse(f_string, *newParsedElement, candidateDepth);
                 //std::cout << " Alternation pass1 "<< std::to_string(m_instanceId) <<  " parsed child ? rc=" << childRc.toString() << " #candidates: " << std::to_string(childRc.candidates.size()) << std::endl;
                 if(childRc.isGood())
                 {
@@ -91,11 +96,31 @@ class Alternation : public GrammarElement
                 }
                 if((not childRc.isGood()) && (childRc.errorType != ParseRc::ErrorType::unexpectedText))
                 {
+                    // this is a candidate for completion
                     maybeWinner = newParsedElement;
-                    maybeWinnerGE = child;
+                    maybeWinnerGEs.push_back(child);
+                    maybeWinnerRcs.push_back(childRc);
                     maybeCount++;
+                }
+            }
 
-                    // this is a candidate for completion
+            if( (winner == nullptr) && (maybeCount == 1) )
+            {
+                // in this case we could uniquely identify a candidate :)
+                // so we can keep the candidates of the full-depth parse
+                candidateList = maybeWinnerRcs[0].candidates;
+            }
+            else
+            {
+                // not unique -> collect candidates again without allowing forks
+                for(size_t i = 0; i < maybeCount; i++)
+                {
+                    ParseRc & childRc = maybeWinnerRcs[i];
+                    if(newCandidateDepth != candidateDepth)
+                    {
+                        ParsedElement unused;
+                        childRc = maybeWinnerGEs[i]->parse(f_string, unused, newCandidateDepth);
+                    }
                     //std::cout << " Alt"<< std::to_string(m_instanceId) <<  "one child rc=" << childRc.toString() << std::endl;
                     for(auto candidate : childRc.candidates)
                     {
@@ -116,13 +141,6 @@ class Alternation : public GrammarElement
                     // we have had enough text to uniquely select one of the alternates
                     // => we can add it to the f_out_ParsedElement:
                     f_out_ParsedElement.addChild(maybeWinner);
-                    // in this case we could uniquely identify a candidate :)
-                    // so we need to parse again for candidates, this time allowing for forks
-                    candidateList.clear();
-                    ParsedElement unused;
-                    ParseRc childRc = maybeWinnerGE->parse(f_string, unused, candidateDepth);
-                    candidateList = childRc.candidates;
-                    //std::cout << " Alternation pass2 "<< std::to_string(m_instanceId) <<  " parsed child ? rc=" << childRc.toString() << " #candidates: " << std::to_string(childRc.candidates.size()) << std::endl;
                 }
 
                 // merge RCs
@@ -46,9 +46,11 @@
 #include <libArgParse/Alternation.hpp>
 #include <libArgParse/Concatenation.hpp>
 #include <libArgParse/FixedString.hpp>
+#include <libArgParse/KeywordSet.hpp>
 #include <libArgParse/Optional.hpp>
 #include <libArgParse/ParsedElement.hpp>
 #include <libArgParse/RegEx.hpp>
+#include <libArgParse/RecursiveReference.hpp>
 #include <libArgParse/Repetition.hpp>
 #include <libArgParse/WhiteSpace.hpp>
 #include <libArgParse/GrammarElement.hpp>
@@ -50,9 +50,16 @@ class FixedString : public GrammarElement
             else
             {
                 rc.lenParsedSuccessfully = 0;
-                if(strncmp(m_string.c_str(), f_string, strlen(f_string)) == 0)
+                // check if the input ends with a prefix of our string (do not
+                // use strlen here, as the input may be long):
+                size_t i = 0;
+                while( (f_string[i] != '\0') and (f_string[i] == m_string[i]) )
                 {
-                    rc.lenParsed = strlen(f_string);
+                    i++;
+                }
+                if(f_string[i] == '\0')
+                {
+                    rc.lenParsed = i;
                     // have a candidate for completion :)
                     //printf(" -> completion possible\n");
                     // create a candidate:
@@ -0,0 +1,270 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cctype>
+
+namespace ArgParse
+{
+
+/// Ranks keywords by how well they match a fuzzy query.
+/// A keyword matches, if the query is a (case insensitive) subsequence of it.
+/// Matches are scored higher if query characters
+///  - are consecutive in the keyword,
+///  - start a segment of the keyword (after '.', '_', '-', '/' or at a camelCase boundary),
+///  - are located in the last dotted segment of the keyword (e.g. the service name without package),
+///  - have the same case.
+/// This way, typing the distinctive tail of a long dotted name (e.g. "FooServ"
+/// for "com.company.team.FooService") or its segment initials ("c.c.t.Foo")
+/// finds the keyword.
+/// All per-keyword data needed for scoring is computed once on construction,
+/// so matching is cheap enough to run on every completion request.
+class FuzzyMatcher
+{
+    public:
+        explicit FuzzyMatcher(const std::vector<std::string> & f_keywords)
+        {
+            m_entries.reserve(f_keywords.size());
+            for(auto & keyword : f_keywords)
+            {
+                m_entries.push_back(createEntry(keyword));
+            }
+        }
+
+        /// Matches the query against all keywords.
+        /// @param f_query the (partial) string typed by the user
+        /// @param f_maxResults maximum number of results returned
+        /// @returns indices of matching keywords (as given on construction),
+        ///          best match first.
+        std::vector<size_t> match(const std::string & f_query, size_t f_maxResults) const
+        {
+            std::vector<std::pair<int, size_t> > scored;
+            if(f_query.empty())
+            {
+                return std::vector<size_t>();
+            }
+
+            std::string lowerQuery = toLower(f_query);
+            uint64_t queryMask = charMask(lowerQuery);
+            for(size_t i = 0; i < m_entries.size(); i++)
+            {
+                const Entry & entry = m_entries[i];
+                if( ((queryMask & ~entry.charMask) != 0) or (entry.keyword.size() < f_query.size()) )
+                {
+                    // keyword lacks at least one of the query characters
+                    continue;
+                }
+                int score = scoreEntry(entry, f_query, lowerQuery);
+                if(score != s_noMatch)
+                {
+                    scored.push_back(std::make_pair(score, i));
+                }
+            }
+
+            std::sort(scored.begin(), scored.end(),
+                    [this](const std::pair<int, size_t> & f_lhs, const std::pair<int, size_t> & f_rhs)
+                    {
+                        if(f_lhs.first != f_rhs.first)
+                        {
+                            return f_lhs.first > f_rhs.first;
+                        }
+                        const std::string & lhs = m_entries[f_lhs.second].keyword;
+                        const std::string & rhs = m_entries[f_rhs.second].keyword;
+                        if(lhs.size() != rhs.size())
+                        {
+                            return lhs.size() < rhs.size();
+                        }
+                        return lhs < rhs;
+                    });
+
+            std::vector<size_t> result;
+            for(size_t i = 0; (i < scored.size()) and (i < f_maxResults); i++)
+            {
+                result.push_back(scored[i].second);
+            }
+            return result;
+        }
+
+    private:
+        struct Entry
+        {
+            std::string keyword;
+            std::string lowerKeyword;
+            uint64_t charMask;
+            std::vector<int> positionBonus;
+        };
+
+        enum Score : int
+        {
+            s_noMatch = std::numeric_limits<int>::min(),
+            s_matchScore = 16,
+            s_sameCaseBonus = 1,
+            s_consecutiveBonus = 8,
+            s_segmentStartBonus = 12,
+            s_camelCaseBonus = 10,
+            s_lastSegmentBonus = 4,
+            s_gapPenalty = 1
+        };
+
+        static std::string toLower(const std::string & f_string)
+        {
+            std::string result = f_string;
+            for(auto & c : result)
+            {
+                c = std::tolower(static_cast<unsigned char>(c));
+            }
+            return result;
+        }
+
+        /// One bit per character class ('a'-'z', '0'-'9' and a few separators).
+        /// Used to quickly reject keywords not containing all query characters.
+        static uint64_t charMask(const std::string & f_lowerString)
+        {
+            uint64_t result = 0;
+            for(unsigned char c : f_lowerString)
+            {
+                if( (c >= 'a') and (c <= 'z') )
+                {
+                    result |= (uint64_t(1) << (c - 'a'));
+                }
+                else if( (c >= '0') and (c <= '9') )
+                {
+                    result |= (uint64_t(1) << (26 + c - '0'));
+                }
+                else
+                {
+                    result |= (uint64_t(1) << (36 + (c % 28)));
+                }
+            }
+            return result;
+        }
+
+        static bool isSeparator(char f_char)
+        {
+            return (f_char == '.') or (f_char == '_') or (f_char == '-') or (f_char == '/');
+        }
+
+        static Entry createEntry(const std::string & f_keyword)
+        {
+            Entry entry;
+            entry.keyword = f_keyword;
+            entry.lowerKeyword = toLower(f_keyword);
+            entry.charMask = charMask(entry.lowerKeyword);
+            entry.positionBonus.resize(f_keyword.size(), 0);
+
+            size_t lastSegmentStart = f_keyword.find_last_of('.');
+            lastSegmentStart = (lastSegmentStart == std::string::npos) ? 0 : lastSegmentStart + 1;
+
+            for(size_t j = 0; j < f_keyword.size(); j++)
+            {
+                int bonus = 0;
+                if( (j == 0) or isSeparator(f_keyword[j-1]) )
+                {
+                    bonus += s_segmentStartBonus;
+                }
+                else if( std::isupper(static_cast<unsigned char>(f_keyword[j])) and std::islower(static_cast<unsigned char>(f_keyword[j-1])) )
+                {
+                    bonus += s_camelCaseBonus;
+                }
+                if(j >= lastSegmentStart)
+                {
+                    bonus += s_lastSegmentBonus;
+                }
+                entry.positionBonus[j] = bonus;
+            }
+            return entry;
+        }
+
+        /// Scores the best alignment of the query with the keyword.
+        /// Dynamic programming over (query position, keyword position), linear
+        /// in the keyword length for each query character.
+        /// @returns s_noMatch, if the query is not a subsequence of the keyword.
+        int scoreEntry(const Entry & f_entry, const std::string & f_query, const std::string & f_lowerQuery) const
+        {
+            const size_t n = f_query.size();
+            const size_t m = f_entry.keyword.size();
+
+            // scores for previous and current query character, with the
+            // character matched at keyword position j:
+            m_previousRow.assign(m, int(s_noMatch));
+            m_currentRow.assign(m, int(s_noMatch));
+
+            for(size_t i = 0; i < n; i++)
+            {
+                // best (previousRow[j'] + gapPenalty * j') for all j' < j-1:
+                int bestGapped = int(s_noMatch);
+                for(size_t j = 0; j < m; j++)
+                {
+                    if( (j >= 2) and (m_previousRow[j-2] != s_noMatch) )
+                    {
+                        bestGapped = std::max(bestGapped, m_previousRow[j-2] + s_gapPenalty * static_cast<int>(j-2));
+                    }
+
+                    m_currentRow[j] = s_noMatch;
+                    if(f_entry.lowerKeyword[j] != f_lowerQuery[i])
+                    {
+                        continue;
+                    }
+
+                    int charScore = s_matchScore + f_entry.positionBonus[j];
+                    if(f_entry.keyword[j] == f_query[i])
+                    {
+                        charScore += s_sameCaseBonus;
+                    }
+
+                    if(i == 0)
+                    {
+                        m_currentRow[j] = charScore;
+                        continue;
+                    }
+
+                    int best = s_noMatch;
+                    if( (j >= 1) and (m_previousRow[j-1] != s_noMatch) )
+                    {
+                        best = m_previousRow[j-1] + s_consecutiveBonus;
+                    }
+                    if(bestGapped != s_noMatch)
+                    {
+                        best = std::max(best, bestGapped - s_gapPenalty * static_cast<int>(j-1));
+                    }
+                    if(best != s_noMatch)
+                    {
+                        m_currentRow[j] = best + charScore;
+                    }
+                }
+                std::swap(m_previousRow, m_currentRow);
+            }
+
+            int result = s_noMatch;
+            for(size_t j = 0; j < m; j++)
+            {
+                result = std::max(result, m_previousRow[j]);
+            }
+            return result;
+        }
+
+        std::vector<Entry> m_entries;
+
+        // scratch space for scoreEntry(), kept to avoid re-allocation per keyword
+        mutable std::vector<int> m_previousRow;
+        mutable std::vector<int> m_currentRow;
+};
+
+}
@@ -16,6 +16,8 @@
 #include <libArgParse/GrammarElement.hpp>
 #include <libArgParse/Grammar.hpp>
 
+#include <map>
+
 namespace ArgParse
 {
 
@@ -28,14 +30,22 @@ class GrammarInjector : public GrammarElement
         }
         virtual ParseRc parse(const char * f_string, ParsedElement & f_out_ParsedElement, size_t candidateDepth = 1, size_t startChild = 0) override final
         {
-            if(m_children.size() == 0)
+            GrammarElement * grammar = nullptr;
+            std::string key = getGrammarKey(f_out_ParsedElement.getRoot());
+            auto injected = m_injectedGrammars.find(key);
+            if(injected != m_injectedGrammars.end())
+            {
+                grammar = injected->second;
+            }
+            else
             {
                 // we first need to inject new grammar:
-                GrammarElement * newGrammar = getGrammar(f_out_ParsedElement.getRoot());
-                if(newGrammar != nullptr)
+                grammar = getGrammar(f_out_ParsedElement.getRoot());
+                if(grammar != nullptr)
                 {
                     // retrieving grammar succeeded :-)
-                    addChild(newGrammar);
+                    addChild(grammar);
+                    m_injectedGrammars[key] = grammar;
                 }
                 else
                 {
@@ -51,7 +61,7 @@ class GrammarInjector : public GrammarElement
             auto child = std::make_shared<ParsedElement>(&f_out_ParsedElement);
             // we transparently skip to parsing the new child
             //return m_children[0]->parse(f_string, f_out_ParsedElement, candidateDepth);
-            ParseRc childRc = m_children[0]->parse(f_string, *child, candidateDepth);
+            ParseRc childRc = grammar->parse(f_string, *child, candidateDepth);
 
             f_out_ParsedElement.addChild(child);
 
@@ -59,6 +69,21 @@ class GrammarInjector : public GrammarElement
         }
 
         virtual GrammarElement * getGrammar(ParsedElement * f_parseTree) = 0;
+
+        /// Identifies the grammar getGrammar() would return for a parse tree.
+        /// Grammar is only retrieved once per key and reused for all further
+        /// parses with the same key, so one grammar may be used to parse
+        /// different inputs (e.g. all commands of an interactive session).
+        /// The default key is constant, i.e. grammar is injected only once.
+        /// @param f_parseTree root of the parse tree parsed so far
+        virtual std::string getGrammarKey(ParsedElement * f_parseTree)
+        {
+            return "";
+        }
+
+    private:
+        /// Grammars retrieved so far (also children of this element), by key.
+        std::map<std::string, GrammarElement *> m_injectedGrammars;
 };
 
 
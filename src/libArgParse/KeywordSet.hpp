@@ -0,0 +1,211 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+#include <libArgParse/GrammarElement.hpp>
+#include <libArgParse/FuzzyMatcher.hpp>
+#include <algorithm>
+#include <memory>
+
+namespace ArgParse
+{
+
+/// Matches one out of a (potentially large) set of fixed strings.
+/// Semantically this is the same as an Alternation with one FixedString child
+/// per keyword, however keywords are kept in a sorted array. Matching and
+/// candidate lookup are done via binary search, so parse time does not grow
+/// linearly with the number of keywords. Candidates are returned in sorted order.
+/// Optionally, fuzzy completion candidates can be provided (see enableFuzzyCompletion()).
+class KeywordSet : public GrammarElement
+{
+    public:
+        explicit KeywordSet(const std::vector<std::string> & f_keywords, const std::string & f_elementName = "") :
+            GrammarElement("KeywordSet", f_elementName),
+            m_keywords(f_keywords),
+            m_maxKeywordLength(0),
+            m_maxFuzzyCandidates(0)
+        {
+            std::sort(m_keywords.begin(), m_keywords.end());
+            m_keywords.erase(std::unique(m_keywords.begin(), m_keywords.end()), m_keywords.end());
+            for(auto & keyword : m_keywords)
+            {
+                m_maxKeywordLength = std::max(m_maxKeywordLength, keyword.size());
+            }
+        }
+
+        virtual std::string toString() override
+        {
+            std::string result;
+            if(m_keywords.size()>1)
+            {
+                result += "(";
+            }
+            bool first = true;
+            for(auto & keyword: m_keywords)
+            {
+                if(!first)
+                {
+                    result += "||";
+                }
+                else
+                {
+                    first = false;
+                }
+                result += keyword;
+            }
+            if(m_keywords.size()>1)
+            {
+                result += ")";
+            }
+            return result;
+        }
+
+        virtual ParseRc parse(const char * f_string, ParsedElement & f_out_ParsedElement, size_t candidateDepth = 1, size_t startChild = 0) override
+        {
+            ParseRc rc;
+            f_out_ParsedElement.setGrammarElement(this);
+
+            if(m_keywords.size() == 0)
+            {
+                // same as an Alternation without children
+                return rc;
+            }
+
+            // we never need to look further into the string than the longest keyword:
+            size_t inputLength = strnlen(f_string, m_maxKeywordLength+1);
+
+            // the longest keyword which is a prefix of the input wins:
+            bool matched = false;
+            for(size_t len = std::min(inputLength, m_maxKeywordLength)+1; len-- > 0; )
+            {
+                auto it = lowerBound(f_string, len);
+                if( (it != m_keywords.end()) && (it->size() == len) && (it->compare(0, len, f_string, len) == 0) )
+                {
+                    rc.errorType = ParseRc::ErrorType::success;
+                    rc.lenParsedSuccessfully = len;
+                    rc.lenParsed = len;
+                    f_out_ParsedElement.setMatchedString(*it);
+                    matched = true;
+                    break;
+                }
+            }
+
+            // keywords starting with the complete input are candidates for completion.
+            // They are located in one contiguous range of the sorted array:
+            if(inputLength <= m_maxKeywordLength)
+            {
+                for(auto it = lowerBound(f_string, inputLength); it != m_keywords.end(); ++it)
+                {
+                    if(it->compare(0, inputLength, f_string, inputLength) != 0)
+                    {
+                        break;
+                    }
+                    if(it->size() == inputLength)
+                    {
+                        // this is the match itself
+                        continue;
+                    }
+                    auto candidate = std::make_shared<ParsedElement>(&f_out_ParsedElement);
+                    candidate->setGrammarElement(this);
+                    candidate->setMatchedString(*it);
+                    rc.candidates.push_back(candidate);
+                }
+            }
+
+            if(matched)
+            {
+                return rc;
+            }
+
+            if( (rc.candidates.size() == 0) && (m_maxFuzzyCandidates > 0) )
+            {
+                addFuzzyCandidates(f_string, inputLength, f_out_ParsedElement, rc);
+            }
+
+            if(rc.candidates.size() == 0)
+            {
+                rc.errorType = ParseRc::ErrorType::unexpectedText;
+            }
+            else
+            {
+                rc.errorType = ParseRc::ErrorType::missingText;
+                rc.lenParsed = inputLength;
+            }
+            return rc;
+        }
+
+        virtual std::string getDotNode() override
+        {
+            std::string result = "";
+            result += "n" + std::to_string(m_instanceId) + "[label=\"" + std::to_string(m_instanceId) + " " + m_typeName + " " + m_elementName + " " + m_tag + "'" + std::to_string(m_keywords.size())  + " keywords'\"];\n";
+            return result;
+        }
+
+        const std::vector<std::string> & getKeywords() const
+        {
+            return m_keywords;
+        }
+
+        /// Enables fuzzy completion.
+        /// If the input is the last token of the string and neither matches a
+        /// keyword nor is a prefix of one, the best keywords according to
+        /// FuzzyMatcher are returned as candidates (best match first).
+        /// @param f_maxCandidates maximum number of fuzzy candidates returned
+        void enableFuzzyCompletion(size_t f_maxCandidates = 16)
+        {
+            m_maxFuzzyCandidates = f_maxCandidates;
+        }
+
+    private:
+        void addFuzzyCandidates(const char * f_string, size_t f_inputLength, ParsedElement & f_out_ParsedElement, ParseRc & f_rc)
+        {
+            if( (f_inputLength == 0) || (f_inputLength > m_maxKeywordLength) || (strchr(f_string, ' ') != nullptr) )
+            {
+                // nothing typed, no keyword long enough or not at the end of input
+                return;
+            }
+
+            if(m_fuzzyMatcher == nullptr)
+            {
+                // index is only built, when fuzzy completion is actually requested
+                m_fuzzyMatcher.reset(new FuzzyMatcher(m_keywords));
+            }
+
+            for(size_t index : m_fuzzyMatcher->match(std::string(f_string, f_inputLength), m_maxFuzzyCandidates))
+            {
+                auto candidate = std::make_shared<ParsedElement>(&f_out_ParsedElement);
+                candidate->setGrammarElement(this);
+                candidate->setMatchedString(m_keywords[index]);
+                f_rc.candidates.push_back(candidate);
+            }
+        }
+
+        /// @returns iterator to the first keyword not less than the first f_len characters of f_string
+        std::vector<std::string>::const_iterator lowerBound(const char * f_string, size_t f_len) const
+        {
+            return std::lower_bound(m_keywords.begin(), m_keywords.end(), f_string,
+                    [f_len](const std::string & f_keyword, const char * f_value)
+                    {
+                        return f_keyword.compare(0, std::string::npos, f_value, f_len) < 0;
+                    });
+        }
+
+        std::vector<std::string> m_keywords;
+        size_t m_maxKeywordLength;
+        size_t m_maxFuzzyCandidates;
+        std::unique_ptr<FuzzyMatcher> m_fuzzyMatcher;
+};
+
+}
@@ -0,0 +1,114 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+#include <libArgParse/GrammarElement.hpp>
+
+namespace ArgParse
+{
+
+/// Refers to an already existing GrammarElement, which usually is an ancestor
+/// of this element. This allows to express recursive grammars (e.g. nested
+/// messages of the same type) without expanding the grammar infinitely.
+/// The referenced element is not owned and not re-parented.
+/// To keep candidate search finite, the referenced element is not entered again
+/// if it is already being parsed on empty input through this reference.
+/// On non-empty input, recursion is bounded by the input length, as long as
+/// each cycle in the grammar consumes at least one character.
+class RecursiveReference : public GrammarElement
+{
+    public:
+        explicit RecursiveReference(GrammarElement * f_target, const std::string & f_elementName = "") :
+            GrammarElement("RecursiveReference", f_elementName)
+        {
+            m_children.push_back(f_target);
+        }
+
+        virtual std::string toString() override
+        {
+            // do not recurse here, as this would never terminate:
+            return "@" + std::to_string(m_instanceId);
+        }
+
+        virtual ParseRc parse(const char * f_string, ParsedElement & f_out_ParsedElement, size_t candidateDepth = 1, size_t startChild = 0) override
+        {
+            f_out_ParsedElement.setGrammarElement(this);
+
+            bool emptyInput = (f_string[0] == '\0');
+            if(emptyInput && isActive(f_string))
+            {
+                // We already expand candidates through this reference.
+                // Expanding again would not terminate.
+                ParseRc rc;
+                rc.errorType = ParseRc::ErrorType::missingText;
+                return rc;
+            }
+
+            ActiveParse activeParse(this, f_string);
+            auto child = std::make_shared<ParsedElement>(&f_out_ParsedElement);
+            ParseRc childRc = m_children[0]->parse(f_string, *child, candidateDepth);
+            f_out_ParsedElement.addChild(child);
+
+            return childRc;
+        }
+
+    private:
+        /// A parse of a reference in progress. Instances live on the call
+        /// stack and form a list from the innermost to the outermost parse
+        /// of the current thread, so the grammar itself keeps no per-parse
+        /// state.
+        class ActiveParse
+        {
+            public:
+                ActiveParse(const RecursiveReference * f_reference, const char * f_string) :
+                    m_reference(f_reference),
+                    m_string(f_string),
+                    m_outer(innermost())
+                {
+                    innermost() = this;
+                }
+
+                ~ActiveParse()
+                {
+                    innermost() = m_outer;
+                }
+
+                static const ActiveParse *& innermost()
+                {
+                    static thread_local const ActiveParse * s_innermost = nullptr;
+                    return s_innermost;
+                }
+
+                const RecursiveReference * m_reference;
+                const char * m_string;
+                const ActiveParse * m_outer;
+        };
+
+        /// @returns true if this reference is already being parsed at the
+        ///          given input position
+        bool isActive(const char * f_string) const
+        {
+            for(const ActiveParse * parse = ActiveParse::innermost(); parse != nullptr; parse = parse->m_outer)
+            {
+                if( (parse->m_reference == this) && (parse->m_string == f_string) )
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+};
+
+}
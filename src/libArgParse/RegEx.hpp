@@ -14,6 +14,9 @@
 
 #pragma once
 #include <libArgParse/GrammarElement.hpp>
+#include <bitset>
+#include <cctype>
+#include <cstring>
 
 #ifdef BUILD_CONFIG_USE_BOOST_REGEX
     #include <boost/regex.hpp>
@@ -33,10 +36,12 @@ namespace regex
         using boost::cmatch;
         using boost::regex_search;
         using boost::regex;
+        namespace regex_constants = boost::regex_constants;
     #else
         using std::cmatch;
         using std::regex_search;
         using std::regex;
+        namespace regex_constants = std::regex_constants;
     #endif
 }
 
@@ -47,7 +52,8 @@ class RegEx : public GrammarElement
         RegEx(const std::string & f_regEx, const std::string & f_elementName = "") :
             GrammarElement("RegEx", f_elementName),
             m_regEx(f_regEx),
-            m_regExString(f_regEx)
+            m_regExString(f_regEx),
+            m_isCharacterClass(compileCharacterClass(f_regEx))
         {
         }
 
@@ -78,11 +84,18 @@ class RegEx : public GrammarElement
             ParseRc childRc;
             f_out_ParsedElement.setGrammarElement(this);
 
+            if(m_isCharacterClass)
+            {
+                return parseCharacterClass(f_string, f_out_ParsedElement);
+            }
+
             //std::cmatch match;
             regex::cmatch match;
+            // match_continuous anchors the search at the beginning of the input,
+            // so failing matches do not scan the whole remaining input:
             if(
                     //std::regex_search(f_string, match, m_regEx)
-                    regex::regex_search(f_string, match, m_regEx)
+                    regex::regex_search(f_string, match, m_regEx, regex::regex_constants::match_continuous)
                     and
                     (match.position() == 0)
               )
@@ -112,6 +125,34 @@ class RegEx : public GrammarElement
 
             return rc;
         }
+        /// Matches regexes of the form "[...]*" or "[...]+" without the regex
+        /// engine. This is considerably faster and does not recurse per
+        /// character (which overflows the stack for long values with some
+        /// regex implementations).
+        ParseRc parseCharacterClass(const char * f_string, ParsedElement & f_out_ParsedElement)
+        {
+            ParseRc rc;
+            size_t length = 0;
+            while( (f_string[length] != '\0') and m_characterClass[static_cast<uint8_t>(f_string[length])] )
+            {
+                length++;
+            }
+            if( (length > 0) or (not m_characterClassMustMatch) )
+            {
+                rc.errorType = ParseRc::ErrorType::success;
+                rc.lenParsedSuccessfully = length;
+                rc.lenParsed = length;
+                f_out_ParsedElement.setMatchedString(std::string(f_string, length));
+            }
+            else
+            {
+                rc.lenParsedSuccessfully = 0;
+                rc.lenParsed = strlen(f_string);
+                rc.errorType = (f_string[0] == '\0') ? ParseRc::ErrorType::missingText : ParseRc::ErrorType::unexpectedText;
+            }
+            return rc;
+        }
+
         virtual std::string getDotNode() override
         {
             std::string result = "";
@@ -119,9 +160,90 @@ class RegEx : public GrammarElement
             return result;
         }
     private:
+        /// Reads a single (possibly escaped) character of a bracket expression.
+        /// @returns false for anything but plain characters and escaped punctuation
+        static bool readClassCharacter(const std::string & f_regEx, size_t & f_pos, size_t f_end, uint8_t & f_out_char)
+        {
+            char c = f_regEx[f_pos];
+            if( (c == '[') or (c == ']') )
+            {
+                return false;
+            }
+            if(c == '\\')
+            {
+                f_pos++;
+                if( (f_pos >= f_end) or isalnum(static_cast<uint8_t>(f_regEx[f_pos])) )
+                {
+                    // character class escapes like \d are not supported
+                    return false;
+                }
+                c = f_regEx[f_pos];
+            }
+            f_out_char = static_cast<uint8_t>(c);
+            f_pos++;
+            return true;
+        }
+
+        /// Initializes m_characterClass, if the regex consists of a single
+        /// bracket expression followed by '*' or '+'.
+        /// @returns false if the regex has any other form
+        bool compileCharacterClass(const std::string & f_regEx)
+        {
+            size_t size = f_regEx.size();
+            if( (size < 4) or (f_regEx[0] != '[') or (f_regEx[size-2] != ']') or ( (f_regEx[size-1] != '*') and (f_regEx[size-1] != '+') ) )
+            {
+                return false;
+            }
+            m_characterClassMustMatch = (f_regEx[size-1] == '+');
+
+            std::bitset<256> characters;
+            size_t end = size-2;
+            size_t pos = 1;
+            bool negated = (f_regEx[pos] == '^');
+            if(negated)
+            {
+                pos++;
+            }
+            if(pos >= end)
+            {
+                return false;
+            }
+            while(pos < end)
+            {
+                uint8_t first;
+                if(not readClassCharacter(f_regEx, pos, end, first))
+                {
+                    return false;
+                }
+                uint8_t last = first;
+                if( (pos + 1 < end) and (f_regEx[pos] == '-') )
+                {
+                    pos++;
+                    if( (not readClassCharacter(f_regEx, pos, end, last)) or (last < first) )
+                    {
+                        return false;
+                    }
+                }
+                for(size_t c = first; c <= last; c++)
+                {
+                    characters.set(c);
+                }
+            }
+            m_characterClass = negated ? ~characters : characters;
+            return true;
+        }
+
+
         //const std::regex m_regEx;
         const regex::regex m_regEx;
         const std::string m_regExString;
+
+        // Character class for the fast path (see parseCharacterClass()).
+        // Declared before m_isCharacterClass, as they are initialized by its
+        // initializer.
+        std::bitset<256> m_characterClass;
+        bool m_characterClassMustMatch = false;
+        const bool m_isCharacterClass;
 };
 
 }
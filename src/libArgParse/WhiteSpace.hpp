@@ -37,7 +37,7 @@ class WhiteSpace : public GrammarElement
 
             std::string matchedString = "";
             size_t i;
-            for(i = 0; i< strlen(f_string); i++)
+            for(i = 0; f_string[i] != '\0'; i++)
             {
                 if(f_string[i] == ' ')
                 {
@@ -60,9 +60,9 @@ class WhiteSpace : public GrammarElement
             else
             {
                 rc.lenParsedSuccessfully = 0;
-                if(i == strlen(f_string))
+                if(f_string[i] == '\0')
                 {
-                    rc.lenParsed = strlen(f_string);
+                    rc.lenParsed = i;
                     // have a candidate for completion :)
                     //printf(" -> completion possible\n");
                     // create a candidate:
@@ -18,15 +18,31 @@
 #include <google/protobuf/dynamic_message.h>
 #include <libCli/OutputFormatting.hpp>
 #include <libCli/MessageParsing.hpp>
+#include <libCli/MessageProjection.hpp>
+#include <libCli/Recording.hpp>
+#include <libCli/ReplyAggregation.hpp>
+#include <libCli/ReplyFilter.hpp>
+#include <libCli/ReplyPipeline.hpp>
+#include <libCli/StreamStatistics.hpp>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>
+#include <fstream>
+#include <functional>
 #include <iomanip>
+#include <map>
+#include <mutex>
+#include <thread>
 
 // for detecting if we are writing stdout to terminal or to pipe/file
 #include <stdio.h>
 #include <unistd.h>
 
 #include <libCli/cliUtils.hpp>
+#include <libCli/DescriptorSource.hpp>
+#include <libCli/Interrupt.hpp>
 
 using namespace ArgParse;
 
@@ -148,24 +164,740 @@ std::string getTimeString()
     return cstr ;
 }
 
-int call(ParsedElement & parseTree)
+/// Prints output of a call. Output of calls to one of multiple targets is
+/// tagged with the target on every line. Output of concurrent calls is
+/// serialized line-wise.
+class CallOutput
 {
-    std::string serverAddress = parseTree.findFirstChild("ServerAddress");
-    std::string serverPort = parseTree.findFirstChild("ServerPort");
-    if(serverPort == "")
+    public:
+        /// @param f_tag tag prepended to every line, empty for untagged output
+        explicit CallOutput(const std::string & f_tag = "") :
+            m_tag(f_tag)
+        {
+        }
+
+        /// Prints text to stdout.
+        void out(const std::string & f_text)
+        {
+            print(std::cout, f_text);
+        }
+
+        /// Prints text to stderr.
+        void err(const std::string & f_text)
+        {
+            print(std::cerr, f_text);
+        }
+
+        /// @returns stdout if output is untagged and may be streamed directly,
+        ///          nullptr otherwise
+        std::ostream * directStream()
+        {
+            return m_tag.empty() ? &std::cout : nullptr;
+        }
+
+    private:
+        void print(std::ostream & f_stream, const std::string & f_text)
+        {
+            if(m_tag.empty())
+            {
+                f_stream << f_text << std::flush;
+                return;
+            }
+            std::string tagged;
+            size_t lineStart = 0;
+            while(lineStart < f_text.size())
+            {
+                size_t lineEnd = f_text.find('\n', lineStart);
+                lineEnd = (lineEnd == std::string::npos) ? f_text.size() : lineEnd + 1;
+                tagged += "[" + m_tag + "] " + f_text.substr(lineStart, lineEnd - lineStart);
+                lineStart = lineEnd;
+            }
+            if( (not tagged.empty()) and (tagged.back() != '\n') )
+            {
+                tagged += '\n';
+            }
+            std::lock_guard<std::mutex> lock(s_mutex);
+            f_stream << tagged << std::flush;
+        }
+
+        std::string m_tag;
+        static std::mutex s_mutex;
+};
+
+std::mutex CallOutput::s_mutex;
+
+/// Upper limit of --formatThreads=, far beyond any useful number of threads.
+static const uint64_t s_maxFormatThreads = 1024;
+
+/// Checks the values of options which are only read once the call is
+/// running.
+/// @returns false (after printing an error) if a value is invalid
+static bool checkOptions(ParsedElement & f_parseTree)
+{
+    uint64_t value;
+    if( not ( getNumericOption(&f_parseTree, "MaxDumpBytes", "--maxDumpBytes=", SIZE_MAX, value)
+        and getNumericOption(&f_parseTree, "FormatThreads", "--formatThreads=", s_maxFormatThreads, value)
+        and getNumericOption(&f_parseTree, "QueueSize", "--queueSize=", SIZE_MAX, value) ) )
+    {
+        return false;
+    }
+    std::string queuePolicyStr = f_parseTree.findFirstChild("QueuePolicy");
+    ReplyPipeline::QueuePolicy queuePolicy;
+    if( (queuePolicyStr != "") and (not ReplyPipeline::parseQueuePolicy(queuePolicyStr, queuePolicy)) )
+    {
+        std::cerr << "Error: Unknown queue policy '" << queuePolicyStr << "'" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// Applies the output options of the parse tree to a formatter.
+/// Numeric options have to be checked with checkOptions() before.
+static void configureFormatter(cli::OutputFormatter & f_formatter, ParsedElement & f_parseTree)
+{
+    // disable colored output if explicitly specified:
+    if(f_parseTree.findFirstChild("NoColor") != "")
+    {
+        f_formatter.clearColorMap();
+    }
+
+    // automatically disable colored output, when outputting to something
+    // else than a terminal (pipes, files, etc.), except we explicitly
+    // request color mode:
+    if((not isatty(fileno(stdout))) and (f_parseTree.findFirstChild("Color") == ""))
+    {
+        f_formatter.clearColorMap();
+    }
+
+    std::string maxDumpBytes = f_parseTree.findFirstChild("MaxDumpBytes");
+    if(maxDumpBytes != "")
+    {
+        f_formatter.setMaxBytesToDump(std::stoull(maxDumpBytes));
+    }
+}
+
+/// @returns the time string and header printed before a reply
+static std::string getReplyHeader(const std::string & f_receptionTime)
+{
+    return f_receptionTime + ": Received message:\n";
+}
+
+/// Formats a reply with the header and the requested output format.
+/// @param f_customFormatParseTree parse tree of the custom output format or
+///        nullptr for the built-in human readable format
+static std::string formatReply(cli::OutputFormatter & f_formatter, const grpc::protobuf::Message & f_reply, const grpc::protobuf::Descriptor * f_replyDescriptor, ParsedElement * f_customFormatParseTree, const std::string & f_receptionTime)
+{
+    std::string msgString;
+    if(f_customFormatParseTree == nullptr)
+    {
+        // use built-in human readable output format
+        msgString = f_formatter.messageToString(f_reply, f_replyDescriptor, "| ", "| " );
+    }
+    else
+    {
+        // use user provided output format string
+        msgString = customMessageFormat(f_reply, f_replyDescriptor, *f_customFormatParseTree);
+    }
+    return getReplyHeader(f_receptionTime) + msgString + "\n";
+}
+
+/// Adds the fields printed by a custom output format to a projection.
+/// Follows the target specifier like customMessageFormat().
+/// @returns false if the printed fields cannot be determined
+static bool addCustomFormatFields(ParsedElement & f_customFormatParseTree, const grpc::protobuf::Descriptor * f_messageDescriptor, MessageProjection & f_projection)
+{
+    std::vector<const grpc::protobuf::FieldDescriptor *> path;
+    const grpc::protobuf::Descriptor * messageDescriptor = f_messageDescriptor;
+
+    bool found = false;
+    ParsedElement targetList = f_customFormatParseTree.findFirstSubTree("TargetSpecifier", found);
+    if(found)
+    {
+        for(auto & target : targetList.getChildren())
+        {
+            std::string partialTarget = target->findFirstChild("PartialTarget");
+            if(partialTarget == "")
+            {
+                // empty target addresses the current message
+                break;
+            }
+            const grpc::protobuf::FieldDescriptor * partialField = messageDescriptor->FindFieldByName(partialTarget);
+            if( (partialField == nullptr) or (partialField->type() != grpc::protobuf::FieldDescriptor::Type::TYPE_MESSAGE) )
+            {
+                // error output or output of the current message in this case
+                // -> not worth to optimize
+                return false;
+            }
+            path.push_back(partialField);
+            messageDescriptor = partialField->message_type();
+        }
+    }
+
+    bool haveFormatString = false;
+    ParsedElement & formatString = f_customFormatParseTree.findFirstSubTree("OutputFormatString", haveFormatString);
+    if(not haveFormatString)
+    {
+        return false;
+    }
+    for(auto & outputStatement : formatString.getChildren())
+    {
+        bool foundFieldReference = false;
+        ParsedElement & fieldReference = outputStatement->findFirstSubTree("OutputFieldReference", foundFieldReference);
+        if(foundFieldReference)
+        {
+            const grpc::protobuf::FieldDescriptor * fieldRef = messageDescriptor->FindFieldByName(fieldReference.getMatchedString());
+            if(fieldRef != nullptr)
+            {
+                path.push_back(fieldRef);
+                f_projection.addField(path);
+                path.pop_back();
+            }
+        }
+    }
+    return true;
+}
+
+/// Settings how replies of a call are selected and decoded.
+struct ReplyDecoding
+{
+    /// Filter for replies to print, nullptr to print all replies.
+    const ReplyFilter * filter = nullptr;
+
+    /// Fields needed for output, nullptr to decode complete replies.
+    const MessageProjection * projection = nullptr;
+
+    /// Compiled aggregation, nullptr to print replies instead of
+    /// aggregating them. Each call aggregates into its own copy.
+    const ReplyAggregation * aggregation = nullptr;
+};
+
+/// Decodes a reply which passed ReplyFilter::rejectsSerialized().
+/// @returns the reply or nullptr if it is rejected by the filter
+static std::unique_ptr<grpc::protobuf::Message> decodeReply(const grpc::protobuf::Message & f_prototype, const std::string & f_serializedReply, const ReplyDecoding & f_decoding)
+{
+    std::unique_ptr<grpc::protobuf::Message> replyMessage(f_prototype.New());
+    std::string projection;
+    if( (f_decoding.projection != nullptr) and f_decoding.projection->project(f_serializedReply, projection) )
+    {
+        // required fields of proto2 messages may have been projected away:
+        replyMessage->ParsePartialFromString(projection);
+    }
+    else
+    {
+        replyMessage->ParseFromString(f_serializedReply);
+    }
+    if( (f_decoding.filter != nullptr) and (not f_decoding.filter->matches(*replyMessage)) )
+    {
+        return nullptr;
+    }
+    return replyMessage;
+}
+
+/// @returns number of threads to decode and format replies of streaming RPCs
+static size_t getFormatThreads(ParsedElement & f_parseTree)
+{
+    std::string formatThreads = f_parseTree.findFirstChild("FormatThreads");
+    if(formatThreads != "")
+    {
+        return std::max<size_t>(1, std::stoul(formatThreads));
+    }
+    return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// Calls a report function periodically on a separate thread until stopped.
+class PeriodicReport
+{
+    public:
+        /// @param f_interval time between two reports
+        /// @param f_report function called for each report
+        PeriodicReport(std::chrono::nanoseconds f_interval, std::function<void()> f_report) :
+            m_thread([this, f_interval, f_report]
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        while(not m_stopped.wait_for(lock, f_interval, [this]{ return m_stop; }))
+                        {
+                            f_report();
+                        }
+                    })
+        {
+        }
+
+        ~PeriodicReport()
+        {
+            stop();
+        }
+
+        /// Stops reporting and waits for a running report to finish.
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_stopped.notify_one();
+            if(m_thread.joinable())
+            {
+                m_thread.join();
+            }
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_stopped;
+        bool m_stop = false;
+        std::thread m_thread;
+};
+
+/// @returns interval given with --reportInterval= (default 1s)
+static std::chrono::nanoseconds getReportInterval(ParsedElement & f_parseTree)
+{
+    std::string intervalStr = f_parseTree.findFirstChild("ReportInterval");
+    double intervalSeconds = (intervalStr != "") ? std::stod(intervalStr) : 1.0;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(std::max(0.001, intervalSeconds)));
+}
+
+/// Reads all replies without decoding them and prints statistics about the
+/// reply stream (--stats): a report every interval given with
+/// --reportInterval= and a summary at the end.
+static void receiveStatistics(grpc::testing::CliCall & f_call, std::multimap<grpc::string_ref, grpc::string_ref> & f_serverMetadata, ParsedElement & f_parseTree, CallOutput & f_output)
+{
+    StreamStatistics statistics;
+    PeriodicReport report(getReportInterval(f_parseTree), [&]
+            {
+                f_output.out(statistics.getIntervalReport());
+            });
+
+    grpc::string serializedResponse;
+    for (bool init = true; f_call.Read(&serializedResponse, init ? &f_serverMetadata : nullptr); init= false)
+    {
+        statistics.recordMessage(serializedResponse.size());
+    }
+
+    report.stop();
+    f_output.out(statistics.getSummary());
+}
+
+/// Aggregates all replies (--aggregate) instead of printing them and prints
+/// the resulting table at the end. If --reportInterval= is given, the table
+/// aggregated so far is printed periodically as well.
+static void aggregateReplies(grpc::testing::CliCall & f_call, std::multimap<grpc::string_ref, grpc::string_ref> & f_serverMetadata, ParsedElement & f_parseTree, const grpc::protobuf::Message & f_replyPrototype, const ReplyDecoding & f_decoding, CallOutput & f_output)
+{
+    // each call aggregates into its own copy of the compiled aggregation:
+    ReplyAggregation aggregation = *f_decoding.aggregation;
+    std::mutex mutex;
+    std::unique_ptr<PeriodicReport> report;
+    if(f_parseTree.findFirstChild("ReportInterval") != "")
+    {
+        report = std::unique_ptr<PeriodicReport>(new PeriodicReport(getReportInterval(f_parseTree), [&]
+                    {
+                        std::string table;
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            table = aggregation.getTable();
+                        }
+                        f_output.out(table + "\n");
+                    }));
+    }
+
+    grpc::string serializedResponse;
+    for (bool init = true; f_call.Read(&serializedResponse, init ? &f_serverMetadata : nullptr); init= false)
+    {
+        if( (f_decoding.filter != nullptr) and f_decoding.filter->rejectsSerialized(serializedResponse) )
+        {
+            continue;
+        }
+        std::unique_ptr<grpc::protobuf::Message> replyMessage = decodeReply(f_replyPrototype, serializedResponse, f_decoding);
+        if(not replyMessage)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        aggregation.add(*replyMessage);
+    }
+
+    if(report)
+    {
+        report->stop();
+    }
+    f_output.out(aggregation.getTable());
+}
+
+/// Records all replies (--record=) instead of printing them.
+/// @returns number of recorded replies
+static uint64_t recordReplies(grpc::testing::CliCall & f_call, std::multimap<grpc::string_ref, grpc::string_ref> & f_serverMetadata, RecordingWriter & f_recorder, CallOutput & f_output)
+{
+    uint64_t numberOfReplies = 0;
+    grpc::string serializedResponse;
+    for (bool init = true; f_call.Read(&serializedResponse, init ? &f_serverMetadata : nullptr); init= false)
+    {
+        if(init)
+        {
+            f_recorder.writeInitialMetadata(f_serverMetadata);
+        }
+        f_recorder.writeReply(serializedResponse);
+        numberOfReplies++;
+    }
+    f_output.out("Recorded " + std::to_string(numberOfReplies) + " replies\n");
+    return numberOfReplies;
+}
+
+/// Performs the RPC on one channel and prints all replies.
+/// Untagged replies of server streaming RPCs are decoded and formatted on
+/// multiple threads (see getFormatThreads()).
+/// @param f_decoding filter and projection for replies
+/// @param f_recorder recording to write the call to instead of printing
+///        replies, nullptr to print replies
+/// @returns 0 if RPC succeeded, -1 otherwise
+static int callOnChannel(std::shared_ptr<grpc::Channel> f_channel, ParsedElement & f_parseTree, const grpc::protobuf::MethodDescriptor * f_method, google::protobuf::DynamicMessageFactory & f_dynamicFactory, const grpc::string & f_serializedRequest, const ReplyDecoding & f_decoding, RecordingWriter * f_recorder, CallOutput & f_output)
+{
+    // now we do the actual RPC call:
+    std::multimap<grpc::string, grpc::string> clientMetadata;
+    grpc::string serializedResponse;
+    std::multimap<grpc::string_ref, grpc::string_ref> serverMetadataA;
+    std::multimap<grpc::string_ref, grpc::string_ref> serverMetadataB;
+
+    std::string methodStr =  "/" + f_method->service()->full_name() + "/" + f_method->name();
+    if(f_recorder != nullptr)
+    {
+        f_recorder->writeCallStart(f_method->full_name(), clientMetadata);
+        f_recorder->writeRequest(f_serializedRequest);
+    }
+    // Ctrl-C cancels the call, which then ends regularly (e.g. recordings
+    // are closed). Before, e.g. while connecting, it terminates gWhisper:
+    InterruptScope interruptScope;
+    grpc::testing::CliCall call(f_channel, methodStr, clientMetadata);
+    CancelOnInterrupt cancelOnInterrupt(call);
+    call.Write(f_serializedRequest);
+    call.WritesDone();
+
+    // decide on message formatting method to use:
+    bool customOutputFormatRequested = false;
+    ParsedElement & customFormatTree = f_parseTree.findFirstSubTree("CustomOutputFormat", customOutputFormatRequested);
+    ParsedElement * customFormatParseTree = customOutputFormatRequested ? &customFormatTree : nullptr;
+
+    const grpc::protobuf::Descriptor * replyDescriptor = f_method->output_type();
+    const grpc::protobuf::Message * replyPrototype = f_dynamicFactory.GetPrototype(replyDescriptor);
+
+    // In a loop we read reply data from the reply stream:
+    // NOTE: in gRPC every RPC can be considered "streaming". Non-streaming RPCs
+    //  merely return one reply message.
+    std::ostream * stream = f_output.directStream();
+    size_t formatThreads = getFormatThreads(f_parseTree);
+    std::string queueSizeStr = f_parseTree.findFirstChild("QueueSize");
+    std::string queuePolicyStr = f_parseTree.findFirstChild("QueuePolicy");
+    bool queueRequested = (queueSizeStr != "") or (queuePolicyStr != "");
+    uint64_t recordedReplies = 0;
+    if(f_recorder != nullptr)
+    {
+        recordedReplies = recordReplies(call, serverMetadataA, *f_recorder, f_output);
+    }
+    else if(f_parseTree.findFirstChild("Stats") != "")
+    {
+        receiveStatistics(call, serverMetadataA, f_parseTree, f_output);
+    }
+    else if(f_decoding.aggregation != nullptr)
+    {
+        aggregateReplies(call, serverMetadataA, f_parseTree, *replyPrototype, f_decoding, f_output);
+    }
+    else if( f_method->server_streaming() and (stream != nullptr) and ( (formatThreads > 1) or queueRequested ) )
+    {
+        // this thread only reads replies, they are decoded and formatted by
+        // the pipeline:
+        // the policy was checked by checkOptions():
+        ReplyPipeline::QueuePolicy queuePolicy = ReplyPipeline::QueuePolicy::Block;
+        if(queuePolicyStr != "")
+        {
+            ReplyPipeline::parseQueuePolicy(queuePolicyStr, queuePolicy);
+        }
+        size_t queueSize = (queueSizeStr != "") ? std::stoul(queueSizeStr) : formatThreads * 64;
+
+        std::vector<std::unique_ptr<cli::OutputFormatter>> formatters;
+        for(size_t i = 0; i < formatThreads; i++)
+        {
+            formatters.push_back(std::unique_ptr<cli::OutputFormatter>(new cli::OutputFormatter()));
+            configureFormatter(*formatters.back(), f_parseTree);
+        }
+        ReplyPipeline pipeline(formatThreads, queueSize, queuePolicy, [&](size_t f_worker, const std::string & f_receptionTime, const std::string & f_serializedReply)
+                {
+                    std::unique_ptr<grpc::protobuf::Message> replyMessage = decodeReply(*replyPrototype, f_serializedReply, f_decoding);
+                    if(not replyMessage)
+                    {
+                        return std::string();
+                    }
+                    return formatReply(*formatters[f_worker], *replyMessage, replyDescriptor, customFormatParseTree, f_receptionTime);
+                },
+                *stream);
+
+        for (bool init = true; call.Read(&serializedResponse, init ? &serverMetadataA : nullptr); init= false)
+        {
+            if( (f_decoding.filter != nullptr) and f_decoding.filter->rejectsSerialized(serializedResponse) )
+            {
+                continue;
+            }
+            pipeline.push(getTimeString(), std::move(serializedResponse));
+        }
+        pipeline.finish();
+
+        if(queueRequested)
+        {
+            ReplyPipeline::Statistics statistics = pipeline.getStatistics();
+            f_output.err("Reply queue: " + std::to_string(statistics.received) + " received, "
+                    + std::to_string(statistics.dropped) + " dropped, maximum depth "
+                    + std::to_string(statistics.maxQueueDepth) + " of " + std::to_string(queueSize) + "\n");
+        }
+    }
+    else
+    {
+        // use one formatter for all replies, so the layout of the reply
+        // message type is computed only once:
+        cli::OutputFormatter messageFormatter;
+        configureFormatter(messageFormatter, f_parseTree);
+
+        for (bool init = true; call.Read(&serializedResponse, init ? &serverMetadataA : nullptr); init= false)
+        {
+            if( (f_decoding.filter != nullptr) and f_decoding.filter->rejectsSerialized(serializedResponse) )
+            {
+                continue;
+            }
+
+            // convert data received from stream into a message:
+            std::unique_ptr<grpc::protobuf::Message> replyMessage = decodeReply(*replyPrototype, serializedResponse, f_decoding);
+            if(not replyMessage)
+            {
+                continue;
+            }
+
+            if( (customFormatParseTree == nullptr) and (stream != nullptr) )
+            {
+                // stream large replies while formatting them:
+                *stream << getReplyHeader(getTimeString());
+                messageFormatter.printMessage(*stream, *replyMessage, replyDescriptor, "| ", "| " );
+                *stream << "\n" << std::flush;
+                continue;
+            }
+            f_output.out(formatReply(messageFormatter, *replyMessage, replyDescriptor, customFormatParseTree, getTimeString()));
+        }
+    }
+
+    // reply stream finished -> finish the RPC:
+    grpc::Status status = call.Finish(&serverMetadataB);
+    if(f_recorder != nullptr)
+    {
+        if(recordedReplies == 0)
+        {
+            // initial metadata is recorded with the first reply, otherwise
+            // it is only known now:
+            f_recorder->writeInitialMetadata(call.GetServerInitialMetadata());
+        }
+        f_recorder->writeStatus(status, serverMetadataB);
+    }
+
+    if(not status.ok())
+    {
+        f_output.err("RPC failed ;( Status code: " + std::to_string(status.error_code()) + ", error message: " + status.error_message() + "\n");
+        return -1;
+    }
+
+    f_output.out("RPC succeeded :D\n");
+
+    return 0;
+}
+
+/// Collects the targets given with --targets. Values starting with '@' name
+/// files containing one target per line (empty lines and lines starting with
+/// '#' are ignored), other values are comma separated lists of targets.
+/// Targets without port get the default port 50051.
+/// @returns false if a target file could not be read
+static bool getFanOutTargets(ParsedElement & f_parseTree, std::vector<std::string> & f_out_targets)
+{
+    std::vector<std::string> entries;
+    for(const std::string & value : findAllOptionValues(&f_parseTree, "Targets"))
+    {
+        if( (not value.empty()) and (value[0] == '@') )
+        {
+            std::ifstream file(value.substr(1));
+            if(not file)
+            {
+                std::cerr << "Error: Cannot read target file '" << value.substr(1) << "'" << std::endl;
+                return false;
+            }
+            std::string line;
+            while(std::getline(file, line))
+            {
+                size_t begin = line.find_first_not_of(" \t\r");
+                if( (begin == std::string::npos) or (line[begin] == '#') )
+                {
+                    continue;
+                }
+                size_t end = line.find_last_not_of(" \t\r");
+                entries.push_back(line.substr(begin, end - begin + 1));
+            }
+        }
+        else
+        {
+            size_t begin = 0;
+            while(begin <= value.size())
+            {
+                size_t end = value.find(',', begin);
+                end = (end == std::string::npos) ? value.size() : end;
+                if(end > begin)
+                {
+                    entries.push_back(value.substr(begin, end - begin));
+                }
+                begin = end + 1;
+            }
+        }
+    }
+
+    for(const std::string & entry : entries)
+    {
+        size_t bracketEnd = entry.rfind(']');
+        size_t colon = entry.rfind(':');
+        bool hasPort = (colon != std::string::npos) and ( (bracketEnd == std::string::npos) ? (entry.find(':') == colon) : (colon > bracketEnd) );
+        if(hasPort)
+        {
+            f_out_targets.push_back(entry);
+        }
+        else if( (colon != std::string::npos) and (bracketEnd == std::string::npos) )
+        {
+            // IPv6 address without brackets
+            f_out_targets.push_back("[" + entry + "]:50051");
+        }
+        else
+        {
+            f_out_targets.push_back(entry + ":50051");
+        }
+    }
+    return true;
+}
+
+/// Retrieves a hash over the files defining a symbol (including all
+/// dependencies returned by the server) via server reflection.
+/// @returns false if the server could not provide the file
+static bool getSchemaHash(std::shared_ptr<grpc::Channel> f_channel, const std::string & f_symbol, size_t & f_out_hash, std::string & f_out_error)
+{
+    std::unique_ptr<grpc::reflection::v1alpha::ServerReflection::Stub> stub = grpc::reflection::v1alpha::ServerReflection::NewStub(f_channel);
+    grpc::ClientContext context;
+    auto stream = stub->ServerReflectionInfo(&context);
+
+    grpc::reflection::v1alpha::ServerReflectionRequest request;
+    request.set_file_containing_symbol(f_symbol);
+    grpc::reflection::v1alpha::ServerReflectionResponse response;
+    bool ok = stream->Write(request) and stream->Read(&response);
+    stream->WritesDone();
+    grpc::Status status = stream->Finish();
+    if( (not ok) or (not status.ok()) )
     {
-        serverPort = "50051";
+        f_out_error = "reflection request failed: " + status.error_message();
+        return false;
     }
-    serverAddress += ":" + serverPort;
+    if(response.has_error_response())
+    {
+        f_out_error = "error code " + std::to_string(response.error_response().error_code()) + ": " + response.error_response().error_message();
+        return false;
+    }
+    std::string files;
+    for(const std::string & file : response.file_descriptor_response().file_descriptor_proto())
+    {
+        files += file;
+    }
+    f_out_hash = std::hash<std::string>()(files);
+    return true;
+}
+
+/// Performs the RPC on all targets concurrently, using at most
+/// f_maxParallelCalls threads. The schema is not retrieved from every
+/// target. Instead, if f_verifySchema is set, every target is checked to
+/// define the service in the same files as the reference schema.
+/// @returns 0 if the RPC succeeded on all targets, -1 otherwise
+static int fanOut(const std::vector<std::string> & f_targets, size_t f_maxParallelCalls, bool f_verifySchema, size_t f_schemaHash, ParsedElement & f_parseTree, const grpc::protobuf::MethodDescriptor * f_method, google::protobuf::DynamicMessageFactory & f_dynamicFactory, const grpc::string & f_serializedRequest, const ReplyDecoding & f_decoding)
+{
+    std::atomic<size_t> nextTarget(0);
+    std::atomic<size_t> failedTargets(0);
+    uint32_t connectTimeoutMs = getConnectTimeoutMs(&f_parseTree);
 
+    // Ctrl-C cancels the running calls and skips the remaining targets:
+    InterruptScope interruptScope;
+    auto worker = [&]()
+    {
+        for(size_t i = nextTarget++; i < f_targets.size(); i = nextTarget++)
+        {
+            CallOutput output(f_targets[i]);
+            if(InterruptScope::isInterrupted())
+            {
+                output.err("Error: Interrupted -> skipping the call\n");
+                failedTargets++;
+                continue;
+            }
+            std::shared_ptr<grpc::Channel> channel = createChannel(f_targets[i], &f_parseTree);
+            if(not waitForChannelConnected(channel, connectTimeoutMs))
+            {
+                output.err("Error: channel connection attempt failed\n");
+                failedTargets++;
+                continue;
+            }
+            if(f_verifySchema)
+            {
+                size_t hash = 0;
+                std::string error;
+                if(not getSchemaHash(channel, f_method->service()->full_name(), hash, error))
+                {
+                    output.err("Error: Cannot verify schema: " + error + "\n");
+                    failedTargets++;
+                    continue;
+                }
+                if(hash != f_schemaHash)
+                {
+                    output.err("Error: Schema of service '" + f_method->service()->full_name() + "' differs from the schema of " + f_targets[0] + " -> skipping the call\n");
+                    failedTargets++;
+                    continue;
+                }
+            }
+            if(callOnChannel(channel, f_parseTree, f_method, f_dynamicFactory, f_serializedRequest, f_decoding, nullptr, output) != 0)
+            {
+                failedTargets++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < std::min(f_maxParallelCalls, f_targets.size()); i++)
+    {
+        threads.emplace_back(worker);
+    }
+    for(auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    std::cerr << (f_targets.size() - failedTargets) << " of " << f_targets.size() << " targets succeeded" << std::endl;
+    return (failedTargets == 0) ? 0 : -1;
+}
+
+int call(ParsedElement & parseTree)
+{
     std::string serviceName = parseTree.findFirstChild("Service");
     std::string methodName = parseTree.findFirstChild("Method");
     bool argsExist;
     ParsedElement & methodArgs = parseTree.findFirstSubTree("MethodArgs", argsExist);
 
-    std::shared_ptr<grpc::Channel> channel =
-        grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials());
+    if(not checkOptions(parseTree))
+    {
+        return -1;
+    }
 
+    std::vector<std::string> fanOutTargets;
+    if(not getFanOutTargets(parseTree, fanOutTargets))
+    {
+        return -1;
+    }
+    if( (not fanOutTargets.empty()) and (parseTree.findFirstChild("RecordFile") != "") )
+    {
+        std::cerr << "Error: Calls to multiple targets cannot be recorded" << std::endl;
+        return -1;
+    }
+
+    std::shared_ptr<grpc::Channel> channel = createChannel(&parseTree);
 
     if(not waitForChannelConnected(channel, getConnectTimeoutMs(&parseTree)))
     {
@@ -173,8 +905,12 @@ int call(ParsedElement & parseTree)
         return -1;
     }
 
-    grpc::ProtoReflectionDescriptorDatabase descDb(channel);
-    grpc::protobuf::DescriptorPool descPool(&descDb);
+    std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(&parseTree, channel);
+    if(descSource == nullptr)
+    {
+        return -1;
+    }
+    grpc::protobuf::DescriptorPool descPool(&descSource->getDatabase());
 
     const grpc::protobuf::ServiceDescriptor* service = descPool.FindServiceByName(serviceName);
     if(service == nullptr)
@@ -196,6 +932,76 @@ int call(ParsedElement & parseTree)
         return -1;
     }
 
+    // compile the reply filter once for all replies:
+    std::unique_ptr<ReplyFilter> filter;
+    bool filterRequested = false;
+    ParsedElement & filterTree = parseTree.findFirstSubTree("Filter", filterRequested);
+    if(filterRequested)
+    {
+        filter = std::unique_ptr<ReplyFilter>(new ReplyFilter());
+        std::string error;
+        if(not filter->compile(filterTree, method->output_type(), error))
+        {
+            std::cerr << "Error: Invalid filter: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    std::unique_ptr<ReplyAggregation> aggregation;
+    bool aggregationRequested = false;
+    ParsedElement & aggregationTree = parseTree.findFirstSubTree("Aggregation", aggregationRequested);
+    if(aggregationRequested)
+    {
+        aggregation = std::unique_ptr<ReplyAggregation>(new ReplyAggregation());
+        std::string error;
+        if(not aggregation->compile(aggregationTree, method->output_type(), error))
+        {
+            std::cerr << "Error: Invalid aggregation: " << error << std::endl;
+            return -1;
+        }
+    }
+
+    ReplyDecoding decoding;
+    decoding.filter = filter.get();
+    decoding.aggregation = aggregation.get();
+
+    // aggregations and custom output formats only use some fields, so only
+    // those are decoded:
+    std::unique_ptr<MessageProjection> projection;
+    bool customOutputFormatRequested = false;
+    ParsedElement & customFormatTree = parseTree.findFirstSubTree("CustomOutputFormat", customOutputFormatRequested);
+    if(aggregation)
+    {
+        projection = std::unique_ptr<MessageProjection>(new MessageProjection());
+        for(const auto & path : aggregation->getFieldPaths())
+        {
+            projection->addField(path);
+        }
+        if(filter)
+        {
+            for(const auto & path : filter->getFieldPaths())
+            {
+                projection->addField(path);
+            }
+        }
+        decoding.projection = projection.get();
+    }
+    else if(customOutputFormatRequested)
+    {
+        projection = std::unique_ptr<MessageProjection>(new MessageProjection());
+        if(addCustomFormatFields(customFormatTree, method->output_type(), *projection))
+        {
+            if(filter)
+            {
+                for(const auto & path : filter->getFieldPaths())
+                {
+                    projection->addField(path);
+                }
+            }
+            decoding.projection = projection.get();
+        }
+    }
+
     const grpc::protobuf::Descriptor* inputType = method->input_type();
 
     // now we have to construct a protobuf from the parsed argument, which corresponds to the inputType
@@ -206,20 +1012,46 @@ int call(ParsedElement & parseTree)
 
 
 
-    if(parseTree.findFirstChild("PrintParsedMessage") != "")
+    std::string inputFile = parseTree.findFirstChild("InputFile");
+    if( message and (inputFile != "") )
     {
-        // use built-in human readable output format
-        cli::OutputFormatter imessageFormatter;
-        std::cout << "Request message:" << std::endl <<  imessageFormatter.messageToString(*message, method->input_type(), "| ", "| " ) << std::endl;
+        // further field assignments are read from the input:
+        std::ifstream file;
+        if(inputFile != "-")
+        {
+            file.open(inputFile, std::ios::binary);
+            if(not file)
+            {
+                std::cerr << "Error: Cannot read input file '" << inputFile << "'" << std::endl;
+                return -1;
+            }
+        }
+        std::istream & input = (inputFile == "-") ? std::cin : file;
+        if( (not argsExist) or methodArgs.getChildren().empty() )
+        {
+            std::cerr << "Error: No grammar available for the arguments of method '" << methodName << "'" << std::endl;
+            return -1;
+        }
+        GrammarElement * fieldsGrammar = methodArgs.getChildren()[0]->getGrammarElement();
+        if(cli::parseMessageFields(input, fieldsGrammar, *message, dynamicFactory) != 0)
+        {
+            message.reset();
+        }
     }
 
-
     if(not message)
     {
         std::cerr << "Error: Error parsing method arguments -> aborting the call :-(" << std::endl;
         return -1;
     }
 
+    if(parseTree.findFirstChild("PrintParsedMessage") != "")
+    {
+        // use built-in human readable output format
+        cli::OutputFormatter imessageFormatter;
+        std::cout << "Request message:" << std::endl <<  imessageFormatter.messageToString(*message, method->input_type(), "| ", "| " ) << std::endl;
+    }
+
     // now we serialize the message:
     grpc::string serializedRequest;
     bool success = message->SerializeToString(&serializedRequest);
@@ -229,81 +1061,181 @@ int call(ParsedElement & parseTree)
         return -1;
     }
 
-    // now we do the actual RPC call:
-    std::multimap<grpc::string, grpc::string> clientMetadata;
-    grpc::string serializedResponse;
-    std::multimap<grpc::string_ref, grpc::string_ref> serverMetadataA;
-    std::multimap<grpc::string_ref, grpc::string_ref> serverMetadataB;
+    if(fanOutTargets.empty())
+    {
+        CallOutput output;
+        std::string recordFile = parseTree.findFirstChild("RecordFile");
+        if(recordFile == "")
+        {
+            return callOnChannel(channel, parseTree, method, dynamicFactory, serializedRequest, decoding, nullptr, output);
+        }
 
-    std::string methodStr =  "/" + serviceName + "/" + methodName;
-    grpc::testing::CliCall call(channel, methodStr, clientMetadata);
-    call.Write(serializedRequest);
-    call.WritesDone();
+        // the recording contains the schema of the method, so it can be
+        // decoded without the server:
+        google::protobuf::FileDescriptorSet descriptors;
+        RecordingWriter::addMethodDescriptors(method, descriptors);
+        RecordingWriter recorder;
+        std::string error;
+        bool append = (parseTree.findFirstChild("RecordAppend") != "");
+        if(not recorder.open(recordFile, descriptors, append, error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        int rc = callOnChannel(channel, parseTree, method, dynamicFactory, serializedRequest, decoding, &recorder, output);
+        if(not recorder.close(error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        return rc;
+    }
 
-    // In a loop we read reply data from the reply stream:
-    // NOTE: in gRPC every RPC can be considered "streaming". Non-streaming RPCs
-    //  merely return one reply message.
-    bool init = true;
-    for (init = true; call.Read(&serializedResponse, init ? &serverMetadataA : nullptr); init= false)
+    // the target given as server address is the first target and the
+    // reference for the schema of all others:
+    std::string serverPort = parseTree.findFirstChild("ServerPort");
+    fanOutTargets.insert(fanOutTargets.begin(), parseTree.findFirstChild("ServerAddress") + ":" + ((serverPort != "") ? serverPort : "50051"));
+
+    size_t schemaHash = 0;
+    bool verifySchema = descSource->usesReflection();
+    if(verifySchema)
+    {
+        std::string error;
+        if(not getSchemaHash(channel, serviceName, schemaHash, error))
+        {
+            std::cerr << "Error: Cannot retrieve schema of service '" << serviceName << "': " << error << std::endl;
+            return -1;
+        }
+    }
+
+    uint64_t maxParallelCalls = 16;
+    if(not getNumericOption(&parseTree, "Parallel", "--parallel=", SIZE_MAX, maxParallelCalls))
     {
-        // convert data received from stream into a message:
-        std::unique_ptr<grpc::protobuf::Message> replyMessage(dynamicFactory.GetPrototype(method->output_type())->New());
-        replyMessage->ParseFromString(serializedResponse);
+        return -1;
+    }
 
-        // print date/time of message reception:
-        std::cout << getTimeString();
-        std::cout << ": Received message:\n";
+    return fanOut(fanOutTargets, std::max<size_t>(1, maxParallelCalls), verifySchema, schemaHash, parseTree, method, dynamicFactory, serializedRequest, decoding);
+}
 
-        // print out string representation of the message:
-        std::string msgString;
+/// @returns local time of a recorded event with microseconds, e.g.
+///          "2019-05-03 14:02:11.123456"
+static std::string getRecordedTimeString(const Recording::Call & f_call, uint64_t f_timeNs)
+{
+    int64_t wallClockNs = f_call.wallClockStartNs + static_cast<int64_t>(f_timeNs - f_call.startTimeNs);
+    std::time_t t = wallClockNs / 1000000000;
+    char cstr[128];
+    size_t length = std::strftime(cstr, sizeof(cstr), "%Y-%m-%d %X", std::localtime(&t));
+    snprintf(cstr + length, sizeof(cstr) - length, ".%06d", static_cast<int>((wallClockNs % 1000000000) / 1000));
+    return cstr;
+}
 
-        // decide on message formatting method to use:
-        bool customOutputFormatRequested = false;
-        ParsedElement customFormatParseTree = parseTree.findFirstSubTree("CustomOutputFormat", customOutputFormatRequested);
-        if(not customOutputFormatRequested)
-        {
-            // use built-in human readable output format
-            cli::OutputFormatter messageFormatter;
+int printRecording(ParsedElement & f_parseTree)
+{
+    if(not checkOptions(f_parseTree))
+    {
+        return -1;
+    }
+    std::string fileName = f_parseTree.findFirstChild("PrintRecording");
+    Recording recording;
+    std::string error;
+    if(not recording.load(fileName, error))
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return -1;
+    }
+    if(not recording.hasIndex())
+    {
+        std::cerr << "Warning: The recording was not closed properly, it may be incomplete" << std::endl;
+    }
 
-            // disable colored output if explicitly specified:
-            if(parseTree.findFirstChild("NoColor") != "")
-            {
-                messageFormatter.clearColorMap();
-            }
+    google::protobuf::SimpleDescriptorDatabase database;
+    for(const grpc::protobuf::FileDescriptorProto & file : recording.getDescriptors().file())
+    {
+        database.Add(file);
+    }
+    grpc::protobuf::DescriptorPool descPool(&database);
+    google::protobuf::DynamicMessageFactory dynamicFactory;
 
-            // automatically disable colored output, when outputting to something
-            // else than a terminal (pipes, files, etc.), except we explicitly
-            // request color mode:
-            if((not isatty(fileno(stdout))) and (parseTree.findFirstChild("Color") == ""))
-            {
-                messageFormatter.clearColorMap();
-            }
+    bool customOutputFormatRequested = false;
+    ParsedElement & customFormatTree = f_parseTree.findFirstSubTree("CustomOutputFormat", customOutputFormatRequested);
+    ParsedElement * customFormatParseTree = customOutputFormatRequested ? &customFormatTree : nullptr;
+    cli::OutputFormatter messageFormatter;
+    configureFormatter(messageFormatter, f_parseTree);
 
-            msgString = messageFormatter.messageToString(*replyMessage, method->output_type(), "| ", "| " );
+    // replies are selected with --filter as in live calls. The filter is
+    // compiled once per method:
+    bool filterRequested = false;
+    ParsedElement & filterTree = f_parseTree.findFirstSubTree("Filter", filterRequested);
+    std::map<const grpc::protobuf::MethodDescriptor *, std::unique_ptr<ReplyFilter>> filters;
+    const std::vector<Recording::Call> & calls = recording.getCalls();
+    std::vector<const grpc::protobuf::MethodDescriptor *> methods;
+    for(const Recording::Call & call : calls)
+    {
+        const grpc::protobuf::MethodDescriptor * method = descPool.FindMethodByName(call.method);
+        if(method == nullptr)
+        {
+            std::cerr << "Error: Method '" << call.method << "' not found in the recording" << std::endl;
+            return -1;
         }
-        else
+        methods.push_back(method);
+        if( filterRequested and (filters.find(method) == filters.end()) )
         {
-            //std::cout << "using custom OutputFormatting\n";
-            //std::cout << customFormatParseTree.getDebugString();
-            // use user provided output format string
-            msgString = customMessageFormat(*replyMessage, method->output_type(), customFormatParseTree);
+            std::unique_ptr<ReplyFilter> filter(new ReplyFilter());
+            if(not filter->compile(filterTree, method->output_type(), error))
+            {
+                std::cerr << "Error: Invalid filter: " << error << std::endl;
+                return -1;
+            }
+            filters[method] = std::move(filter);
         }
-        std::cout  << msgString << std::endl;
     }
 
-    // reply stream finished -> finish the RPC:
-    grpc::Status status = call.Finish(&serverMetadataB);
-
-    if(not status.ok())
+    int result = 0;
+    for(size_t i = 0; i < calls.size(); i++)
     {
-        std::cerr << "RPC failed ;( Status code: " << std::to_string(status.error_code()) << ", error message: " << status.error_message() << std::endl;
-        return -1;
-    }
+        const Recording::Call & call = calls[i];
+        const grpc::protobuf::MethodDescriptor * method = methods[i];
+        const ReplyFilter * filter = filterRequested ? filters[method].get() : nullptr;
+        ReplyDecoding decoding;
+        decoding.filter = filter;
 
-    std::cout << "RPC succeeded :D" << std::endl;
+        std::cout << getRecordedTimeString(call, call.startTimeNs) << ": Call of " << call.method << std::endl;
+        std::unique_ptr<grpc::protobuf::Message> request(dynamicFactory.GetPrototype(method->input_type())->New());
+        request->ParseFromArray(call.request.data, call.request.size);
+        std::cout << "Request message:" << std::endl << messageFormatter.messageToString(*request, method->input_type(), "| ", "| ") << std::endl;
 
+        const grpc::protobuf::Message * replyPrototype = dynamicFactory.GetPrototype(method->output_type());
+        for(const Recording::Reply & reply : call.replies)
+        {
+            std::string serializedReply = reply.message.toString();
+            if( (filter != nullptr) and filter->rejectsSerialized(serializedReply) )
+            {
+                continue;
+            }
+            std::unique_ptr<grpc::protobuf::Message> replyMessage = decodeReply(*replyPrototype, serializedReply, decoding);
+            if(not replyMessage)
+            {
+                continue;
+            }
+            std::cout << formatReply(messageFormatter, *replyMessage, method->output_type(), customFormatParseTree, getRecordedTimeString(call, reply.timeNs));
+        }
 
-    return 0;
+        if(not call.finished)
+        {
+            std::cerr << "Error: The recording ended before the RPC finished" << std::endl;
+            result = -1;
+        }
+        else if(call.statusCode != grpc::StatusCode::OK)
+        {
+            std::cerr << "RPC failed ;( Status code: " << call.statusCode << ", error message: " << call.statusMessage << std::endl;
+            result = -1;
+        }
+        else
+        {
+            std::cout << "RPC succeeded :D" << std::endl;
+        }
+    }
+    return result;
 }
 
 }
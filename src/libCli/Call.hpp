@@ -22,4 +22,10 @@ namespace cli
     /// @param f_parseTree Parse tree containing all relevant information for the call (server address, request message, options, ...).
     /// @returns 0 if RPC succeeded, -1 otherwise (including parse errors from parse tree and gRPC bad return code)
     int call(ArgParse::ParsedElement & f_parseTree);
+
+    /// Prints the calls of a recording written with --record= (given with
+    /// --printRecording=) like live calls. Does not require a server.
+    /// @param f_parseTree Parse tree containing the file name and output options
+    /// @returns 0 if all recorded RPCs succeeded, -1 otherwise
+    int printRecording(ArgParse::ParsedElement & f_parseTree);
 }
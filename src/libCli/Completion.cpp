@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <libCli/Completion.hpp>
+#include <algorithm>
 
 using namespace ArgParse;
 
@@ -32,12 +33,12 @@ void printBashCompletions( std::vector<std::shared_ptr<ParsedElement> > & f_cand
         }
     }
 
-    //size_t n = parseTree.getMatchedString().size();
-    size_t n = f_args.size();
     for(auto candidate : f_candidates)
     {
         std::string candidateStr =candidate->getMatchedString();
         std::string suggestion;
+        // fuzzy completion candidates may be shorter than the input:
+        size_t n = std::min(f_args.size(), candidateStr.size());
         size_t start = n;
         size_t end;
         if(f_debug)
@@ -0,0 +1,418 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/DescriptorSource.hpp>
+#include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/descriptor_database.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#ifdef BUILD_CONFIG_HAVE_PROTOBUF_COMPILER
+#include <google/protobuf/compiler/importer.h>
+#endif
+
+#include <libCli/MappedFile.hpp>
+#include <libCli/SessionCache.hpp>
+#include <libCli/Snapshot.hpp>
+#include <libCli/cliUtils.hpp>
+
+#include <iostream>
+#include <set>
+#include <climits>
+
+using namespace ArgParse;
+using google::protobuf::internal::WireFormatLite;
+
+namespace cli
+{
+
+bool DescriptorSource::getMethods(const std::string & f_serviceName, std::vector<std::string> & f_out_methods)
+{
+    grpc::protobuf::DescriptorPool descPool(&getDatabase());
+    const grpc::protobuf::ServiceDescriptor * service = descPool.FindServiceByName(f_serviceName);
+    if(service == nullptr)
+    {
+        return false;
+    }
+    for(int i = 0; i < service->method_count(); ++i)
+    {
+        f_out_methods.push_back(service->method(i)->name());
+    }
+    return true;
+}
+
+/// Appends the fully qualified names of all services declared in a file.
+static void addServicesOfFile(const grpc::protobuf::FileDescriptorProto & f_file, std::vector<std::string> & f_out_services)
+{
+    for(auto & service : f_file.service())
+    {
+        if(f_file.package().empty())
+        {
+            f_out_services.push_back(service.name());
+        }
+        else
+        {
+            f_out_services.push_back(f_file.package() + "." + service.name());
+        }
+    }
+}
+
+/// Retrieves descriptors from the server via the reflection service.
+class ReflectionDescriptorSource : public DescriptorSource
+{
+    public:
+        explicit ReflectionDescriptorSource(std::shared_ptr<grpc::Channel> f_channel) :
+            m_database(f_channel)
+        {
+        }
+
+        virtual grpc::protobuf::DescriptorDatabase & getDatabase() override
+        {
+            return m_database;
+        }
+
+        virtual bool getServices(std::vector<std::string> & f_out_services) override
+        {
+            return m_database.GetServices(&f_out_services);
+        }
+
+        virtual bool usesReflection() const override
+        {
+            return true;
+        }
+
+    private:
+        grpc::ProtoReflectionDescriptorDatabase m_database;
+};
+
+/// Loads descriptors from a serialized FileDescriptorSet, as written by
+/// `protoc --include_imports --descriptor_set_out=FILE`.
+/// The file is memory mapped and only indexed on load. FileDescriptorProtos
+/// are parsed directly from the mapping on lookup, so only files actually
+/// needed are deserialized.
+class ProtosetDescriptorSource : public DescriptorSource
+{
+    public:
+        /// Maps and indexes the given file.
+        /// @returns false on error
+        bool load(const std::string & f_fileName)
+        {
+            std::string error;
+            if(not m_file.map(f_fileName, error))
+            {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
+            if( (m_file.size() > INT_MAX) or (not index()) )
+            {
+                std::cerr << "Error: '" << f_fileName << "' is not a valid FileDescriptorSet" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        virtual grpc::protobuf::DescriptorDatabase & getDatabase() override
+        {
+            return m_database;
+        }
+
+        virtual bool getServices(std::vector<std::string> & f_out_services) override
+        {
+            std::vector<std::string> fileNames;
+            if(not m_database.FindAllFileNames(&fileNames))
+            {
+                return false;
+            }
+            for(auto & fileName : fileNames)
+            {
+                grpc::protobuf::FileDescriptorProto file;
+                if(m_database.FindFileByName(fileName, &file))
+                {
+                    addServicesOfFile(file, f_out_services);
+                }
+            }
+            return true;
+        }
+
+        virtual bool usesReflection() const override
+        {
+            return false;
+        }
+
+    private:
+        /// Registers each serialized FileDescriptorProto contained in the
+        /// mapped FileDescriptorSet with the database, without parsing it.
+        bool index()
+        {
+            const uint32_t fileTag = WireFormatLite::MakeTag(
+                    google::protobuf::FileDescriptorSet::kFileFieldNumber,
+                    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+            google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t *>(m_file.data()), static_cast<int>(m_file.size()));
+            uint32_t tag;
+            while((tag = input.ReadTag()) != 0)
+            {
+                if(tag != fileTag)
+                {
+                    if(not WireFormatLite::SkipField(&input, tag))
+                    {
+                        return false;
+                    }
+                    continue;
+                }
+
+                uint32_t length;
+                const void * file;
+                int available;
+                if( (not input.ReadVarint32(&length)) or (not input.GetDirectBufferPointer(&file, &available)) or (static_cast<uint32_t>(available) < length) )
+                {
+                    return false;
+                }
+                // data is referenced, not copied: the mapping has to outlive m_database
+                if(not m_database.Add(file, length))
+                {
+                    return false;
+                }
+                input.Skip(length);
+            }
+            return (static_cast<size_t>(input.CurrentPosition()) == m_file.size());
+        }
+
+        // declared before m_database, as the database references the mapped data:
+        MappedFile m_file;
+        google::protobuf::EncodedDescriptorDatabase m_database;
+};
+
+#ifdef BUILD_CONFIG_HAVE_PROTOBUF_COMPILER
+/// Prints errors found while parsing .proto files to stderr.
+class StderrErrorCollector : public google::protobuf::compiler::MultiFileErrorCollector
+{
+    public:
+        virtual void AddError(const std::string & f_fileName, int f_line, int f_column, const std::string & f_message) override
+        {
+            if(f_line < 0)
+            {
+                std::cerr << f_fileName << ": error: " << f_message << std::endl;
+            }
+            else
+            {
+                std::cerr << f_fileName << ":" << f_line+1 << ":" << f_column+1 << ": error: " << f_message << std::endl;
+            }
+        }
+};
+
+/// Parses .proto files using the protobuf compiler.
+/// Imports are resolved relative to the given proto paths and parsed lazily,
+/// when requested by the DescriptorPool.
+class ProtoFileDescriptorSource : public DescriptorSource
+{
+    public:
+        ProtoFileDescriptorSource(const std::vector<std::string> & f_protoPaths) :
+            m_sourceTreeDatabase(&m_sourceTree),
+            m_database(&m_parsedFiles, &m_sourceTreeDatabase)
+        {
+            for(auto & protoPath : f_protoPaths)
+            {
+                m_sourceTree.MapPath("", protoPath);
+            }
+            if(f_protoPaths.empty())
+            {
+                m_sourceTree.MapPath("", ".");
+            }
+            m_sourceTreeDatabase.RecordErrorsTo(&m_errorCollector);
+        }
+
+        /// Parses the given .proto files (relative to the proto paths).
+        /// @returns false on error
+        bool load(const std::vector<std::string> & f_protoFiles)
+        {
+            std::set<std::string> loaded;
+            for(auto & protoFile : f_protoFiles)
+            {
+                grpc::protobuf::FileDescriptorProto file;
+                if(not m_sourceTreeDatabase.FindFileByName(protoFile, &file))
+                {
+                    std::cerr << "Error: Cannot load proto file '" << protoFile << "'" << std::endl;
+                    return false;
+                }
+                if(not loaded.insert(file.name()).second)
+                {
+                    continue;
+                }
+                // The source tree database cannot look up symbols. Parsed
+                // files are kept, so services and types declared in them can
+                // be found by name:
+                m_parsedFiles.Add(file);
+                addServicesOfFile(file, m_services);
+            }
+            return true;
+        }
+
+        virtual grpc::protobuf::DescriptorDatabase & getDatabase() override
+        {
+            return m_database;
+        }
+
+        virtual bool getServices(std::vector<std::string> & f_out_services) override
+        {
+            f_out_services.insert(f_out_services.end(), m_services.begin(), m_services.end());
+            return true;
+        }
+
+        virtual bool usesReflection() const override
+        {
+            return false;
+        }
+
+    private:
+        google::protobuf::compiler::DiskSourceTree m_sourceTree;
+        StderrErrorCollector m_errorCollector;
+        google::protobuf::compiler::SourceTreeDescriptorDatabase m_sourceTreeDatabase;
+        google::protobuf::SimpleDescriptorDatabase m_parsedFiles;
+        google::protobuf::MergedDescriptorDatabase m_database;
+        std::vector<std::string> m_services;
+};
+#endif
+
+/// Creates the descriptor source selected by the options in the parse tree
+/// (see createDescriptorSource()), without cache.
+static std::unique_ptr<DescriptorSource> loadDescriptorSource(ParsedElement * f_parseTree, std::shared_ptr<grpc::Channel> f_channel)
+{
+    std::string protoset = f_parseTree->findFirstChild("Protoset");
+    std::vector<std::string> protoFiles = findAllOptionValues(f_parseTree, "ProtoFile");
+    std::string snapshot = f_parseTree->findFirstChild("Snapshot");
+
+    if( int(protoset != "") + int(not protoFiles.empty()) + int(snapshot != "") > 1 )
+    {
+        std::cerr << "Error: Only one of --protoset, --proto and --snapshot may be given" << std::endl;
+        return nullptr;
+    }
+
+    if(snapshot != "")
+    {
+        return loadSnapshot(snapshot);
+    }
+
+    if(protoset != "")
+    {
+        std::unique_ptr<ProtosetDescriptorSource> source(new ProtosetDescriptorSource());
+        if(not source->load(protoset))
+        {
+            return nullptr;
+        }
+        return source;
+    }
+
+    if(not protoFiles.empty())
+    {
+#ifdef BUILD_CONFIG_HAVE_PROTOBUF_COMPILER
+        std::unique_ptr<ProtoFileDescriptorSource> source(new ProtoFileDescriptorSource(findAllOptionValues(f_parseTree, "ProtoPath")));
+        if(not source->load(protoFiles))
+        {
+            return nullptr;
+        }
+        return source;
+#else
+        std::cerr << "Error: --proto is not supported, gWhisper was built without the protobuf compiler headers. Use --protoset instead." << std::endl;
+        return nullptr;
+#endif
+    }
+
+    return std::unique_ptr<DescriptorSource>(new ReflectionDescriptorSource(f_channel));
+}
+
+
+/// Refers to a descriptor source kept by the session cache.
+class SharedDescriptorSource : public DescriptorSource
+{
+    public:
+        explicit SharedDescriptorSource(std::shared_ptr<DescriptorSource> f_source) :
+            m_source(f_source)
+        {
+        }
+
+        virtual grpc::protobuf::DescriptorDatabase & getDatabase() override
+        {
+            return m_source->getDatabase();
+        }
+
+        virtual bool getServices(std::vector<std::string> & f_out_services) override
+        {
+            return m_source->getServices(f_out_services);
+        }
+
+        virtual bool getMethods(const std::string & f_serviceName, std::vector<std::string> & f_out_methods) override
+        {
+            return m_source->getMethods(f_serviceName, f_out_methods);
+        }
+
+        virtual bool usesReflection() const override
+        {
+            return m_source->usesReflection();
+        }
+
+    private:
+        std::shared_ptr<DescriptorSource> m_source;
+};
+
+std::string getLocalSchemaOptions(ParsedElement * f_parseTree)
+{
+    std::string result;
+    std::string protoset = f_parseTree->findFirstChild("Protoset");
+    if(protoset != "")
+    {
+        result += " --protoset=" + protoset;
+    }
+    for(auto & protoPath : findAllOptionValues(f_parseTree, "ProtoPath"))
+    {
+        result += " --proto_path=" + protoPath;
+    }
+    for(auto & protoFile : findAllOptionValues(f_parseTree, "ProtoFile"))
+    {
+        result += " --proto=" + protoFile;
+    }
+    std::string snapshot = f_parseTree->findFirstChild("Snapshot");
+    if(snapshot != "")
+    {
+        result += " --snapshot=" + snapshot;
+    }
+    return result;
+}
+
+std::unique_ptr<DescriptorSource> createDescriptorSource(ParsedElement * f_parseTree, std::shared_ptr<grpc::Channel> f_channel)
+{
+    SessionCache * cache = SessionCache::getActive();
+    if(cache == nullptr)
+    {
+        return loadDescriptorSource(f_parseTree, f_channel);
+    }
+
+    // local schemas are identified by their options, reflection by the
+    // (cached) channel:
+    std::string key = getLocalSchemaOptions(f_parseTree);
+    std::shared_ptr<grpc::Channel> channel;
+    if(key == "")
+    {
+        channel = f_channel;
+        key = "reflection " + std::to_string(reinterpret_cast<uintptr_t>(f_channel.get()));
+    }
+    std::shared_ptr<DescriptorSource> source = cache->getDescriptorSource(key, channel, [&]{ return loadDescriptorSource(f_parseTree, f_channel); });
+    if(source == nullptr)
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<DescriptorSource>(new SharedDescriptorSource(source));
+}
+
+}
@@ -0,0 +1,72 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+#include <grpc++/channel.h>
+#include <grpcpp/impl/codegen/config_protobuf.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cli
+{
+    /// Provides protobuf descriptors (services, methods and message types) for
+    /// grammar construction and RPC calls.
+    /// Descriptors are either retrieved from the server via reflection, or
+    /// loaded from local schema files, in which case no reflection requests
+    /// are sent to the server at all (see --protoset, --proto_path and --proto).
+    class DescriptorSource
+    {
+        public:
+            virtual ~DescriptorSource()
+            {
+            }
+
+            /// @returns database which may be used to back a DescriptorPool.
+            virtual grpc::protobuf::DescriptorDatabase & getDatabase() = 0;
+
+            /// Retrieves fully qualified names of all services.
+            /// @param f_out_services service names are appended to this vector
+            /// @returns false on error
+            virtual bool getServices(std::vector<std::string> & f_out_services) = 0;
+
+            /// Retrieves names of all methods of a service.
+            /// The default implementation looks the service up in a
+            /// DescriptorPool backed by getDatabase().
+            /// @param f_serviceName fully qualified service name
+            /// @param f_out_methods method names are appended to this vector
+            /// @returns false if the service does not exist
+            virtual bool getMethods(const std::string & f_serviceName, std::vector<std::string> & f_out_methods);
+
+            /// @returns true if descriptors are retrieved from the server, so a
+            ///          connected channel is required.
+            virtual bool usesReflection() const = 0;
+    };
+
+    /// Creates the descriptor source selected by the options in the parse tree.
+    /// Within a session (see SessionCache), sources are created once per
+    /// schema and shared by all callers.
+    /// Errors loading local schema files are printed to stderr.
+    /// @param f_parseTree parse tree containing the options
+    /// @param f_channel channel used for reflection, if no local schema is given
+    /// @returns nullptr if local schema files could not be loaded
+    std::unique_ptr<DescriptorSource> createDescriptorSource(ArgParse::ParsedElement * f_parseTree, std::shared_ptr<grpc::Channel> f_channel);
+
+    /// @returns the options selecting a local schema (e.g. " --protoset=FILE"),
+    ///          empty if descriptors are retrieved via reflection
+    std::string getLocalSchemaOptions(ArgParse::ParsedElement * f_parseTree);
+}
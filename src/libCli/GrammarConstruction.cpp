@@ -16,18 +16,29 @@
 #include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
 
 #include <libCli/cliUtils.hpp>
+#include <libCli/DescriptorSource.hpp>
 
 using namespace ArgParse;
 
 namespace cli
 {
 
+/// @returns identification of the schema grammar is injected from, and of
+///          options changing the injected grammar
+static std::string getSchemaKey(ParsedElement * f_parseTree)
+{
+    return f_parseTree->findFirstChild("ServerAddress") + ":" + f_parseTree->findFirstChild("ServerPort")
+        + getLocalSchemaOptions(f_parseTree)
+        + " " + f_parseTree->findFirstChild("FuzzyComplete");
+}
+
 class GrammarInjectorMethodArgs : public GrammarInjector
 {
     public:
         GrammarInjectorMethodArgs(Grammar & f_grammar, const std::string & f_elementName = "") :
             GrammarInjector("MethodArgs", f_elementName),
-            m_grammar(f_grammar)
+            m_grammar(f_grammar),
+            m_fuzzyCompletion(false)
         {
         }
 
@@ -35,33 +46,42 @@ class GrammarInjectorMethodArgs : public GrammarInjector
         {
         }
 
+        virtual std::string getGrammarKey(ParsedElement * f_parseTree) override
+        {
+            return getSchemaKey(f_parseTree)
+                + " " + f_parseTree->findFirstChild("Service")
+                + " " + f_parseTree->findFirstChild("Method")
+                + " " + f_parseTree->findFirstChild("ServeAddress");
+        }
+
         virtual GrammarElement * getGrammar(ParsedElement * f_parseTree) override
         {
-            // FIXME: we are already completing this without a service parsed.
-            //  this works in most cases, as it will just fail. however this is not really a nice thing.
-            std::string serverAddress = f_parseTree->findFirstChild("ServerAddress");
-            std::string serverPort = f_parseTree->findFirstChild("ServerPort");
             std::string serviceName = f_parseTree->findFirstChild("Service");
             std::string methodName = f_parseTree->findFirstChild("Method");
+            m_fuzzyCompletion = (f_parseTree->findFirstChild("FuzzyComplete") != "");
+            if( (serviceName == "") or (methodName == "") )
+            {
+                // Happens while method candidates are explored. Do not even
+                // connect, as loading descriptors may be expensive.
+                return nullptr;
+            }
 
             //std::cout << f_parseTree->getDebugString() << std::endl;
             //std::cout << "Injecting grammar for " << serverAddress << ":" << serverPort << " " << serviceName << " " << methodName << std::endl;
-            if(serverPort == "")
+            std::shared_ptr<grpc::Channel> channel = createChannel(f_parseTree);
+
+            std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(f_parseTree, channel);
+            if(descSource == nullptr)
             {
-                serverPort = "50051";
+                return nullptr;
             }
-            serverAddress += ":" + serverPort;
-            //std::cout << "Server addr: " << serverAddress << std::endl;
-            std::shared_ptr<grpc::Channel> channel =
-                grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials());
 
-            if(not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
+            if(descSource->usesReflection() and not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
             {
                 return nullptr;
             }
 
-            grpc::ProtoReflectionDescriptorDatabase descDb(channel);
-            grpc::protobuf::DescriptorPool descPool(&descDb);
+            grpc::protobuf::DescriptorPool descPool(&descSource->getDatabase());
 
             const grpc::protobuf::ServiceDescriptor* service = descPool.FindServiceByName(serviceName);
             if(service == nullptr)
@@ -77,7 +97,10 @@ class GrammarInjectorMethodArgs : public GrammarInjector
                 return nullptr;
             }
 
-            if(method->client_streaming())
+            // the mock server (--serve=) takes the arguments as reply:
+            bool serving = (f_parseTree->findFirstChild("ServeAddress") != "");
+
+            if(method->client_streaming() and not serving)
             {
                 std::cerr << "Error: Client streaming RPCs not supported." << std::endl;
                 return nullptr;
@@ -91,12 +114,17 @@ class GrammarInjectorMethodArgs : public GrammarInjector
             //separation->addChild(m_grammar.createElement<FixedString>(","));
             concat->addChild(separation);
 
-            auto fields = getMessageGrammar(method->input_type());
+            auto fields = getMessageGrammar(serving ? method->output_type() : method->input_type());
             concat->addChild(fields);
 
             auto result = m_grammar.createElement<Repetition>("Fields");
             result->addChild(concat);
 
+            // Descriptors are owned by descPool, which goes out of scope here.
+            // Cached pointers must not outlive it:
+            m_messageGrammarCache.clear();
+            m_messageGrammarsInConstruction.clear();
+
             return result;
         };
 
@@ -132,23 +160,38 @@ class GrammarInjectorMethodArgs : public GrammarInjector
                 case grpc::protobuf::FieldDescriptor::CppType::CPPTYPE_ENUM:
                     {
                         const google::protobuf::EnumDescriptor * enumDesc = f_field->enum_type();
-                        auto enumGrammar = m_grammar.createElement<Alternation>("FieldValue");
+                        std::vector<std::string> enumValueNames;
                         for(int i = 0; i<enumDesc->value_count(); i++)
                         {
                             const google::protobuf::EnumValueDescriptor * enumValueDesc = enumDesc->value(i);
                             // FIXME: null possible?
-                            enumGrammar->addChild(m_grammar.createElement<FixedString>(enumValueDesc->name()));
+                            enumValueNames.push_back(enumValueDesc->name());
+                        }
+                        KeywordSet * enumValues = m_grammar.createElement<KeywordSet>(enumValueNames, "FieldValue");
+                        if(m_fuzzyCompletion)
+                        {
+                            enumValues->enableFuzzyCompletion();
                         }
-                        f_fieldGrammar->addChild(enumGrammar);
+                        f_fieldGrammar->addChild(enumValues);
                         break;
                     }
                 case grpc::protobuf::FieldDescriptor::CppType::CPPTYPE_STRING:
                     if(f_field->type() == grpc::protobuf::FieldDescriptor::Type::TYPE_BYTES)
                     {
-                        auto bytesContainer = m_grammar.createElement<Concatenation>("FieldValue");
-                        bytesContainer->addChild(m_grammar.createElement<FixedString>("0x"));
-                        bytesContainer->addChild(m_grammar.createElement<RegEx>("[0-9a-fA-F]*", ""));
-                        f_fieldGrammar->addChild(bytesContainer);
+                        auto bytesAlt = m_grammar.createElement<Alternation>("FieldValue");
+                        auto hexValue = m_grammar.createElement<Concatenation>();
+                        hexValue->addChild(m_grammar.createElement<FixedString>("0x"));
+                        hexValue->addChild(m_grammar.createElement<RegEx>("[0-9a-fA-F]*", ""));
+                        bytesAlt->addChild(hexValue);
+                        auto base64Value = m_grammar.createElement<Concatenation>();
+                        base64Value->addChild(m_grammar.createElement<FixedString>("base64:"));
+                        base64Value->addChild(m_grammar.createElement<RegEx>("[A-Za-z0-9+/_=-]*", ""));
+                        bytesAlt->addChild(base64Value);
+                        auto fileValue = m_grammar.createElement<Concatenation>();
+                        fileValue->addChild(m_grammar.createElement<FixedString>("@"));
+                        fileValue->addChild(m_grammar.createElement<RegEx>("[^ ,:]+", ""));
+                        bytesAlt->addChild(fileValue);
+                        f_fieldGrammar->addChild(bytesAlt);
                     }
                     else
                     {
@@ -198,9 +241,31 @@ class GrammarInjectorMethodArgs : public GrammarInjector
             }
         }
 
+        /// Returns the field alternation grammar for the given message type.
+        /// Grammar for a message type is only constructed once per injection.
+        /// All fields referencing the same message type share this grammar,
+        /// i.e. the resulting grammar is a DAG and not a tree. This is fine, as
+        /// grammar elements do not keep any per-parse state (RecursiveReference
+        /// keeps its recursion guard on the call stack of the parse).
+        /// Recursive message types (directly or indirectly containing
+        /// themselves) are expressed as cycles via RecursiveReference.
         GrammarElement * getMessageGrammar(const grpc::protobuf::Descriptor* f_messageDescriptor)
         {
+            auto cachedGrammar = m_messageGrammarCache.find(f_messageDescriptor);
+            if(cachedGrammar != m_messageGrammarCache.end())
+            {
+                if(m_messageGrammarsInConstruction.count(f_messageDescriptor) > 0)
+                {
+                    // we are part of the grammar of this very message type
+                    // -> refer back instead of expanding again
+                    return m_grammar.createElement<RecursiveReference>(cachedGrammar->second);
+                }
+                return cachedGrammar->second;
+            }
+
             auto fields = m_grammar.createElement<Alternation>();
+            m_messageGrammarCache[f_messageDescriptor] = fields;
+            m_messageGrammarsInConstruction.insert(f_messageDescriptor);
             // iterate over fields:
             for(int i = 0; i< f_messageDescriptor->field_count(); i++)
             {
@@ -244,6 +309,7 @@ class GrammarInjectorMethodArgs : public GrammarInjector
             }
 
             //std::cout << "Grammar generated:\n" << fields->toString() << std::endl;
+            m_messageGrammarsInConstruction.erase(f_messageDescriptor);
             return fields;
         }
 
@@ -251,6 +317,16 @@ class GrammarInjectorMethodArgs : public GrammarInjector
 
         Grammar & m_grammar;
 
+        /// Maps message types to their already constructed field alternation.
+        /// Only valid during a single getGrammar() call.
+        std::map<const grpc::protobuf::Descriptor *, GrammarElement *> m_messageGrammarCache;
+
+        /// Message types for which grammar construction is currently ongoing.
+        std::set<const grpc::protobuf::Descriptor *> m_messageGrammarsInConstruction;
+
+        /// Whether fuzzy completion is enabled for enum values.
+        bool m_fuzzyCompletion;
+
 };
 
 class GrammarInjectorMethods : public GrammarInjector
@@ -262,49 +338,46 @@ class GrammarInjectorMethods : public GrammarInjector
         {
         }
 
+        virtual std::string getGrammarKey(ParsedElement * f_parseTree) override
+        {
+            return getSchemaKey(f_parseTree) + " " + f_parseTree->findFirstChild("Service");
+        }
+
         virtual GrammarElement * getGrammar(ParsedElement * f_parseTree) override
         {
-            // FIXME: we are already completing this without a service parsed.
-            //  this works in most cases, as it will just fail. however this is not really a nice thing.
-            std::string serverAddress = f_parseTree->findFirstChild("ServerAddress");
-            std::string serverPort = f_parseTree->findFirstChild("ServerPort");
             std::string serviceName = f_parseTree->findFirstChild("Service");
+            if(serviceName == "")
+            {
+                return nullptr;
+            }
 
             //std::cout << f_parseTree->getDebugString() << std::endl;
             //std::cout << "Injecting grammar for " << serverAddress << ":" << serverPort << " " << serviceName << std::endl;
-            if(serverPort == "")
-            {
-                serverPort = "50051";
-            }
-            serverAddress += ":" + serverPort;
-            //std::cout << "Server addr: " << serverAddress << std::endl;
-            std::shared_ptr<grpc::Channel> channel =
-                grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials());
+            std::shared_ptr<grpc::Channel> channel = createChannel(f_parseTree);
 
 
-            if(not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
+            std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(f_parseTree, channel);
+            if(descSource == nullptr)
             {
                 return nullptr;
             }
 
-            grpc::ProtoReflectionDescriptorDatabase descDb(channel);
-            grpc::protobuf::DescriptorPool descPool(&descDb);
-
-            const grpc::protobuf::ServiceDescriptor* service = descPool.FindServiceByName(serviceName);
-
-            auto result = m_grammar.createElement<Alternation>();
-            if(service != nullptr)
+            if(descSource->usesReflection() and not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
             {
-                for (int i = 0; i < service->method_count(); ++i)
-                {
-                    result->addChild(m_grammar.createElement<FixedString>(service->method(i)->name()));
-                }
+                return nullptr;
             }
-            else
+
+            std::vector<std::string> methodNames;
+            if(not descSource->getMethods(serviceName, methodNames))
             {
                 return nullptr;
             }
-            return result;
+            KeywordSet * methods = m_grammar.createElement<KeywordSet>(methodNames);
+            if(f_parseTree->findFirstChild("FuzzyComplete") != "")
+            {
+                methods->enableFuzzyCompletion();
+            }
+            return methods;
         };
 
     private:
@@ -325,41 +398,40 @@ class GrammarInjectorServices : public GrammarInjector
         {
         }
 
+        virtual std::string getGrammarKey(ParsedElement * f_parseTree) override
+        {
+            return getSchemaKey(f_parseTree);
+        }
+
         virtual GrammarElement * getGrammar(ParsedElement * f_parseTree) override
         {
-            std::string serverAddress = f_parseTree->findFirstChild("ServerAddress");
-            std::string serverPort = f_parseTree->findFirstChild("ServerPort");
-            if(serverPort == "")
-            {
-                serverPort = "50051";
-            }
-            serverAddress += ":" + serverPort;
-            //std::cout << "Server addr: " << serverAddress << std::endl;
-            std::shared_ptr<grpc::Channel> channel =
-                grpc::CreateChannel(serverAddress, grpc::InsecureChannelCredentials());
+            std::shared_ptr<grpc::Channel> channel = createChannel(f_parseTree);
 
 
-            if(not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
+            std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(f_parseTree, channel);
+            if(descSource == nullptr)
             {
                 return nullptr;
             }
 
-            grpc::ProtoReflectionDescriptorDatabase descDb(channel);
+            if(descSource->usesReflection() and not waitForChannelConnected(channel, getConnectTimeoutMs(f_parseTree)))
+            {
+                return nullptr;
+            }
 
             std::vector<grpc::string> serviceList;
-            if(not descDb.GetServices(&serviceList) )
+            if(not descSource->getServices(serviceList) )
             {
                 printf("error retrieving service list\n");
                 return nullptr;
             }
 
-            auto result = m_grammar.createElement<Alternation>();
-            for(auto service : serviceList)
+            KeywordSet * services = m_grammar.createElement<KeywordSet>(serviceList);
+            if(f_parseTree->findFirstChild("FuzzyComplete") != "")
             {
-
-                result->addChild(m_grammar.createElement<FixedString>(service));
+                services->enableFuzzyCompletion();
             }
-            return result;
+            return services;
         };
 
     private:
@@ -367,6 +439,79 @@ class GrammarInjectorServices : public GrammarInjector
 
 };
 
+GrammarElement * constructFilterGrammar(Grammar & f_grammarPool)
+{
+    GrammarElement * filterCondition = f_grammarPool.createElement<Concatenation>("FilterCondition");
+    filterCondition->addChild(f_grammarPool.createElement<RegEx>("[A-Za-z_][A-Za-z0-9_.]*", "FilterField"));
+    filterCondition->addChild(f_grammarPool.createElement<WhiteSpace>());
+    GrammarElement * filterOperator = f_grammarPool.createElement<Alternation>("FilterOperator");
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>("=="));
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>("!="));
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>("<="));
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>(">="));
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>("<"));
+    filterOperator->addChild(f_grammarPool.createElement<FixedString>(">"));
+    filterCondition->addChild(filterOperator);
+    filterCondition->addChild(f_grammarPool.createElement<WhiteSpace>());
+    GrammarElement * filterValue = f_grammarPool.createElement<Alternation>("FilterValue");
+    filterValue->addChild(f_grammarPool.createElement<RegEx>("\"[^\"]*\""));
+    filterValue->addChild(f_grammarPool.createElement<RegEx>("[^ \"]+"));
+    filterCondition->addChild(filterValue);
+    GrammarElement * filterConnection = f_grammarPool.createElement<Concatenation>();
+    filterConnection->addChild(f_grammarPool.createElement<WhiteSpace>());
+    GrammarElement * filterConnector = f_grammarPool.createElement<Alternation>("FilterConnector");
+    filterConnector->addChild(f_grammarPool.createElement<FixedString>("&&"));
+    filterConnector->addChild(f_grammarPool.createElement<FixedString>("||"));
+    filterConnection->addChild(filterConnector);
+    filterConnection->addChild(f_grammarPool.createElement<WhiteSpace>());
+    filterConnection->addChild(filterCondition);
+    GrammarElement * filterConnections = f_grammarPool.createElement<Repetition>();
+    filterConnections->addChild(filterConnection);
+    GrammarElement * filterExpression = f_grammarPool.createElement<Concatenation>("Filter");
+    filterExpression->addChild(filterCondition);
+    filterExpression->addChild(filterConnections);
+    return filterExpression;
+}
+
+GrammarElement * constructAggregationGrammar(Grammar & f_grammarPool)
+{
+    GrammarElement * aggregate = f_grammarPool.createElement<Concatenation>("Aggregate");
+    GrammarElement * aggregateFunction = f_grammarPool.createElement<Alternation>("AggregateFunction");
+    aggregateFunction->addChild(f_grammarPool.createElement<FixedString>("count"));
+    aggregateFunction->addChild(f_grammarPool.createElement<FixedString>("sum"));
+    aggregateFunction->addChild(f_grammarPool.createElement<FixedString>("min"));
+    aggregateFunction->addChild(f_grammarPool.createElement<FixedString>("max"));
+    aggregateFunction->addChild(f_grammarPool.createElement<FixedString>("avg"));
+    aggregate->addChild(aggregateFunction);
+    aggregate->addChild(f_grammarPool.createElement<FixedString>("("));
+    aggregate->addChild(f_grammarPool.createElement<RegEx>("[A-Za-z0-9_.]*", "AggregateField"));
+    aggregate->addChild(f_grammarPool.createElement<FixedString>(")"));
+    GrammarElement * furtherAggregate = f_grammarPool.createElement<Concatenation>();
+    furtherAggregate->addChild(f_grammarPool.createElement<RegEx>(", *"));
+    furtherAggregate->addChild(aggregate);
+    GrammarElement * furtherAggregates = f_grammarPool.createElement<Repetition>();
+    furtherAggregates->addChild(furtherAggregate);
+    GrammarElement * groupField = f_grammarPool.createElement<RegEx>("[A-Za-z_][A-Za-z0-9_.]*", "AggregateGroupField");
+    GrammarElement * furtherGroupField = f_grammarPool.createElement<Concatenation>();
+    furtherGroupField->addChild(f_grammarPool.createElement<RegEx>(", *"));
+    furtherGroupField->addChild(groupField);
+    GrammarElement * furtherGroupFields = f_grammarPool.createElement<Repetition>();
+    furtherGroupFields->addChild(furtherGroupField);
+    GrammarElement * groupBy = f_grammarPool.createElement<Concatenation>();
+    groupBy->addChild(f_grammarPool.createElement<WhiteSpace>());
+    groupBy->addChild(f_grammarPool.createElement<FixedString>("by"));
+    groupBy->addChild(f_grammarPool.createElement<WhiteSpace>());
+    groupBy->addChild(groupField);
+    groupBy->addChild(furtherGroupFields);
+    GrammarElement * optionalGroupBy = f_grammarPool.createElement<Optional>();
+    optionalGroupBy->addChild(groupBy);
+    GrammarElement * aggregation = f_grammarPool.createElement<Concatenation>("Aggregation");
+    aggregation->addChild(aggregate);
+    aggregation->addChild(furtherAggregates);
+    aggregation->addChild(optionalGroupBy);
+    return aggregation;
+}
+
 GrammarElement * constructGrammar(Grammar & f_grammarPool)
 {
     // user defined output formatting
@@ -411,6 +556,17 @@ GrammarElement * constructGrammar(Grammar & f_grammarPool)
     customOutputFormat->addChild(formatTargetSpecifier);
     // TODO add this to options
 
+    // reply filter, e.g. "a.x == 5 && label != \"foo\"":
+    GrammarElement * filterOption = f_grammarPool.createElement<Concatenation>();
+    filterOption->addChild(f_grammarPool.createElement<FixedString>("--filter"));
+    filterOption->addChild(f_grammarPool.createElement<WhiteSpace>());
+    filterOption->addChild(constructFilterGrammar(f_grammarPool));
+
+    GrammarElement * aggregateOption = f_grammarPool.createElement<Concatenation>();
+    aggregateOption->addChild(f_grammarPool.createElement<FixedString>("--aggregate"));
+    aggregateOption->addChild(f_grammarPool.createElement<WhiteSpace>());
+    aggregateOption->addChild(constructAggregationGrammar(f_grammarPool));
+
     // options
     GrammarElement * options = f_grammarPool.createElement<Repetition>(); // TODO: support multiple options
     GrammarElement * optionsconcat = f_grammarPool.createElement<Concatenation>();
@@ -419,16 +575,124 @@ GrammarElement * constructGrammar(Grammar & f_grammarPool)
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--help", "Help"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--complete", "Complete"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--debugComplete", "CompleteDebug"));
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--fuzzyComplete", "FuzzyComplete"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--dot", "DotExport"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--noColor", "NoColor"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--color", "Color"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--version", "Version"));
     optionsalt->addChild(f_grammarPool.createElement<FixedString>("--printParsedMessage", "PrintParsedMessage"));
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--proxy", "Proxy"));
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--noProxy", "NoProxy"));
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--shell", "Shell"));
+    GrammarElement * protosetOption = f_grammarPool.createElement<Concatenation>();
+    protosetOption->addChild(f_grammarPool.createElement<FixedString>("--protoset="));
+    protosetOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "Protoset"));
+    optionsalt->addChild(protosetOption);
+    GrammarElement * protoPathOption = f_grammarPool.createElement<Concatenation>();
+    protoPathOption->addChild(f_grammarPool.createElement<FixedString>("--proto_path="));
+    protoPathOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "ProtoPath"));
+    optionsalt->addChild(protoPathOption);
+    GrammarElement * protoFileOption = f_grammarPool.createElement<Concatenation>();
+    protoFileOption->addChild(f_grammarPool.createElement<FixedString>("--proto="));
+    protoFileOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "ProtoFile"));
+    optionsalt->addChild(protoFileOption);
+    GrammarElement * snapshotOption = f_grammarPool.createElement<Concatenation>();
+    snapshotOption->addChild(f_grammarPool.createElement<FixedString>("--snapshot="));
+    snapshotOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "Snapshot"));
+    optionsalt->addChild(snapshotOption);
+    GrammarElement * writeSnapshotOption = f_grammarPool.createElement<Concatenation>();
+    writeSnapshotOption->addChild(f_grammarPool.createElement<FixedString>("--writeSnapshot="));
+    writeSnapshotOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "WriteSnapshot"));
+    optionsalt->addChild(writeSnapshotOption);
+    GrammarElement * maxDumpBytesOption = f_grammarPool.createElement<Concatenation>();
+    maxDumpBytesOption->addChild(f_grammarPool.createElement<FixedString>("--maxDumpBytes="));
+    maxDumpBytesOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "MaxDumpBytes"));
+    optionsalt->addChild(maxDumpBytesOption);
+    GrammarElement * inputOption = f_grammarPool.createElement<Concatenation>();
+    inputOption->addChild(f_grammarPool.createElement<FixedString>("--input="));
+    inputOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "InputFile"));
+    optionsalt->addChild(inputOption);
+    GrammarElement * targetsOption = f_grammarPool.createElement<Concatenation>();
+    targetsOption->addChild(f_grammarPool.createElement<FixedString>("--targets="));
+    targetsOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "Targets"));
+    optionsalt->addChild(targetsOption);
+    GrammarElement * parallelOption = f_grammarPool.createElement<Concatenation>();
+    parallelOption->addChild(f_grammarPool.createElement<FixedString>("--parallel="));
+    parallelOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "Parallel"));
+    optionsalt->addChild(parallelOption);
+    GrammarElement * formatThreadsOption = f_grammarPool.createElement<Concatenation>();
+    formatThreadsOption->addChild(f_grammarPool.createElement<FixedString>("--formatThreads="));
+    formatThreadsOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "FormatThreads"));
+    optionsalt->addChild(formatThreadsOption);
+    GrammarElement * queueSizeOption = f_grammarPool.createElement<Concatenation>();
+    queueSizeOption->addChild(f_grammarPool.createElement<FixedString>("--queueSize="));
+    queueSizeOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "QueueSize"));
+    optionsalt->addChild(queueSizeOption);
+    GrammarElement * queuePolicyOption = f_grammarPool.createElement<Concatenation>();
+    queuePolicyOption->addChild(f_grammarPool.createElement<FixedString>("--queuePolicy="));
+    GrammarElement * queuePolicies = f_grammarPool.createElement<Alternation>("QueuePolicy");
+    queuePolicies->addChild(f_grammarPool.createElement<FixedString>("block"));
+    queuePolicies->addChild(f_grammarPool.createElement<FixedString>("dropOldest"));
+    queuePolicies->addChild(f_grammarPool.createElement<FixedString>("dropNewest"));
+    queuePolicies->addChild(f_grammarPool.createElement<FixedString>("sample"));
+    queuePolicyOption->addChild(queuePolicies);
+    optionsalt->addChild(queuePolicyOption);
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--stats", "Stats"));
+    GrammarElement * reportIntervalOption = f_grammarPool.createElement<Concatenation>();
+    reportIntervalOption->addChild(f_grammarPool.createElement<FixedString>("--reportInterval="));
+    reportIntervalOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+(\\.[0-9]+)?", "ReportInterval"));
+    optionsalt->addChild(reportIntervalOption);
+    GrammarElement * recordOption = f_grammarPool.createElement<Concatenation>();
+    recordOption->addChild(f_grammarPool.createElement<FixedString>("--record="));
+    recordOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "RecordFile"));
+    optionsalt->addChild(recordOption);
+    optionsalt->addChild(f_grammarPool.createElement<FixedString>("--recordAppend", "RecordAppend"));
+    GrammarElement * printRecordingOption = f_grammarPool.createElement<Concatenation>();
+    printRecordingOption->addChild(f_grammarPool.createElement<FixedString>("--printRecording="));
+    printRecordingOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "PrintRecording"));
+    optionsalt->addChild(printRecordingOption);
+    GrammarElement * replayOption = f_grammarPool.createElement<Concatenation>();
+    replayOption->addChild(f_grammarPool.createElement<FixedString>("--replay="));
+    replayOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "ReplayFile"));
+    optionsalt->addChild(replayOption);
+    GrammarElement * replaySpeedOption = f_grammarPool.createElement<Concatenation>();
+    replaySpeedOption->addChild(f_grammarPool.createElement<FixedString>("--replaySpeed="));
+    GrammarElement * replaySpeed = f_grammarPool.createElement<Alternation>("ReplaySpeed");
+    replaySpeed->addChild(f_grammarPool.createElement<RegEx>("[0-9]+(\\.[0-9]+)?"));
+    replaySpeed->addChild(f_grammarPool.createElement<FixedString>("max"));
+    replaySpeedOption->addChild(replaySpeed);
+    optionsalt->addChild(replaySpeedOption);
+    GrammarElement * serveOption = f_grammarPool.createElement<Concatenation>();
+    serveOption->addChild(f_grammarPool.createElement<FixedString>("--serve="));
+    serveOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "ServeAddress"));
+    optionsalt->addChild(serveOption);
+    GrammarElement * serveRecordingOption = f_grammarPool.createElement<Concatenation>();
+    serveRecordingOption->addChild(f_grammarPool.createElement<FixedString>("--serveRecording="));
+    serveRecordingOption->addChild(f_grammarPool.createElement<RegEx>("[^ ]+", "ServeRecording"));
+    optionsalt->addChild(serveRecordingOption);
+    GrammarElement * serveLatencyOption = f_grammarPool.createElement<Concatenation>();
+    serveLatencyOption->addChild(f_grammarPool.createElement<FixedString>("--serveLatency="));
+    serveLatencyOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+(\\.[0-9]+)?", "ServeLatency"));
+    optionsalt->addChild(serveLatencyOption);
+    GrammarElement * serveRateOption = f_grammarPool.createElement<Concatenation>();
+    serveRateOption->addChild(f_grammarPool.createElement<FixedString>("--serveRate="));
+    serveRateOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+(\\.[0-9]+)?", "ServeRate"));
+    optionsalt->addChild(serveRateOption);
+    GrammarElement * serveCountOption = f_grammarPool.createElement<Concatenation>();
+    serveCountOption->addChild(f_grammarPool.createElement<FixedString>("--serveCount="));
+    serveCountOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "ServeCount"));
+    optionsalt->addChild(serveCountOption);
+    GrammarElement * serveThreadsOption = f_grammarPool.createElement<Concatenation>();
+    serveThreadsOption->addChild(f_grammarPool.createElement<FixedString>("--serveThreads="));
+    serveThreadsOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "ServeThreads"));
+    optionsalt->addChild(serveThreadsOption);
     GrammarElement * timeoutOption = f_grammarPool.createElement<Concatenation>();
     timeoutOption->addChild(f_grammarPool.createElement<FixedString>("--connectTimeoutMilliseconds="));
     timeoutOption->addChild(f_grammarPool.createElement<RegEx>("[0-9]+", "connectTimeout"));
     optionsalt->addChild(timeoutOption);
     optionsalt->addChild(customOutputFormat);
+    optionsalt->addChild(filterOption);
+    optionsalt->addChild(aggregateOption);
     // FIXME FIXME FIXME: we cannot distinguish between --complete and --completeDebug.. this is a problem for arguments too, as we cannot guarantee, that we do not have an argument starting with the name of an other argument.
     // -> could solve by makeing FixedString greedy
     optionsconcat->addChild(optionsalt);
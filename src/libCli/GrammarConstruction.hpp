@@ -23,4 +23,16 @@ namespace cli
     /// @returns the root element of the generated grammar. The pointer should not
     ///          be used after the given f_grammarPool is de-allocated.
     ArgParse::GrammarElement * constructGrammar(ArgParse::Grammar & f_grammarPool);
+
+    /// Constructs the grammar of a reply filter expression (see --filter and
+    /// ReplyFilter), e.g. 'a.x == 5 && label != "foo"'.
+    /// @param f_grammarPool Pool to allocate grammar elements from.
+    /// @returns the root element "Filter" of the generated grammar
+    ArgParse::GrammarElement * constructFilterGrammar(ArgParse::Grammar & f_grammarPool);
+
+    /// Constructs the grammar of a reply aggregation expression (see
+    /// --aggregate and ReplyAggregation), e.g. "sum(bytes), count() by status".
+    /// @param f_grammarPool Pool to allocate grammar elements from.
+    /// @returns the root element "Aggregation" of the generated grammar
+    ArgParse::GrammarElement * constructAggregationGrammar(ArgParse::Grammar & f_grammarPool);
 }
@@ -0,0 +1,150 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Interrupt.hpp>
+
+#include <cerrno>
+#include <csignal>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <semaphore.h>
+
+namespace cli
+{
+
+/// Posted by the signal handler, which must not take locks. The watcher
+/// thread waits for it and cancels the registered calls.
+static sem_t s_signalSemaphore;
+static volatile sig_atomic_t s_interrupted = 0;
+
+// guarded by s_mutex:
+static std::mutex s_mutex;
+static size_t s_scopeDepth = 0;
+static std::set<grpc::testing::CliCall *> s_calls;
+static bool s_stopWatcher = false;
+
+static std::thread s_watcher;
+static struct sigaction s_previousAction;
+/// false if SIGINT is ignored (e.g. for background jobs), which is kept.
+static bool s_handlerInstalled = false;
+
+static void handleInterrupt(int)
+{
+    if(s_interrupted)
+    {
+        // terminate as without handler:
+        signal(SIGINT, SIG_DFL);
+        raise(SIGINT);
+        return;
+    }
+    s_interrupted = 1;
+    sem_post(&s_signalSemaphore);
+}
+
+static void watchInterrupts()
+{
+    while(true)
+    {
+        while( (sem_wait(&s_signalSemaphore) != 0) and (errno == EINTR) )
+        {
+        }
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if(s_stopWatcher)
+        {
+            return;
+        }
+        for(grpc::testing::CliCall * call : s_calls)
+        {
+            call->TryCancel();
+        }
+    }
+}
+
+InterruptScope::InterruptScope()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    if(s_scopeDepth++ > 0)
+    {
+        return;
+    }
+    static bool semaphoreInitialized = false;
+    if(not semaphoreInitialized)
+    {
+        sem_init(&s_signalSemaphore, 0, 0);
+        semaphoreInitialized = true;
+    }
+    s_interrupted = 0;
+    s_stopWatcher = false;
+    s_watcher = std::thread(watchInterrupts);
+
+    sigaction(SIGINT, nullptr, &s_previousAction);
+    s_handlerInstalled = (s_previousAction.sa_handler != SIG_IGN);
+    if(s_handlerInstalled)
+    {
+        struct sigaction action;
+        action.sa_handler = handleInterrupt;
+        sigemptyset(&action.sa_mask);
+        // blocking reads (e.g. of the next shell command) are continued:
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGINT, &action, nullptr);
+    }
+}
+
+InterruptScope::~InterruptScope()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if(--s_scopeDepth > 0)
+        {
+            return;
+        }
+        if(s_handlerInstalled)
+        {
+            sigaction(SIGINT, &s_previousAction, nullptr);
+        }
+        s_stopWatcher = true;
+    }
+    sem_post(&s_signalSemaphore);
+    s_watcher.join();
+    // discard posts of signals received while stopping:
+    while(sem_trywait(&s_signalSemaphore) == 0)
+    {
+    }
+}
+
+bool InterruptScope::isInterrupted()
+{
+    return s_interrupted;
+}
+
+CancelOnInterrupt::CancelOnInterrupt(grpc::testing::CliCall & f_call) :
+    m_call(f_call)
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_calls.insert(&m_call);
+    if( (s_scopeDepth > 0) and s_interrupted )
+    {
+        m_call.TryCancel();
+    }
+}
+
+CancelOnInterrupt::~CancelOnInterrupt()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_calls.erase(&m_call);
+}
+
+}
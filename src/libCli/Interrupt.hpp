@@ -0,0 +1,55 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <third_party/gRPC_utils/cli_call.h>
+
+namespace cli
+{
+    /// Handles SIGINT (Ctrl-C) while it exists: instead of terminating
+    /// gWhisper, all calls registered with CancelOnInterrupt are cancelled.
+    /// Interrupted calls then end like failed calls, so e.g. recordings are
+    /// closed properly and the shell returns to its prompt. A second SIGINT
+    /// terminates gWhisper, in case it does not stop by itself.
+    /// Scopes may be nested, only the outermost scope installs the handler.
+    class InterruptScope
+    {
+        public:
+            InterruptScope();
+            ~InterruptScope();
+
+            InterruptScope(const InterruptScope &) = delete;
+            InterruptScope & operator=(const InterruptScope &) = delete;
+
+            /// @returns true if SIGINT was received since the outermost
+            ///          scope was created
+            static bool isInterrupted();
+    };
+
+    /// Cancels a call on SIGINT while it exists (see InterruptScope). Calls
+    /// registered after SIGINT are cancelled immediately.
+    class CancelOnInterrupt
+    {
+        public:
+            explicit CancelOnInterrupt(grpc::testing::CliCall & f_call);
+            ~CancelOnInterrupt();
+
+            CancelOnInterrupt(const CancelOnInterrupt &) = delete;
+            CancelOnInterrupt & operator=(const CancelOnInterrupt &) = delete;
+
+        private:
+            grpc::testing::CliCall & m_call;
+    };
+}
@@ -0,0 +1,83 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/MappedFile.hpp>
+
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cli
+{
+
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+    }
+}
+
+bool MappedFile::map(const std::string & f_fileName, std::string & f_out_error)
+{
+    if(m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+        m_data = nullptr;
+    }
+    m_size = 0;
+
+    int fd = open(f_fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        f_out_error = std::string("Cannot open '") + f_fileName + "': " + strerror(errno);
+        return false;
+    }
+
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0)
+    {
+        f_out_error = std::string("Cannot stat '") + f_fileName + "': " + strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    size_t size = fileStat.st_size;
+    if(size > 0)
+    {
+        void * data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data == MAP_FAILED)
+        {
+            f_out_error = std::string("Cannot map '") + f_fileName + "': " + strerror(errno);
+            close(fd);
+            return false;
+        }
+        m_data = data;
+    }
+    m_size = size;
+    close(fd);
+    return true;
+}
+
+}
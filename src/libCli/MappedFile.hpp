@@ -0,0 +1,55 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace cli
+{
+    /// Read-only memory mapping of a complete file.
+    /// The mapping is released on destruction.
+    class MappedFile
+    {
+        public:
+            MappedFile();
+            ~MappedFile();
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile & operator=(const MappedFile &) = delete;
+
+            /// Maps the given file.
+            /// @param f_fileName path of the file to be mapped
+            /// @param f_out_error human readable error description, if mapping failed
+            /// @returns false on error
+            bool map(const std::string & f_fileName, std::string & f_out_error);
+
+            /// @returns start of the mapped data (nullptr for empty files)
+            const char * data() const
+            {
+                return static_cast<const char *>(m_data);
+            }
+
+            /// @returns size of the mapped data in bytes
+            size_t size() const
+            {
+                return m_size;
+            }
+
+        private:
+            void * m_data;
+            size_t m_size;
+    };
+}
@@ -13,12 +13,176 @@
 // limitations under the License.
 
 #include <libCli/MessageParsing.hpp>
+#include <libCli/MappedFile.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 using namespace ArgParse;
 
 namespace cli
 {
 
+/// Lookup table mapping characters to their value as hex digit, or to
+/// s_invalidDigit for characters which are not hex digits.
+class HexDigitTable
+{
+    public:
+        enum { s_invalidDigit = 0xff };
+
+        HexDigitTable()
+        {
+            memset(m_values, s_invalidDigit, sizeof(m_values));
+            for(int i = 0; i < 10; i++)
+            {
+                m_values['0' + i] = i;
+            }
+            for(int i = 0; i < 6; i++)
+            {
+                m_values['a' + i] = 10 + i;
+                m_values['A' + i] = 10 + i;
+            }
+        }
+
+        uint8_t operator[](char f_char) const
+        {
+            return m_values[static_cast<uint8_t>(f_char)];
+        }
+
+    private:
+        uint8_t m_values[256];
+};
+
+/// Lookup table mapping characters to their value in base64 (standard and
+/// URL-safe alphabet), or to s_invalidDigit.
+class Base64DigitTable
+{
+    public:
+        enum { s_invalidDigit = 0xff };
+
+        Base64DigitTable()
+        {
+            memset(m_values, s_invalidDigit, sizeof(m_values));
+            const char * alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            for(int i = 0; i < 64; i++)
+            {
+                m_values[static_cast<uint8_t>(alphabet[i])] = i;
+            }
+            m_values['-'] = 62;
+            m_values['_'] = 63;
+        }
+
+        uint8_t operator[](char f_char) const
+        {
+            return m_values[static_cast<uint8_t>(f_char)];
+        }
+
+    private:
+        uint8_t m_values[256];
+};
+
+/// Decodes hex digits (two per byte) into f_out.
+/// @returns false if the input contains non hex digits
+static bool decodeHex(const char * f_hex, size_t f_length, std::string & f_out)
+{
+    static const HexDigitTable s_table;
+    f_out.resize(f_length / 2);
+    char * out = &f_out[0];
+    uint8_t invalid = 0;
+    for(size_t i = 0; i + 1 < f_length; i += 2)
+    {
+        uint8_t high = s_table[f_hex[i]];
+        uint8_t low = s_table[f_hex[i+1]];
+        // invalid digits have all bits set, so we can check once at the end:
+        invalid |= (high | low);
+        *out++ = static_cast<char>((high << 4) | (low & 0x0f));
+    }
+    return (invalid & 0xf0) == 0;
+}
+
+/// Decodes base64 (with or without padding) into f_out.
+/// @returns false if the input is not valid base64
+static bool decodeBase64(const char * f_base64, size_t f_length, std::string & f_out)
+{
+    static const Base64DigitTable s_table;
+    while( (f_length > 0) and (f_base64[f_length-1] == '=') )
+    {
+        f_length--;
+    }
+    if(f_length % 4 == 1)
+    {
+        return false;
+    }
+    f_out.resize(f_length / 4 * 3 + ((f_length % 4) * 3) / 4);
+    char * out = &f_out[0];
+    uint8_t invalid = 0;
+    uint32_t bits = 0;
+    size_t numBits = 0;
+    for(size_t i = 0; i < f_length; i++)
+    {
+        uint8_t value = s_table[f_base64[i]];
+        invalid |= value;
+        bits = (bits << 6) | (value & 0x3f);
+        numBits += 6;
+        if(numBits >= 8)
+        {
+            numBits -= 8;
+            *out++ = static_cast<char>(bits >> numBits);
+        }
+    }
+    return (invalid & 0xc0) == 0;
+}
+
+/// Decodes the value given for a bytes field. Supported are
+///  - hex strings: 0x0123abcd
+///  - base64: base64:ASOrzQ==
+///  - contents of a file: @path/to/file
+/// @param f_value value as given in the parse tree
+/// @param f_out decoded bytes
+/// @param f_out_error human readable error description
+/// @returns false on error
+static bool decodeBytesValue(const std::string & f_value, std::string & f_out, std::string & f_out_error)
+{
+    if(f_value.compare(0, 2, "0x") == 0)
+    {
+        // if we have a bytes field, we parse a hex string:
+        if(f_value.size()%2 != 0)
+        {
+            f_out_error = "Given value is not a multiple of 8 bits long";
+            return false;
+        }
+        if(not decodeHex(f_value.data() + 2, f_value.size() - 2, f_out))
+        {
+            f_out_error = "Given value is not a valid hex string";
+            return false;
+        }
+        return true;
+    }
+    if(f_value.compare(0, 7, "base64:") == 0)
+    {
+        if(not decodeBase64(f_value.data() + 7, f_value.size() - 7, f_out))
+        {
+            f_out_error = "Given value is not valid base64";
+            return false;
+        }
+        return true;
+    }
+    if(f_value.compare(0, 1, "@") == 0)
+    {
+        MappedFile file;
+        if(not file.map(f_value.substr(1), f_out_error))
+        {
+            return false;
+        }
+        // copied once from the page cache into the value, which is then moved into the message:
+        f_out.assign(file.data(), file.size());
+        return true;
+    }
+    f_out_error = "Given value does not start with '0x', 'base64:' or '@'. Expected a hex string, base64 or a file name";
+    return false;
+}
+
 /// Parses a single field falue from a given parse tree into a protobuf message.
 /// @param f_parseTree Parse tree containing the field value information.
 /// @param f_message protobuf message to which the field value should be added
@@ -162,29 +326,20 @@ int parseFieldValue(ParsedElement & f_parseTree, google::protobuf::Message * f_m
             if(f_fieldDescriptor->type() == google::protobuf::FieldDescriptor::Type::TYPE_BYTES)
             {
                 std::string resultString;
-                // if we have a bytes field, we parse a hex string:
-                if(valueString.substr(0,2) != "0x")
+                std::string error;
+                if(not decodeBytesValue(valueString, resultString, error))
                 {
-                    std::cerr << "Error parsing bytes field '" << f_fieldDescriptor->name() << "': Given value does not start with '0x'. Expected a hex string" << std::endl;
+                    std::cerr << "Error parsing bytes field '" << f_fieldDescriptor->name() << "': " << error << std::endl;
                     return -1;
                 }
-                if(valueString.size()%2 != 0)
-                {
-                    std::cerr << "Error parsing bytes field '" << f_fieldDescriptor->name() << "': Given value is not a multiple of 8 bits long" << std::endl;
-                    return -1;
-                }
-                for(size_t pos = 2; pos+1<valueString.size(); pos+=2)
-                {
-                    uint8_t byteVal = std::stoul(valueString.substr(pos,2), 0, 16);
-                    resultString.append(1,byteVal);
-                }
+                // the decoded value is moved (not copied) into the message:
                 if(f_isRepeated)
                 {
-                    reflection->AddString(f_message, f_fieldDescriptor, resultString);
+                    reflection->AddString(f_message, f_fieldDescriptor, std::move(resultString));
                 }
                 else
                 {
-                    reflection->SetString(f_message, f_fieldDescriptor, resultString);
+                    reflection->SetString(f_message, f_fieldDescriptor, std::move(resultString));
                 }
             }
             else
@@ -231,21 +386,15 @@ int parseFieldValue(ParsedElement & f_parseTree, google::protobuf::Message * f_m
     return 0;
 }
 
-std::unique_ptr<google::protobuf::Message> parseMessage(ParsedElement & f_parseTree, google::protobuf::DynamicMessageFactory & f_factory, const google::protobuf::Descriptor* f_messageDescriptor)
+/// Parses all completely parsed fields of a "Fields" parse tree into a message.
+/// Values of repeated fields are appended to the values already present.
+/// @returns 0 if all fields could be added to the message. -1 otherwise.
+static int parseFields(ParsedElement & f_parsedFields, google::protobuf::Message * f_message, google::protobuf::DynamicMessageFactory & f_factory, const google::protobuf::Descriptor* f_messageDescriptor)
 {
-    std::unique_ptr<google::protobuf::Message> message(f_factory.GetPrototype(f_messageDescriptor)->New());
-
-    // we iterate over all fields:
-    bool found = false;
-    ParsedElement & parsedFields = f_parseTree.findFirstSubTree("Fields", found);
-    if(not found)
-    {
-        std::cerr << "Error: no Fields found in parseTree for message '" << f_messageDescriptor->name() << "'" << std::endl;
-        return nullptr;
-    }
     //std::cout << "Parsing message from tree: \n" << f_parseTree.getDebugString(" ") << std::endl;
+    bool found = false;
     int rc = 0;
-    for(std::shared_ptr<ParsedElement> parsedField : parsedFields.getChildren())
+    for(std::shared_ptr<ParsedElement> parsedField : f_parsedFields.getChildren())
     {
         if(parsedField->isCompletelyParsed())
         {
@@ -269,28 +418,117 @@ std::unique_ptr<google::protobuf::Message> parseMessage(ParsedElement & f_parseT
                     fieldValue.findAllSubTrees("RepeatedValue", repeatedFieldValues, true);
                     for(auto repeatedValue : repeatedFieldValues)
                     {
-                        rc = parseFieldValue(*repeatedValue, message.get(), f_factory, fieldDescriptor, true);
+                        rc = parseFieldValue(*repeatedValue, f_message, f_factory, fieldDescriptor, true);
                     }
                 }
                 else
                 {
-                    rc = parseFieldValue(fieldValue, message.get(), f_factory, fieldDescriptor);
+                    rc = parseFieldValue(fieldValue, f_message, f_factory, fieldDescriptor);
                 }
             }
             else
             {
                 std::cerr << "Error: No Value given for field '" << parsedField->findFirstChild("FieldName") << "'" << std::endl;
-                return nullptr;
+                return -1;
             }
             if(rc != 0)
             {
-                message.reset();
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+std::unique_ptr<google::protobuf::Message> parseMessage(ParsedElement & f_parseTree, google::protobuf::DynamicMessageFactory & f_factory, const google::protobuf::Descriptor* f_messageDescriptor)
+{
+    std::unique_ptr<google::protobuf::Message> message(f_factory.GetPrototype(f_messageDescriptor)->New());
+
+    // we iterate over all fields:
+    bool found = false;
+    ParsedElement & parsedFields = f_parseTree.findFirstSubTree("Fields", found);
+    if(not found)
+    {
+        std::cerr << "Error: no Fields found in parseTree for message '" << f_messageDescriptor->name() << "'" << std::endl;
+        return nullptr;
+    }
+    if(parseFields(parsedFields, message.get(), f_factory, f_messageDescriptor) != 0)
+    {
+        message.reset();
+    }
+
+    return message;
+}
+
+int parseMessageFields(std::istream & f_input, GrammarElement * f_fieldsGrammar, google::protobuf::Message & f_message, google::protobuf::DynamicMessageFactory & f_factory)
+{
+    // The input is read in chunks. After each chunk, all completely parsed
+    // field assignments are added to the message and discarded from the
+    // buffer, so only the last (incomplete) assignment is kept as text.
+    // If a single assignment is larger than a chunk, we wait for the buffer to
+    // double in size before parsing again, to keep the total parse effort
+    // linear in the input size.
+    enum { s_chunkSize = 64*1024 };
+    std::vector<char> chunk(s_chunkSize);
+    // the grammar expects white space in front of each field assignment:
+    std::string buffer = " ";
+    size_t nextParseSize = s_chunkSize;
+    bool endOfInput = false;
+    while(not endOfInput)
+    {
+        f_input.read(chunk.data(), chunk.size());
+        size_t chunkLen = f_input.gcount();
+        endOfInput = (chunkLen < chunk.size());
+        for(size_t i = 0; i < chunkLen; i++)
+        {
+            // field assignments may be separated by any white space:
+            char c = chunk[i];
+            buffer += ((c == '\n') or (c == '\r') or (c == '\t')) ? ' ' : c;
+        }
+        if( (buffer.size() < nextParseSize) and (not endOfInput) )
+        {
+            continue;
+        }
+
+        ParsedElement parsedFields;
+        f_fieldsGrammar->parse(buffer.c_str(), parsedFields);
+
+        // determine complete field assignments:
+        std::vector<std::shared_ptr<ParsedElement>> & fields = parsedFields.getChildren();
+        size_t numComplete = 0;
+        size_t consumedLen = 0;
+        for(auto & field : fields)
+        {
+            if(not field->isCompletelyParsed())
+            {
                 break;
             }
+            size_t fieldLen = field->getMatchedString().size();
+            if( (consumedLen + fieldLen == buffer.size()) and (not endOfInput) )
+            {
+                // the value might continue in the next chunk
+                break;
+            }
+            consumedLen += fieldLen;
+            numComplete++;
+        }
+        fields.resize(numComplete);
+
+        if(parseFields(parsedFields, &f_message, f_factory, f_message.GetDescriptor()) != 0)
+        {
+            return -1;
         }
+
+        buffer.erase(0, consumedLen);
+        nextParseSize = std::max<size_t>(s_chunkSize, 2*buffer.size());
     }
 
-    return std::move(message);
+    if(buffer.find_first_not_of(' ') != std::string::npos)
+    {
+        std::cerr << "Error: Cannot parse input near '" << buffer.substr(0, 64) << "'" << std::endl;
+        return -1;
+    }
+    return 0;
 }
 
 }
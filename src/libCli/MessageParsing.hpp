@@ -17,6 +17,8 @@
 #include <libArgParse/ArgParse.hpp>
 #include <google/protobuf/dynamic_message.h>
 
+#include <istream>
+
 namespace cli
 {
     /// Constructs a gRPC message from a given parseTree.
@@ -32,4 +34,23 @@ namespace cli
             google::protobuf::DynamicMessageFactory & f_factory,
             const google::protobuf::Descriptor* f_messageDescriptor
             );
+
+    /// Parses field assignments from a stream into an existing message.
+    /// The stream is parsed incrementally in chunks, so the input text is
+    /// never held in memory as a whole. Field assignments use the same syntax
+    /// as on the command line and may be separated by any white space
+    /// (including newlines). Values of repeated fields given in multiple
+    /// assignments are appended.
+    /// @param f_input stream to read field assignments from
+    /// @param f_fieldsGrammar Grammar of the "Fields" of the message type
+    ///        (as injected for the method arguments).
+    /// @param f_message message to add the fields to
+    /// @param f_factory Required to construct sub-messages.
+    /// @returns 0 if the complete input could be parsed. -1 otherwise.
+    int parseMessageFields(
+            std::istream & f_input,
+            ArgParse::GrammarElement * f_fieldsGrammar,
+            google::protobuf::Message & f_message,
+            google::protobuf::DynamicMessageFactory & f_factory
+            );
 }
@@ -0,0 +1,125 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/MessageProjection.hpp>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+using google::protobuf::internal::WireFormatLite;
+
+namespace cli
+{
+
+void MessageProjection::addField(const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path)
+{
+    Node * node = &m_root;
+    for(const grpc::protobuf::FieldDescriptor * field : f_path)
+    {
+        if(node->complete)
+        {
+            // a parent field is already needed completely
+            return;
+        }
+        std::unique_ptr<Node> & child = node->fields[field->number()];
+        if(child == nullptr)
+        {
+            child = std::unique_ptr<Node>(new Node());
+        }
+        node = child.get();
+    }
+    node->complete = true;
+    node->fields.clear();
+}
+
+bool MessageProjection::project(const std::string & f_serializedMessage, std::string & f_out_projection) const
+{
+    f_out_projection.clear();
+    return projectNode(m_root, f_serializedMessage.data(), f_serializedMessage.size(), f_out_projection);
+}
+
+/// Appends a varint to a string.
+static void appendVarint(uint64_t f_value, std::string & f_out)
+{
+    while(f_value >= 0x80)
+    {
+        f_out += static_cast<char>((f_value & 0x7f) | 0x80);
+        f_value >>= 7;
+    }
+    f_out += static_cast<char>(f_value);
+}
+
+bool MessageProjection::projectNode(const Node & f_node, const char * f_data, size_t f_size, std::string & f_out_projection)
+{
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t *>(f_data), f_size);
+    while(true)
+    {
+        int fieldStart = input.CurrentPosition();
+        if(static_cast<size_t>(fieldStart) == f_size)
+        {
+            return true;
+        }
+        uint32_t tag = input.ReadTag();
+        if(tag == 0)
+        {
+            // malformed tag
+            return false;
+        }
+
+        auto it = f_node.fields.find(WireFormatLite::GetTagFieldNumber(tag));
+        if(it == f_node.fields.end())
+        {
+            // not needed -> skip without decoding:
+            if(not WireFormatLite::SkipField(&input, tag))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        const Node & child = *it->second;
+        if( child.complete or (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) )
+        {
+            // copy the complete field as it is:
+            if(not WireFormatLite::SkipField(&input, tag))
+            {
+                return false;
+            }
+            f_out_projection.append(f_data + fieldStart, input.CurrentPosition() - fieldStart);
+            continue;
+        }
+
+        // submessage of which only some fields are needed:
+        uint32_t length = 0;
+        if(not input.ReadVarint32(&length))
+        {
+            return false;
+        }
+        int valueStart = input.CurrentPosition();
+        if(not input.Skip(length))
+        {
+            return false;
+        }
+        std::string subProjection;
+        if(not projectNode(child, f_data + valueStart, length, subProjection))
+        {
+            return false;
+        }
+        appendVarint(tag, f_out_projection);
+        appendVarint(subProjection.size(), f_out_projection);
+        f_out_projection += subProjection;
+    }
+}
+
+}
@@ -0,0 +1,61 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cli
+{
+    /// Set of fields of a message type which are needed for output.
+    /// Used to decode only the needed fields of large replies: project()
+    /// copies the needed fields of a serialized message and skips all others
+    /// without decoding them. The (much smaller) result is then parsed as
+    /// usual. Unneeded fields of the parsed message have default values.
+    class MessageProjection
+    {
+        public:
+            /// Marks a field as needed.
+            /// @param f_path fields from the projected message type to the
+            ///        needed field. The last field is needed completely
+            ///        (including all its submessages), the others only
+            ///        partially.
+            void addField(const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path);
+
+            /// Copies all needed fields of a serialized message.
+            /// @param f_serializedMessage message in wire format
+            /// @param f_out_projection the needed fields in wire format
+            /// @returns false if the message is malformed
+            bool project(const std::string & f_serializedMessage, std::string & f_out_projection) const;
+
+        private:
+            struct Node
+            {
+                /// true if the field is needed with all its submessages.
+                bool complete = false;
+
+                /// Needed fields of the submessage, by field number.
+                std::map<int, std::unique_ptr<Node>> fields;
+            };
+
+            Node m_root;
+
+            static bool projectNode(const Node & f_node, const char * f_data, size_t f_size, std::string & f_out_projection);
+    };
+}
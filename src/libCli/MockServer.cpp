@@ -0,0 +1,730 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/MockServer.hpp>
+#include <libCli/DescriptorSource.hpp>
+#include <libCli/MessageParsing.hpp>
+#include <libCli/Recording.hpp>
+#include <libCli/cliUtils.hpp>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/alarm.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <google/protobuf/descriptor_database.h>
+#include <google/protobuf/dynamic_message.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+namespace
+{
+    const char * s_reflectionService = "grpc.reflection.v1alpha.ServerReflection";
+    const char * s_reflectionMethodPath = "/grpc.reflection.v1alpha.ServerReflection/ServerReflectionInfo";
+
+    /// Number of calls each completion queue waits for at the same time, so
+    /// bursts of new calls are accepted without waiting for the queue thread.
+    const size_t s_acceptedCallsPerQueue = 8;
+
+    /// Upper limits of the timing options, keeping all delays representable.
+    const double s_maxDelaySeconds = 24 * 3600;
+    const uint64_t s_maxCount = UINT32_MAX;
+    const uint64_t s_maxThreads = 1024;
+
+    /// Canned behavior of one method of the mock server.
+    struct MockMethod
+    {
+        /// Replies sent in order, serialized once at startup.
+        std::vector<grpc::ByteBuffer> replies;
+        /// Delay before each reply, following the previous reply (or, for
+        /// the first reply, the first request).
+        std::vector<std::chrono::nanoseconds> delays;
+        /// Number of times the replies are sent (streaming methods only).
+        size_t count = 1;
+        /// Delay before the first reply of each repetition after the first
+        /// one, negative to use the delay of the first reply.
+        std::chrono::nanoseconds repetitionDelay = std::chrono::nanoseconds(-1);
+        grpc::Status status;
+        RecordedMetadata initialMetadata;
+        RecordedMetadata trailingMetadata;
+    };
+
+    /// @returns contents of a byte buffer received by the server
+    std::string toString(const grpc::ByteBuffer & f_buffer)
+    {
+        std::vector<grpc::Slice> slices;
+        std::string result;
+        if(f_buffer.Dump(&slices).ok())
+        {
+            for(const grpc::Slice & slice : slices)
+            {
+                result.append(reinterpret_cast<const char *>(slice.begin()), slice.size());
+            }
+        }
+        return result;
+    }
+
+    grpc::ByteBuffer toByteBuffer(const std::string & f_data)
+    {
+        grpc::Slice slice(f_data);
+        return grpc::ByteBuffer(&slice, 1);
+    }
+
+    /// @returns path used by gRPC for a method, e.g. "/examples.TestService/Echo"
+    std::string getMethodPath(const grpc::protobuf::MethodDescriptor * f_method)
+    {
+        return "/" + f_method->service()->full_name() + "/" + f_method->name();
+    }
+}
+
+/// Schema and canned replies of the mock server.
+/// Only read after construction, so it is shared by all server threads
+/// without locking (the descriptor pool locks internally).
+class MockService
+{
+    public:
+        /// Adds all services and methods of the descriptor set. Methods reply
+        /// with one empty message until replies are set.
+        /// @returns false if the descriptor set is inconsistent
+        bool load(const google::protobuf::FileDescriptorSet & f_descriptors, std::string & f_out_error)
+        {
+            for(const google::protobuf::FileDescriptorProto & file : f_descriptors.file())
+            {
+                if(not m_database.Add(file))
+                {
+                    f_out_error = "Invalid descriptor of file '" + file.name() + "'";
+                    return false;
+                }
+            }
+            for(const google::protobuf::FileDescriptorProto & fileProto : f_descriptors.file())
+            {
+                const grpc::protobuf::FileDescriptor * file = m_pool.FindFileByName(fileProto.name());
+                if(file == nullptr)
+                {
+                    f_out_error = "Cannot load descriptor of file '" + fileProto.name() + "'";
+                    return false;
+                }
+                for(int i = 0; i < file->service_count(); i++)
+                {
+                    const grpc::protobuf::ServiceDescriptor * service = file->service(i);
+                    if(service->full_name() == s_reflectionService)
+                    {
+                        // answered by the mock server itself
+                        continue;
+                    }
+                    m_services.insert(service->full_name());
+                    for(int j = 0; j < service->method_count(); j++)
+                    {
+                        MockMethod & method = m_methods[getMethodPath(service->method(j))];
+                        method.replies.push_back(toByteBuffer(""));
+                        method.delays.push_back(std::chrono::nanoseconds(0));
+                    }
+                }
+            }
+            m_services.insert(s_reflectionService);
+            return true;
+        }
+
+        const grpc::protobuf::DescriptorPool & getPool() const
+        {
+            return m_pool;
+        }
+
+        /// @returns the method with the given path, nullptr if unknown
+        const MockMethod * findMethod(const std::string & f_path) const
+        {
+            auto it = m_methods.find(f_path);
+            return (it == m_methods.end()) ? nullptr : &it->second;
+        }
+
+        /// @returns the method to change replies of, nullptr if unknown
+        MockMethod * findMethod(const grpc::protobuf::MethodDescriptor * f_method)
+        {
+            auto it = m_methods.find(getMethodPath(f_method));
+            return (it == m_methods.end()) ? nullptr : &it->second;
+        }
+
+        /// Applies latency and rate given on the command line to all methods.
+        /// Non-streaming methods always send a single reply.
+        /// @param f_latency delay before the first reply, negative to keep the recorded delay
+        /// @param f_interval delay between further replies, negative to keep the recorded delays
+        void setTiming(std::chrono::nanoseconds f_latency, std::chrono::nanoseconds f_interval, size_t f_count)
+        {
+            for(auto & entry : m_methods)
+            {
+                MockMethod & method = entry.second;
+                const grpc::protobuf::MethodDescriptor * descriptor = findMethodDescriptor(entry.first);
+                bool streaming = (descriptor != nullptr) and descriptor->server_streaming();
+                if(not streaming)
+                {
+                    method.replies.resize(std::min<size_t>(method.replies.size(), 1));
+                    method.delays.resize(method.replies.size());
+                }
+                method.count = streaming ? f_count : 1;
+                method.repetitionDelay = f_interval;
+                for(size_t i = 0; i < method.delays.size(); i++)
+                {
+                    if( (i == 0) and (f_latency.count() >= 0) )
+                    {
+                        method.delays[i] = f_latency;
+                    }
+                    else if( (i > 0) and (f_interval.count() >= 0) )
+                    {
+                        method.delays[i] = f_interval;
+                    }
+                }
+            }
+        }
+
+        /// Answers a server reflection request from the descriptors of the
+        /// mock server.
+        grpc::reflection::v1alpha::ServerReflectionResponse reflect(const grpc::reflection::v1alpha::ServerReflectionRequest & f_request) const
+        {
+            grpc::reflection::v1alpha::ServerReflectionResponse response;
+            response.set_valid_host(f_request.host());
+            *response.mutable_original_request() = f_request;
+
+            const grpc::protobuf::FileDescriptor * file = nullptr;
+            switch(f_request.message_request_case())
+            {
+                case grpc::reflection::v1alpha::ServerReflectionRequest::kListServices:
+                    for(const std::string & service : m_services)
+                    {
+                        response.mutable_list_services_response()->add_service()->set_name(service);
+                    }
+                    return response;
+                case grpc::reflection::v1alpha::ServerReflectionRequest::kFileByFilename:
+                    file = m_pool.FindFileByName(f_request.file_by_filename());
+                    break;
+                case grpc::reflection::v1alpha::ServerReflectionRequest::kFileContainingSymbol:
+                    file = m_pool.FindFileContainingSymbol(f_request.file_containing_symbol());
+                    break;
+                default:
+                    response.mutable_error_response()->set_error_code(grpc::StatusCode::UNIMPLEMENTED);
+                    response.mutable_error_response()->set_error_message("Not supported by the gWhisper mock server");
+                    return response;
+            }
+            if(file == nullptr)
+            {
+                response.mutable_error_response()->set_error_code(grpc::StatusCode::NOT_FOUND);
+                response.mutable_error_response()->set_error_message("Not found");
+                return response;
+            }
+
+            // the file and all its dependencies:
+            std::set<std::string> added;
+            std::vector<const grpc::protobuf::FileDescriptor *> files = {file};
+            while(not files.empty())
+            {
+                const grpc::protobuf::FileDescriptor * current = files.back();
+                files.pop_back();
+                if(not added.insert(current->name()).second)
+                {
+                    continue;
+                }
+                google::protobuf::FileDescriptorProto proto;
+                current->CopyTo(&proto);
+                proto.SerializeToString(response.mutable_file_descriptor_response()->add_file_descriptor_proto());
+                for(int i = 0; i < current->dependency_count(); i++)
+                {
+                    files.push_back(current->dependency(i));
+                }
+            }
+            return response;
+        }
+
+    private:
+        const grpc::protobuf::MethodDescriptor * findMethodDescriptor(const std::string & f_path) const
+        {
+            size_t separator = f_path.rfind('/');
+            return m_pool.FindMethodByName(f_path.substr(1, separator - 1) + "." + f_path.substr(separator + 1));
+        }
+
+        google::protobuf::SimpleDescriptorDatabase m_database;
+        grpc::protobuf::DescriptorPool m_pool{&m_database};
+        std::set<std::string> m_services;
+        std::unordered_map<std::string, MockMethod> m_methods;
+};
+
+/// Answers one call received by the mock server.
+/// Requests are read (and discarded) while the replies are sent, so clients
+/// waiting for replies before half-closing are served as well. Replies are
+/// paced with alarms on the completion queue, so a thread never blocks and
+/// serves any number of concurrent calls. The object deletes itself when
+/// the call is finished and all operations completed.
+class MockCall
+{
+    public:
+        /// Starts waiting for the next incoming call.
+        MockCall(grpc::AsyncGenericService & f_service, grpc::ServerCompletionQueue * f_cq, const MockService & f_mock) :
+            m_service(f_service),
+            m_cq(f_cq),
+            m_mock(f_mock),
+            m_stream(&m_serverContext)
+        {
+            m_serverContext.AsyncNotifyWhenDone(startOperation(&MockCall::onDone));
+            m_service.RequestCall(&m_serverContext, &m_stream, m_cq, m_cq, startOperation(&MockCall::onNewCall));
+        }
+
+        /// Dispatches an event received from the completion queue.
+        static void handleEvent(void * f_tag, bool f_ok)
+        {
+            Operation * operation = static_cast<Operation *>(f_tag);
+            MockCall * call = operation->call;
+            void (MockCall::*handler)(bool) = operation->handler;
+            delete operation;
+
+            call->m_pendingOperations--;
+            (call->*handler)(f_ok);
+            if(call->m_finished and (call->m_pendingOperations == 0))
+            {
+                delete call;
+            }
+        }
+
+    private:
+        /// Completion queue tag
+        struct Operation
+        {
+            MockCall * call;
+            void (MockCall::*handler)(bool);
+        };
+
+        void * startOperation(void (MockCall::*f_handler)(bool))
+        {
+            m_pendingOperations++;
+            return new Operation{this, f_handler};
+        }
+
+        void onNewCall(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                // server shutting down
+                m_finished = true;
+                return;
+            }
+            // accept the next call:
+            new MockCall(m_service, m_cq, m_mock);
+
+            if(m_serverContext.method() == s_reflectionMethodPath)
+            {
+                m_stream.Read(&m_requestBuffer, startOperation(&MockCall::onReflectionRequestRead));
+                return;
+            }
+            m_method = m_mock.findMethod(m_serverContext.method());
+            if(m_method == nullptr)
+            {
+                finish(grpc::Status(grpc::StatusCode::UNIMPLEMENTED, "gWhisper mock server: unknown method " + m_serverContext.method()));
+                return;
+            }
+            for(auto & metadata : m_method->initialMetadata)
+            {
+                m_serverContext.AddInitialMetadata(metadata.first, metadata.second);
+            }
+            m_stream.Read(&m_requestBuffer, startOperation(&MockCall::onRequestRead));
+        }
+
+        void onRequestRead(bool f_ok)
+        {
+            if(not m_replying)
+            {
+                // first request received or client half-closed without request
+                m_replying = true;
+                scheduleReply();
+            }
+            if(f_ok and (not m_finishing))
+            {
+                m_stream.Read(&m_requestBuffer, startOperation(&MockCall::onRequestRead));
+            }
+        }
+
+        void scheduleReply()
+        {
+            if(m_cancelled)
+            {
+                finish(grpc::Status::CANCELLED);
+                return;
+            }
+            size_t numberOfReplies = m_method->replies.size();
+            if(m_replyIndex >= numberOfReplies * m_method->count)
+            {
+                for(auto & metadata : m_method->trailingMetadata)
+                {
+                    m_serverContext.AddTrailingMetadata(metadata.first, metadata.second);
+                }
+                finish(m_method->status);
+                return;
+            }
+            std::chrono::nanoseconds delay = m_method->delays[m_replyIndex % numberOfReplies];
+            if( (m_replyIndex >= numberOfReplies) and (m_replyIndex % numberOfReplies == 0) and (m_method->repetitionDelay.count() >= 0) )
+            {
+                delay = m_method->repetitionDelay;
+            }
+            if(delay.count() > 0)
+            {
+                m_alarm.Set(m_cq, std::chrono::system_clock::now() + delay, startOperation(&MockCall::onAlarm));
+            }
+            else
+            {
+                writeReply();
+            }
+        }
+
+        void onAlarm(bool f_ok)
+        {
+            // alarms are only cancelled when the call is cancelled:
+            if(not f_ok)
+            {
+                finish(grpc::Status::CANCELLED);
+                return;
+            }
+            writeReply();
+        }
+
+        void writeReply()
+        {
+            const grpc::ByteBuffer & reply = m_method->replies[m_replyIndex % m_method->replies.size()];
+            m_replyIndex++;
+            m_stream.Write(reply, startOperation(&MockCall::onReplyWritten));
+        }
+
+        void onReplyWritten(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                // client is gone
+                finish(grpc::Status::CANCELLED);
+                return;
+            }
+            scheduleReply();
+        }
+
+        void onReflectionRequestRead(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                // client half-closed the reflection stream
+                finish(grpc::Status::OK);
+                return;
+            }
+            grpc::reflection::v1alpha::ServerReflectionRequest request;
+            if(not request.ParseFromString(toString(m_requestBuffer)))
+            {
+                finish(grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Invalid reflection request"));
+                return;
+            }
+            std::string response;
+            m_mock.reflect(request).SerializeToString(&response);
+            m_replyBuffer = toByteBuffer(response);
+            m_stream.Write(m_replyBuffer, startOperation(&MockCall::onReflectionResponseWritten));
+        }
+
+        void onReflectionResponseWritten(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                finish(grpc::Status::CANCELLED);
+                return;
+            }
+            m_stream.Read(&m_requestBuffer, startOperation(&MockCall::onReflectionRequestRead));
+        }
+
+        void finish(const grpc::Status & f_status)
+        {
+            if(m_finishing)
+            {
+                return;
+            }
+            m_finishing = true;
+            m_stream.Finish(f_status, startOperation(&MockCall::onFinished));
+        }
+
+        void onFinished(bool f_ok)
+        {
+            m_finished = true;
+        }
+
+        void onDone(bool f_ok)
+        {
+            if(m_serverContext.IsCancelled())
+            {
+                m_cancelled = true;
+                m_alarm.Cancel();
+            }
+        }
+
+        grpc::AsyncGenericService & m_service;
+        grpc::ServerCompletionQueue * m_cq;
+        const MockService & m_mock;
+
+        grpc::GenericServerContext m_serverContext;
+        grpc::GenericServerAsyncReaderWriter m_stream;
+        grpc::ByteBuffer m_requestBuffer;
+        grpc::ByteBuffer m_replyBuffer;
+        grpc::Alarm m_alarm;
+
+        const MockMethod * m_method = nullptr;
+        size_t m_replyIndex = 0;
+
+        size_t m_pendingOperations = 0;
+        bool m_replying = false;
+        bool m_finishing = false;
+        bool m_finished = false;
+        bool m_cancelled = false;
+};
+
+/// Loads schema and replies of the last call of each method from a recording.
+static bool loadRecording(const std::string & f_fileName, MockService & f_mock)
+{
+    Recording recording;
+    std::string error;
+    if( (not recording.load(f_fileName, error)) or (not f_mock.load(recording.getDescriptors(), error)) )
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+    size_t numberOfCalls = 0;
+    for(const Recording::Call & call : recording.getCalls())
+    {
+        const grpc::protobuf::MethodDescriptor * descriptor = f_mock.getPool().FindMethodByName(call.method);
+        MockMethod * method = (descriptor == nullptr) ? nullptr : f_mock.findMethod(descriptor);
+        if(method == nullptr)
+        {
+            continue;
+        }
+        // later calls replace earlier ones:
+        method->replies.clear();
+        method->delays.clear();
+        uint64_t previousTimeNs = call.startTimeNs;
+        for(const Recording::Reply & reply : call.replies)
+        {
+            method->replies.push_back(toByteBuffer(reply.message.toString()));
+            method->delays.push_back(std::chrono::nanoseconds(reply.timeNs - std::min(reply.timeNs, previousTimeNs)));
+            previousTimeNs = reply.timeNs;
+        }
+        if(call.finished)
+        {
+            method->status = grpc::Status(static_cast<grpc::StatusCode>(call.statusCode), call.statusMessage);
+        }
+        method->initialMetadata = call.initialMetadata;
+        method->trailingMetadata = call.trailingMetadata;
+        numberOfCalls++;
+    }
+    std::cerr << "Serving replies of " << numberOfCalls << " recorded calls" << std::endl;
+    return true;
+}
+
+/// Loads the schema from the server (or local schema) given in the parse
+/// tree. If a method is given, its arguments are used as reply.
+static bool loadSchema(ParsedElement & f_parseTree, MockService & f_mock)
+{
+    std::shared_ptr<grpc::Channel> channel = createChannel(&f_parseTree);
+    std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(&f_parseTree, channel);
+    if(descSource == nullptr)
+    {
+        return false;
+    }
+    if(descSource->usesReflection() and not waitForChannelConnected(channel, getConnectTimeoutMs(&f_parseTree)))
+    {
+        std::cerr << "Error: channel connection attempt timed out" << std::endl;
+        return false;
+    }
+    std::vector<std::string> serviceNames;
+    if(not descSource->getServices(serviceNames))
+    {
+        std::cerr << "Error: Cannot retrieve services" << std::endl;
+        return false;
+    }
+
+    grpc::protobuf::DescriptorPool descPool(&descSource->getDatabase());
+    google::protobuf::FileDescriptorSet descriptors;
+    for(const std::string & serviceName : serviceNames)
+    {
+        const grpc::protobuf::ServiceDescriptor * service = descPool.FindServiceByName(serviceName);
+        if( (service == nullptr) or (service->method_count() == 0) )
+        {
+            continue;
+        }
+        // adds the file of the service, with all its methods:
+        RecordingWriter::addMethodDescriptors(service->method(0), descriptors);
+    }
+    std::string error;
+    if(not f_mock.load(descriptors, error))
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+
+    std::string serviceName = f_parseTree.findFirstChild("Service");
+    std::string methodName = f_parseTree.findFirstChild("Method");
+    if( (serviceName == "") or (methodName == "") )
+    {
+        return true;
+    }
+    const grpc::protobuf::MethodDescriptor * descriptor = f_mock.getPool().FindMethodByName(serviceName + "." + methodName);
+    MockMethod * method = (descriptor == nullptr) ? nullptr : f_mock.findMethod(descriptor);
+    if(method == nullptr)
+    {
+        std::cerr << "Error: Method not found" << std::endl;
+        return false;
+    }
+    google::protobuf::DynamicMessageFactory dynamicFactory;
+    std::unique_ptr<grpc::protobuf::Message> reply = parseMessage(f_parseTree, dynamicFactory, descriptor->output_type());
+    if(reply == nullptr)
+    {
+        std::cerr << "Error: Cannot parse the reply" << std::endl;
+        return false;
+    }
+    std::string serializedReply;
+    reply->SerializeToString(&serializedReply);
+    method->replies[0] = toByteBuffer(serializedReply);
+    return true;
+}
+
+/// Reads a decimal option value (e.g. --serveRate=).
+/// @returns false (after printing an error) if the value is not within the
+///          given bounds
+static bool getDecimalOption(ParsedElement & f_parseTree, const std::string & f_elementName, const std::string & f_optionName, double f_min, double f_max, double & f_out_value)
+{
+    std::string valueStr = f_parseTree.findFirstChild(f_elementName);
+    if(valueStr == "")
+    {
+        return true;
+    }
+    double value = f_max + 1;
+    try
+    {
+        value = std::stod(valueStr);
+    }
+    catch(std::out_of_range &)
+    {
+    }
+    if( (value < f_min) or (value > f_max) )
+    {
+        std::cerr << std::setprecision(15) << "Error: The value of " << f_optionName << " has to be between " << f_min << " and " << f_max << std::endl;
+        return false;
+    }
+    f_out_value = value;
+    return true;
+}
+
+int runMockServer(ParsedElement & f_parseTree)
+{
+    // options are checked before the schema is retrieved:
+    double latencyMs = -1;
+    double rate = -1;
+    uint64_t count = 1;
+    uint64_t numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    if( (not getDecimalOption(f_parseTree, "ServeLatency", "--serveLatency=", 0, s_maxDelaySeconds * 1000, latencyMs))
+            or (not getDecimalOption(f_parseTree, "ServeRate", "--serveRate=", 0, 1e9, rate))
+            or (not getNumericOption(&f_parseTree, "ServeCount", "--serveCount=", s_maxCount, count))
+            or (not getNumericOption(&f_parseTree, "ServeThreads", "--serveThreads=", s_maxThreads, numberOfThreads)) )
+    {
+        return -1;
+    }
+    if( (rate >= 0) and (rate * s_maxDelaySeconds < 1) )
+    {
+        std::cerr << "Error: The reply rate has to be at least one reply per day" << std::endl;
+        return -1;
+    }
+
+    MockService mock;
+    std::string recordingFile = f_parseTree.findFirstChild("ServeRecording");
+    if( (recordingFile == "") and (f_parseTree.findFirstChild("ServerAddress") == "") and (getLocalSchemaOptions(&f_parseTree) == "") )
+    {
+        std::cerr << "Error: Without server address or local schema, --serveRecording= is required" << std::endl;
+        return -1;
+    }
+    if(recordingFile != "")
+    {
+        if(not loadRecording(recordingFile, mock))
+        {
+            return -1;
+        }
+    }
+    else if(not loadSchema(f_parseTree, mock))
+    {
+        return -1;
+    }
+
+    // negative durations keep the recorded timing:
+    std::chrono::nanoseconds latency(static_cast<int64_t>(latencyMs * 1e6));
+    std::chrono::nanoseconds interval((rate > 0) ? static_cast<int64_t>(1e9 / rate) : -1);
+    mock.setTiming(latency, interval, count);
+    numberOfThreads = std::max<uint64_t>(1, numberOfThreads);
+
+    // a port only listens on all interfaces:
+    std::string address = f_parseTree.findFirstChild("ServeAddress");
+    if(address.find(':') == std::string::npos)
+    {
+        address = "0.0.0.0:" + address;
+    }
+
+    grpc::AsyncGenericService service;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort(address, grpc::InsecureServerCredentials());
+    builder.RegisterAsyncGenericService(&service);
+    // reflection requests are answered from the mock schema:
+    disableServerPlugins(builder);
+    std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues;
+    for(size_t i = 0; i < numberOfThreads; i++)
+    {
+        queues.push_back(builder.AddCompletionQueue());
+    }
+
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    if(server == nullptr)
+    {
+        std::cerr << "Error: Cannot listen on " << address << std::endl;
+        return -1;
+    }
+    std::cerr << "gWhisper mock server listening on " << address << " (" << numberOfThreads << " threads)" << std::endl;
+
+    std::vector<std::thread> workers;
+    for(auto & queue : queues)
+    {
+        grpc::ServerCompletionQueue * cq = queue.get();
+        for(size_t i = 0; i < s_acceptedCallsPerQueue; i++)
+        {
+            new MockCall(service, cq, mock);
+        }
+        workers.emplace_back([cq]
+        {
+            void * tag;
+            bool ok;
+            while(cq->Next(&tag, &ok))
+            {
+                MockCall::handleEvent(tag, ok);
+            }
+        });
+    }
+    for(std::thread & worker : workers)
+    {
+        worker.join();
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,36 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+
+namespace cli
+{
+    /// Runs gWhisper as mock server (--serve=) until terminated.
+    /// The server exposes all services of a schema, including server
+    /// reflection, so it can be used in place of the real server:
+    /// - With --serveRecording=FILE, schema and replies are taken from a
+    ///   recording (see RecordingWriter). Each method replies with the replies
+    ///   and status of its last recorded call, with the recorded pacing.
+    /// - Otherwise the schema is taken from the server (or local schema)
+    ///   given in the parse tree. If a method is given, it replies with the
+    ///   message given as method arguments (in the syntax of the reply type).
+    /// Methods without canned replies reply with an empty message.
+    /// Calls are handled asynchronously by one completion queue per thread
+    /// (--serveThreads=). Replies are serialized only once at startup.
+    /// @param f_parseTree Parse tree containing the options and schema source
+    /// @returns -1 if the server could not be started
+    int runMockServer(ArgParse::ParsedElement & f_parseTree);
+}
@@ -14,9 +14,44 @@
 
 #include <libCli/OutputFormatting.hpp>
 
+#include <algorithm>
+
 namespace cli
 {
 
+    OutputBuffer::OutputBuffer(std::ostream * f_stream) :
+        m_stream(f_stream)
+    {
+    }
+
+    OutputBuffer::~OutputBuffer()
+    {
+        flush();
+    }
+
+    void OutputBuffer::append(const std::string & f_text)
+    {
+        m_buffer += f_text;
+        if( (m_stream != nullptr) and (m_buffer.size() >= s_flushSize) )
+        {
+            flush();
+        }
+    }
+
+    void OutputBuffer::flush()
+    {
+        if( (m_stream != nullptr) and (not m_buffer.empty()) )
+        {
+            m_stream->write(m_buffer.data(), m_buffer.size());
+            m_buffer.clear();
+        }
+    }
+
+    std::string OutputBuffer::takeString()
+    {
+        return std::move(m_buffer);
+    }
+
     template <typename T>
     std::string OutputFormatter::intToHexString(T f_value)
     {
@@ -54,6 +89,45 @@ namespace cli
     void OutputFormatter::clearColorMap()
     {
         m_colorMap.clear();
+        m_layoutCache.clear();
+    }
+
+    const OutputFormatter::MessageLayout & OutputFormatter::getLayout(const grpc::protobuf::Descriptor* f_messageDescriptor)
+    {
+        auto it = m_layoutCache.find(f_messageDescriptor);
+        if(it != m_layoutCache.end())
+        {
+            return it->second;
+        }
+
+        MessageLayout & layout = m_layoutCache[f_messageDescriptor];
+        for(int i = 0; i< f_messageDescriptor->field_count(); i++)
+        {
+            const google::protobuf::FieldDescriptor * fieldDesc = f_messageDescriptor->field(i);
+            FieldLayout field;
+            field.descriptor = fieldDesc;
+            if(fieldDesc->is_repeated())
+            {
+                layout.hasRepeatedFields = true;
+                field.label = colorize(ColorClass::RepeatedFieldName, fieldDesc->name()) + getColor(ColorClass::RepeatedCount) + "[";
+                field.emptyLabel = colorize(ColorClass::RepeatedFieldName, fieldDesc->name()) + colorize(ColorClass::RepeatedCount, "[0/0]");
+            }
+            else
+            {
+                field.label = colorize(ColorClass::NonRepeatedFieldName, fieldDesc->name());
+            }
+            layout.maxFieldNameLength = std::max(layout.maxFieldNameLength, fieldDesc->name().size());
+            layout.fields.push_back(std::move(field));
+        }
+
+        if(not layout.hasRepeatedFields)
+        {
+            for(FieldLayout & field : layout.fields)
+            {
+                field.alignedLabel = field.label + generateHorizontalGuide(field.descriptor->name().size(), layout.maxFieldNameLength) + " = ";
+            }
+        }
+        return layout;
     }
 
     std::string OutputFormatter::getColor(OutputFormatter::ColorClass f_colorClass)
@@ -85,10 +159,9 @@ namespace cli
         return result;
     }
 
-std::string OutputFormatter::repeatedFieldValueToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, int f_fieldIndex, CustomStringModifier f_modifier)
+void OutputFormatter::writeRepeatedFieldValue(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, int f_fieldIndex, CustomStringModifier f_modifier)
 {
     const google::protobuf::Reflection * reflection = f_message.GetReflection();
-    std::string result;
 
     // Repeated oneof is not supported in protocoil buffers, so no need to check for it here
 
@@ -98,9 +171,9 @@ std::string OutputFormatter::repeatedFieldValueToString(const grpc::protobuf::Me
             {
                 const google::protobuf::Message & subMessage = reflection->GetRepeatedMessage(f_message, f_fieldDescriptor, f_fieldIndex);
                 //result += "\n" + f_currentPrefix + f_initPrefix + ":\n";
-                result += colorize(ColorClass::MessageTypeName, std::string("{") + f_fieldDescriptor->message_type()->name() + "}");
-                result += "\n";
-                result += messageToString(subMessage,f_fieldDescriptor->message_type(), f_initPrefix, f_currentPrefix+f_initPrefix);
+                f_out.append(colorize(ColorClass::MessageTypeName, std::string("{") + f_fieldDescriptor->message_type()->name() + "}"));
+                f_out.append("\n");
+                writeMessage(f_out, subMessage, f_fieldDescriptor->message_type(), f_initPrefix, f_currentPrefix+f_initPrefix);
                 //result += "\n" + f_currentPrefix + f_initPrefix + ":";
 
             }
@@ -110,7 +183,7 @@ std::string OutputFormatter::repeatedFieldValueToString(const grpc::protobuf::Me
         case grpc::protobuf::FieldDescriptor::Type::TYPE_INT32:
             {
                 int32_t value = reflection->GetRepeatedInt32(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromInt(value, f_modifier);
+                f_out.append(stringFromInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_SFIXED64:
@@ -118,71 +191,70 @@ std::string OutputFormatter::repeatedFieldValueToString(const grpc::protobuf::Me
         case grpc::protobuf::FieldDescriptor::Type::TYPE_INT64:
             {
                 int64_t value = reflection->GetRepeatedInt64(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromInt(value, f_modifier);
+                f_out.append(stringFromInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FIXED32:
         case grpc::protobuf::FieldDescriptor::Type::TYPE_UINT32:
             {
                 uint32_t value = reflection->GetRepeatedUInt32(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromUInt(value, f_modifier);
+                f_out.append(stringFromUInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FIXED64:
         case grpc::protobuf::FieldDescriptor::Type::TYPE_UINT64:
             {
                 uint64_t value = reflection->GetRepeatedUInt64(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromUInt(value, f_modifier);
+                f_out.append(stringFromUInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FLOAT:
             {
                 float value = reflection->GetRepeatedFloat(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromFloat(value, f_modifier);
+                f_out.append(stringFromFloat(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_DOUBLE:
             {
                 double value = reflection->GetRepeatedDouble(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromFloat(value, f_modifier);
+                f_out.append(stringFromFloat(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_BOOL:
             {
                 bool value = reflection->GetRepeatedBool(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromBool(value, f_modifier);
+                f_out.append(stringFromBool(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_STRING:
             {
                 std::string value = reflection->GetRepeatedString(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromString(value, f_modifier);
+                f_out.append(stringFromString(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_ENUM:
             {
                 const google::protobuf::EnumValueDescriptor * value = reflection->GetRepeatedEnum(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromEnum(value, f_modifier);
+                f_out.append(stringFromEnum(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_BYTES:
             {
                 std::string value = reflection->GetRepeatedString(f_message, f_fieldDescriptor, f_fieldIndex);
-                result += stringFromBytes(value, f_modifier, f_currentPrefix + f_initPrefix);
+                f_out.append(stringFromBytes(value, f_modifier, f_currentPrefix + f_initPrefix));
             }
             break;
         default:
-            return "repeated-" + std::string(f_fieldDescriptor->type_name()) + " is not yet supported :(";
+            f_out.append("repeated-" + std::string(f_fieldDescriptor->type_name()) + " is not yet supported :(");
+            return;
             break;
     }
 
-    return result;
 }
 
-std::string OutputFormatter::fieldValueToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, CustomStringModifier f_modifier)
+void OutputFormatter::writeFieldValue(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, CustomStringModifier f_modifier)
 {
     const google::protobuf::Reflection * reflection = f_message.GetReflection();
-    std::string result;
 
     // first, we need to check if this field is part of a OneOf:
     const google::protobuf::OneofDescriptor *	oneOfDesc = f_fieldDescriptor->containing_oneof();
@@ -194,9 +266,9 @@ std::string OutputFormatter::fieldValueToString(const grpc::protobuf::Message &
         {
             // no we are not set -> Do not continue to stringify this field,
             // as it is not set. Instead we add [NOT SET] to the field string:
-            result += "[NOT SET]";
+            f_out.append("[NOT SET]");
             // no need to decode any further...
-            return result;
+            return;
         }
     }
 
@@ -207,7 +279,7 @@ std::string OutputFormatter::fieldValueToString(const grpc::protobuf::Message &
         case grpc::protobuf::FieldDescriptor::Type::TYPE_INT32:
             {
                 int32_t value = reflection->GetInt32(f_message, f_fieldDescriptor);
-                result += stringFromInt(value, f_modifier);
+                f_out.append(stringFromInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_SFIXED64:
@@ -215,243 +287,329 @@ std::string OutputFormatter::fieldValueToString(const grpc::protobuf::Message &
         case grpc::protobuf::FieldDescriptor::Type::TYPE_INT64:
             {
                 int64_t value = reflection->GetInt64(f_message, f_fieldDescriptor);
-                result += stringFromInt(value, f_modifier);
+                f_out.append(stringFromInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FIXED32:
         case grpc::protobuf::FieldDescriptor::Type::TYPE_UINT32:
             {
                 uint32_t value = reflection->GetUInt32(f_message, f_fieldDescriptor);
-                result += stringFromUInt(value, f_modifier);
+                f_out.append(stringFromUInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FIXED64:
         case grpc::protobuf::FieldDescriptor::Type::TYPE_UINT64:
             {
                 uint64_t value = reflection->GetUInt64(f_message, f_fieldDescriptor);
-                result += stringFromUInt(value, f_modifier);
+                f_out.append(stringFromUInt(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_FLOAT:
             {
                 float value = reflection->GetFloat(f_message, f_fieldDescriptor);
-                result += stringFromFloat(value, f_modifier);
+                f_out.append(stringFromFloat(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_DOUBLE:
             {
                 double value = reflection->GetDouble(f_message, f_fieldDescriptor);
-                result += stringFromFloat(value, f_modifier);
+                f_out.append(stringFromFloat(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_BOOL:
             {
                 bool value = reflection->GetBool(f_message, f_fieldDescriptor);
-                result += stringFromBool(value, f_modifier);
+                f_out.append(stringFromBool(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_STRING:
             {
                 std::string value = reflection->GetString(f_message, f_fieldDescriptor);
-                result += stringFromString(value, f_modifier);
+                f_out.append(stringFromString(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_ENUM:
             {
                 const google::protobuf::EnumValueDescriptor * value = reflection->GetEnum(f_message, f_fieldDescriptor);
-                result += stringFromEnum(value, f_modifier);
+                f_out.append(stringFromEnum(value, f_modifier));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_BYTES:
             {
                 std::string value = reflection->GetString(f_message, f_fieldDescriptor);
-                result += stringFromBytes(value, f_modifier, f_currentPrefix + f_initPrefix);
+                f_out.append(stringFromBytes(value, f_modifier, f_currentPrefix + f_initPrefix));
             }
             break;
         case grpc::protobuf::FieldDescriptor::Type::TYPE_MESSAGE:
             {
                 const google::protobuf::Message & subMessage = reflection->GetMessage(f_message, f_fieldDescriptor);
                 //result += ":\n";
-                result += colorize(ColorClass::MessageTypeName, std::string("{") + f_fieldDescriptor->message_type()->name() + "}");
-                result += "\n";
-                result += messageToString(subMessage,f_fieldDescriptor->message_type(), f_initPrefix, f_currentPrefix+f_initPrefix);
+                f_out.append(colorize(ColorClass::MessageTypeName, std::string("{") + f_fieldDescriptor->message_type()->name() + "}"));
+                if( (not reflection->HasField(f_message, f_fieldDescriptor)) and isBeingFormatted(f_fieldDescriptor->message_type()) )
+                {
+                    // Unset field of a recursive message type. Printing its
+                    // default values would never terminate.
+                    f_out.append(" [NOT SET]");
+                    break;
+                }
+                f_out.append("\n");
+                writeMessage(f_out, subMessage, f_fieldDescriptor->message_type(), f_initPrefix, f_currentPrefix+f_initPrefix);
                 //result += "\n" + f_currentPrefix + f_initPrefix + ":";
             }
             break;
         default:
-            return std::string(f_fieldDescriptor->type_name()) + " is not yet supported :(";
+            f_out.append(std::string(f_fieldDescriptor->type_name()) + " is not yet supported :(");
+            return;
             break;
     }
 
+}
+
+/// @returns number of decimal digits of a non-negative number
+static size_t numberOfDigits(int f_value)
+{
+    size_t result = 1;
+    for(; f_value >= 10; f_value /= 10)
+    {
+        result++;
+    }
     return result;
 }
 
-std::string OutputFormatter::fieldToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, size_t maxFieldNameSize)
+void OutputFormatter::writeField(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const FieldLayout & f_field, const std::string & f_initPrefix, const std::string & f_currentPrefix, const std::string & f_coloredPrefix, size_t maxFieldNameSize, bool f_useAlignedLabel)
 {
-    std::string result;
-    const google::protobuf::Reflection * reflection = f_message.GetReflection();
+    const google::protobuf::FieldDescriptor * fieldDescriptor = f_field.descriptor;
 
-    if(f_fieldDescriptor->is_repeated())
+    if(fieldDescriptor->is_repeated())
     {
-        int numberOfRepetitions = reflection->FieldSize(f_message, f_fieldDescriptor);
+        const google::protobuf::Reflection * reflection = f_message.GetReflection();
+        int numberOfRepetitions = reflection->FieldSize(f_message, fieldDescriptor);
         if(numberOfRepetitions == 0)
         {
-            // TODO: remove duplicate code
-            result += colorize(ColorClass::VerticalGuides, f_currentPrefix);
-            std::string repName;
-            repName += colorize(ColorClass::RepeatedFieldName, f_fieldDescriptor->name());
-            repName += colorize(ColorClass::RepeatedCount, "[0/0]");
-            result += repName;
-            size_t nameSize = repName.size();
-            result += generateHorizontalGuide(nameSize, maxFieldNameSize);
-            result += " = " + colorize(ColorClass::MessageTypeName, "{}");
+            f_out.append(f_coloredPrefix);
+            f_out.append(f_field.emptyLabel);
+            f_out.append(generateHorizontalGuide(f_field.emptyLabel.size(), maxFieldNameSize));
+            f_out.append(" = " + colorize(ColorClass::MessageTypeName, "{}"));
         }
+        // closing part of the element counter is the same for all elements:
+        const std::string counterEnd = "/" + std::to_string(numberOfRepetitions) + "]" + getColor(ColorClass::Normal);
         for(int i = 0; i < numberOfRepetitions; i++)
         {
             if(i!=0)
             {
-                result += "\n";
+                f_out.append("\n");
             }
-            result += colorize(ColorClass::VerticalGuides, f_currentPrefix);
-            std::string repName;
-            repName += getColor(ColorClass::RepeatedFieldName) + f_fieldDescriptor->name() + getColor(ColorClass::Normal);
-            repName += getColor(ColorClass::RepeatedCount) + "[" + std::to_string(i+1) + "/" + std::to_string(numberOfRepetitions) + "]" + getColor(ColorClass::Normal);
-            result += repName;
-            size_t nameSize = repName.size();
-            result += generateHorizontalGuide(nameSize, maxFieldNameSize);
-            result += " = ";
-            result += repeatedFieldValueToString(f_message, f_fieldDescriptor, f_initPrefix, f_currentPrefix, i);
+            f_out.append(f_coloredPrefix);
+            f_out.append(f_field.label);
+            f_out.append(std::to_string(i+1));
+            f_out.append(counterEnd);
+            size_t nameSize = f_field.label.size() + numberOfDigits(i+1) + counterEnd.size();
+            f_out.append(generateHorizontalGuide(nameSize, maxFieldNameSize));
+            f_out.append(" = ");
+            writeRepeatedFieldValue(f_out, f_message, fieldDescriptor, f_initPrefix, f_currentPrefix, i);
         }
 
     }
     else
     {
-        result += colorize(ColorClass::VerticalGuides, f_currentPrefix);
-        result += colorize(ColorClass::NonRepeatedFieldName, f_fieldDescriptor->name());
-        size_t nameSize = f_fieldDescriptor->name().size();
-        result += generateHorizontalGuide(nameSize, maxFieldNameSize);
-        result += " = ";
-        result += fieldValueToString(f_message, f_fieldDescriptor, f_initPrefix, f_currentPrefix);
+        f_out.append(f_coloredPrefix);
+        if(f_useAlignedLabel)
+        {
+            f_out.append(f_field.alignedLabel);
+        }
+        else
+        {
+            f_out.append(f_field.label);
+            f_out.append(generateHorizontalGuide(fieldDescriptor->name().size(), maxFieldNameSize));
+            f_out.append(" = ");
+        }
+        writeFieldValue(f_out, f_message, fieldDescriptor, f_initPrefix, f_currentPrefix);
     }
 
-    return result;
+}
+
+bool OutputFormatter::isBeingFormatted(const grpc::protobuf::Descriptor* f_messageDescriptor)
+{
+    return std::find(m_messageStack.begin(), m_messageStack.end(), f_messageDescriptor) != m_messageStack.end();
 }
 
 std::string OutputFormatter::messageToString(const grpc::protobuf::Message & f_message, const grpc::protobuf::Descriptor* f_messageDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix)
 {
-    std::string result;
-    // first determine field name length maximum (for aligned formatting)
-    size_t maxFieldNameLength = 0;
-    for(int i = 0; i< f_messageDescriptor->field_count(); i++)
-    {
-        const google::protobuf::FieldDescriptor * fieldDesc = f_messageDescriptor->field(i);
-        size_t thisFieldNameLength = fieldDesc->name().size();
+    OutputBuffer out;
+    writeMessage(out, f_message, f_messageDescriptor, f_initPrefix, f_currentPrefix);
+    return out.takeString();
+}
 
-        if(fieldDesc->is_repeated())
-        {
-            const google::protobuf::Reflection * reflection = f_message.GetReflection();
-            int numberOfRepetitions = reflection->FieldSize(f_message, fieldDesc);
-            std::string simulatedMaxArr =  "[" + std::to_string(numberOfRepetitions) + "/" + std::to_string(numberOfRepetitions) + "]";
-            thisFieldNameLength += simulatedMaxArr.size();
-            
-            
-        }
-        if(thisFieldNameLength > maxFieldNameLength)
+void OutputFormatter::printMessage(std::ostream & f_stream, const grpc::protobuf::Message & f_message, const grpc::protobuf::Descriptor* f_messageDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix)
+{
+    OutputBuffer out(&f_stream);
+    writeMessage(out, f_message, f_messageDescriptor, f_initPrefix, f_currentPrefix);
+    out.flush();
+}
+
+std::string OutputFormatter::fieldValueToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, CustomStringModifier f_modifier)
+{
+    OutputBuffer out;
+    writeFieldValue(out, f_message, f_fieldDescriptor, f_initPrefix, f_currentPrefix, f_modifier);
+    return out.takeString();
+}
+
+std::string OutputFormatter::repeatedFieldValueToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, int f_fieldIndex, CustomStringModifier f_modifier)
+{
+    OutputBuffer out;
+    writeRepeatedFieldValue(out, f_message, f_fieldDescriptor, f_initPrefix, f_currentPrefix, f_fieldIndex, f_modifier);
+    return out.takeString();
+}
+
+void OutputFormatter::writeMessage(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const grpc::protobuf::Descriptor* f_messageDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix)
+{
+    m_messageStack.push_back(f_messageDescriptor);
+    const MessageLayout & layout = getLayout(f_messageDescriptor);
+
+    // field name length maximum (for aligned formatting) depends on the
+    // number of elements in repeated fields:
+    size_t maxFieldNameLength = layout.maxFieldNameLength;
+    if(layout.hasRepeatedFields)
+    {
+        const google::protobuf::Reflection * reflection = f_message.GetReflection();
+        for(const FieldLayout & field : layout.fields)
         {
-            maxFieldNameLength = thisFieldNameLength;
+            if(field.descriptor->is_repeated())
+            {
+                // simulated maximum counter "[N/N]":
+                int numberOfRepetitions = reflection->FieldSize(f_message, field.descriptor);
+                size_t thisFieldNameLength = field.descriptor->name().size() + 3 + 2*numberOfDigits(numberOfRepetitions);
+                maxFieldNameLength = std::max(maxFieldNameLength, thisFieldNameLength);
+            }
         }
     }
 
-    for(int i = 0; i< f_messageDescriptor->field_count(); i++)
+    const std::string coloredPrefix = colorize(ColorClass::VerticalGuides, f_currentPrefix);
+    for(size_t i = 0; i < layout.fields.size(); i++)
     {
-        const google::protobuf::FieldDescriptor * fieldDesc = f_messageDescriptor->field(i);
         if(i!=0)
         {
-            result += "\n";
+            f_out.append("\n");
         }
-        result += fieldToString(f_message, fieldDesc, f_initPrefix, f_currentPrefix, maxFieldNameLength);
+        writeField(f_out, f_message, layout.fields[i], f_initPrefix, f_currentPrefix, coloredPrefix, maxFieldNameLength, not layout.hasRepeatedFields);
     }
-    return result;
+    m_messageStack.pop_back();
 }
 
-std::string OutputFormatter::stringFromBytes(const std::string & f_value, const CustomStringModifier & f_modifier, const std::string & f_prefix)
+/// Lookup tables for the hexdump.
+class HexdumpTables
 {
-    std::string result;
-    // a simple hexdump:
-    const std::string & prefix = f_prefix;
-    result += "hex[" + std::to_string(f_value.size()) + "]";
-
-    std::string stringRepresentation = "";
-    size_t maxAddrTextSize = std::to_string(f_value.size()-1).size();
-    for(size_t i = 0; i<f_value.size(); )
-    {
-        // first decide on linebreaks, prefix etc:
-        if(i%8 == 0)
+    public:
+        HexdumpTables()
         {
-            if(f_value.size() > 8)
+            const char * digits = "0123456789abcdef";
+            for(int i = 0; i < 256; i++)
             {
-                result += "\n" + prefix;
-                std::stringstream streamAddr;
-                streamAddr << std::setfill (' ') << std::setw(maxAddrTextSize);
-                // TODO: should place address as hex also...
-                streamAddr << i;
-                result += streamAddr.str();
-                result += ": ";
-            }
-            else
-            {
-                result += " = ";
+                m_hex[2*i] = digits[i >> 4];
+                m_hex[2*i+1] = digits[i & 0x0f];
+                // string representable character range, '.' for special characters:
+                m_printable[i] = ( (i >= 32) and (i <= 126) ) ? static_cast<char>(i) : '.';
             }
         }
-        else if(i%4 == 0)
+
+        /// @returns two hex digits of the byte
+        const char * hex(uint8_t f_byte) const
         {
-            result += "  ";
+            return &m_hex[2*f_byte];
         }
-        else
+
+        char printable(uint8_t f_byte) const
         {
-            result += " ";
+            return m_printable[f_byte];
         }
 
-        // now do the actual hexdump:
-        // cast to uint16_t necessary, otherwise stream interprets the value as a char.
-        uint16_t byteVal = f_value[i] & 0xff;
-        std::stringstream stream;
-        stream << std::setfill ('0') << std::setw(2) << std::hex;
-        stream << byteVal;
-        result += stream.str();
+    private:
+        char m_hex[2*256];
+        char m_printable[256];
+};
 
-        // create string representation:
-        if( (f_value[i] >= 32) and (f_value[i] <= 126) )
+std::string OutputFormatter::stringFromBytes(const std::string & f_value, const CustomStringModifier & f_modifier, const std::string & f_prefix)
+{
+    static const HexdumpTables s_tables;
+    enum { s_bytesPerLine = 8, s_hexColumnSize = 3*s_bytesPerLine };
+
+    // a simple hexdump (8 bytes per line):
+    //   <prefix><address>: 41 42 43 44  45 46 47 48 |ABCDEFGH|
+    // Values of up to 8 bytes are printed in a single line without address.
+    const std::string & prefix = f_prefix;
+    const size_t size = f_value.size();
+    const size_t dumpSize = ( (m_maxBytesToDump > 0) and (size > m_maxBytesToDump) ) ? m_maxBytesToDump : size;
+    const bool multiLine = (size > s_bytesPerLine);
+    const size_t maxAddrTextSize = (size > 0) ? std::to_string(size-1).size() : 1;
+    const size_t lineHeaderSize = multiLine ? (1 + prefix.size() + maxAddrTextSize + 2) : 3;
+    const size_t numLines = (dumpSize + s_bytesPerLine - 1) / s_bytesPerLine;
+
+    std::string result = "hex[" + std::to_string(size) + "]";
+    size_t pos = result.size();
+    // every line has the same size, except for the string representation of
+    // the last line:
+    result.resize(pos + numLines * (lineHeaderSize + s_hexColumnSize + 3) + dumpSize);
+    char * out = &result[pos];
+
+    const uint8_t * data = reinterpret_cast<const uint8_t *>(f_value.data());
+    for(size_t lineStart = 0; lineStart < dumpSize; lineStart += s_bytesPerLine)
+    {
+        const size_t lineSize = std::min<size_t>(s_bytesPerLine, dumpSize - lineStart);
+
+        // line header:
+        if(multiLine)
         {
-            // string representable character range:
-            stringRepresentation += f_value[i];
+            *out++ = '\n';
+            out = std::copy(prefix.begin(), prefix.end(), out);
+            // TODO: should place address as hex also...
+            char * addrEnd = out + maxAddrTextSize;
+            size_t address = lineStart;
+            do
+            {
+                *--addrEnd = '0' + (address % 10);
+                address /= 10;
+            } while(address > 0);
+            std::fill(out, addrEnd, ' ');
+            out += maxAddrTextSize;
+            *out++ = ':';
+            *out++ = ' ';
         }
         else
         {
-            // special characters
-            stringRepresentation += ".";
+            out = std::copy_n(" = ", 3, out);
         }
 
-        i++;
+        // hex column: "41 42 43 44  45 46 47 48" padded with spaces
+        char * hexColumn = out;
+        std::fill(hexColumn, hexColumn + s_hexColumnSize, ' ');
+        for(size_t i = 0; i < lineSize; i++)
+        {
+            const char * hex = s_tables.hex(data[lineStart + i]);
+            char * digits = hexColumn + 3*i + ( (i >= 4) ? 1 : 0 );
+            digits[0] = hex[0];
+            digits[1] = hex[1];
+        }
+        out += s_hexColumnSize;
 
-        // Place string representation, when appropriate:
-        if( (i%8 == 0) or (i>=f_value.size()) )
+        // string representation:
+        *out++ = ' ';
+        *out++ = '|';
+        for(size_t i = 0; i < lineSize; i++)
         {
-            size_t padding = (8 - i%8)%8;
-            if(padding>3)
-            {
-                padding *=3;
-                padding += 1;
-            }
-            else
-            {
-                padding *=3;
-            }
-            result += std::string(padding, ' ');
-            result += " |" + stringRepresentation + "|";
-            stringRepresentation = "";
+            *out++ = s_tables.printable(data[lineStart + i]);
         }
+        *out++ = '|';
+    }
+
+    if(dumpSize < size)
+    {
+        result += (multiLine ? ("\n" + prefix) : std::string(" ")) + "... (" + std::to_string(size - dumpSize) + " more bytes)";
     }
     return result;
 }
+
+void OutputFormatter::setMaxBytesToDump(size_t f_maxBytes)
+{
+    m_maxBytesToDump = f_maxBytes;
+}
 }
@@ -17,9 +17,43 @@
 
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <unordered_map>
 
 namespace cli
 {
+    /// Collects formatted output.
+    /// If a stream is given, output is written to the stream in blocks of
+    /// s_flushSize bytes, so formatting huge messages does not hold their
+    /// complete text representation in memory.
+    class OutputBuffer
+    {
+        public:
+            /// @param f_stream stream to write to, or nullptr to collect the
+            ///        complete output (see takeString())
+            explicit OutputBuffer(std::ostream * f_stream = nullptr);
+
+            /// Flushes remaining output to the stream.
+            ~OutputBuffer();
+
+            OutputBuffer(const OutputBuffer &) = delete;
+            OutputBuffer & operator=(const OutputBuffer &) = delete;
+
+            void append(const std::string & f_text);
+
+            /// Writes buffered output to the stream (if any).
+            void flush();
+
+            /// @returns collected output (only if no stream is given)
+            std::string takeString();
+
+        private:
+            enum { s_flushSize = 64*1024 };
+
+            std::ostream * m_stream;
+            std::string m_buffer;
+    };
+
     /// Class with methods to format a protobuf message into human readable strings.
     class OutputFormatter
     {
@@ -65,6 +99,23 @@ namespace cli
                     const std::string & f_currentPrefix = ""
                     );
 
+            /// Formats a protobuf message like messageToString() and writes it
+            /// to a stream while formatting. Output starts before the complete
+            /// message is formatted and its text is never held in memory as a
+            /// whole.
+            /// @param f_stream stream to write the formatted message to
+            /// @param f_message the protobuf message to be formatted
+            /// @param f_messageDescriptor descriptor describing the message type
+            /// @param f_initPrefix see messageToString()
+            /// @param f_currentPrefix see messageToString()
+            void printMessage(
+                    std::ostream & f_stream,
+                    const grpc::protobuf::Message & f_message,
+                    const grpc::protobuf::Descriptor* f_messageDescriptor,
+                    const std::string & f_initPrefix = " ",
+                    const std::string & f_currentPrefix = ""
+                    );
+
             /// Clears the color map.
             /// Causes all output to be generated with default font (no terminal control characters).
             void clearColorMap();
@@ -80,12 +131,63 @@ namespace cli
             /// NOTE: required for custom output format
             std::string repeatedFieldValueToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, int f_fieldIndex, CustomStringModifier f_modifier = CustomStringModifier::None);
 
+            /// Limits hexdumps of bytes fields to the first bytes of the value.
+            /// The number of omitted bytes is printed instead of the rest.
+            /// @param f_maxBytes number of bytes to dump, 0 for no limit
+            void setMaxBytesToDump(size_t f_maxBytes);
+
         private:
             std::map<ColorClass, std::string> m_colorMap;
+
+            /// Precomputed output of a field, independent of the field value.
+            struct FieldLayout
+            {
+                const google::protobuf::FieldDescriptor * descriptor;
+
+                /// Colored field name. For repeated fields followed by the
+                /// colored opening bracket of the element counter.
+                std::string label;
+
+                /// Colored field name with counter of empty repeated fields.
+                std::string emptyLabel;
+
+                /// Label with horizontal guide and " = " of non-repeated
+                /// fields. Only valid if the message has no repeated fields,
+                /// as otherwise the alignment depends on the element counts.
+                std::string alignedLabel;
+            };
+
+            /// Precomputed output of a message type.
+            struct MessageLayout
+            {
+                std::vector<FieldLayout> fields;
+
+                /// Maximum field name length, without element counters.
+                size_t maxFieldNameLength = 0;
+
+                bool hasRepeatedFields = false;
+            };
+
+            /// Layouts of all message types formatted so far.
+            /// Depends on the color map, so it is cleared with it.
+            std::unordered_map<const grpc::protobuf::Descriptor *, MessageLayout> m_layoutCache;
+            const MessageLayout & getLayout(const grpc::protobuf::Descriptor* f_messageDescriptor);
+
+            /// Maximum number of bytes to dump per bytes field, 0 for no limit.
+            size_t m_maxBytesToDump = 0;
+
+            /// Message types currently being formatted (outermost first).
+            /// Used to detect recursive message types.
+            std::vector<const grpc::protobuf::Descriptor *> m_messageStack;
+            bool isBeingFormatted(const grpc::protobuf::Descriptor* f_messageDescriptor);
+
             std::string generateHorizontalGuide(size_t f_currentSize, size_t f_targetSize);
             std::string getColor(ColorClass f_colorClass);
             std::string colorize(ColorClass f_colorClass, const std::string & f_string);
-            std::string fieldToString(const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, size_t maxFieldNameSize);
+            void writeMessage(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const grpc::protobuf::Descriptor* f_messageDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix);
+            void writeField(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const FieldLayout & f_field, const std::string & f_initPrefix, const std::string & f_currentPrefix, const std::string & f_coloredPrefix, size_t maxFieldNameSize, bool f_useAlignedLabel);
+            void writeFieldValue(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, CustomStringModifier f_modifier = CustomStringModifier::None);
+            void writeRepeatedFieldValue(OutputBuffer & f_out, const grpc::protobuf::Message & f_message, const google::protobuf::FieldDescriptor * f_fieldDescriptor, const std::string & f_initPrefix, const std::string & f_currentPrefix, int f_fieldIndex, CustomStringModifier f_modifier = CustomStringModifier::None);
             template <typename T> std::string intToHexString(T f_value);
 
             // string formatting methods for various types:
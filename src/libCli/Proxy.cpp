@@ -0,0 +1,471 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Proxy.hpp>
+#include <libCli/cliUtils.hpp>
+
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/generic/async_generic_service.h>
+#include <grpcpp/generic/generic_stub.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+// for Unix socket handling
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+std::string getProxySocketPath()
+{
+    const char * runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if( (runtimeDir != nullptr) and (runtimeDir[0] != '\0') )
+    {
+        return std::string(runtimeDir) + "/gwhisper-proxy.sock";
+    }
+    return "/tmp/gwhisper-proxy-" + std::to_string(getuid()) + ".sock";
+}
+
+/// Prints a warning about an untrusted proxy socket (once per process, as the
+/// proxy is checked for every channel).
+static void warnUntrustedSocket(const std::string & f_socketPath, const std::string & f_reason)
+{
+    static bool warned = false;
+    if(not warned)
+    {
+        std::cerr << "Warning: Ignoring proxy socket " << f_socketPath << ", which " << f_reason << "." << std::endl;
+        warned = true;
+    }
+}
+
+bool isProxyRunning(const std::string & f_socketPath)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if(f_socketPath.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, f_socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    // The socket may be in a directory shared with other users (/tmp), so
+    // only a socket created by a proxy of the current user is used. Otherwise
+    // another user could intercept all calls by creating the socket first.
+    struct stat status;
+    if(lstat(f_socketPath.c_str(), &status) != 0)
+    {
+        return false;
+    }
+    if( (not S_ISSOCK(status.st_mode)) or (status.st_uid != getuid()) or ((status.st_mode & 0077) != 0) )
+    {
+        warnUntrustedSocket(f_socketPath, "is not private to the current user");
+        return false;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(fd < 0)
+    {
+        return false;
+    }
+    // fails immediately for stale sockets (e.g. of a killed proxy):
+    bool result = (connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0);
+    if(result)
+    {
+        // the socket might have been replaced after the check above:
+        struct ucred peer;
+        socklen_t peerSize = sizeof(peer);
+        if( (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) != 0) or (peer.uid != getuid()) )
+        {
+            warnUntrustedSocket(f_socketPath, "is served by another user");
+            result = false;
+        }
+    }
+    close(fd);
+    return result;
+}
+
+/// Keeps channels to the most recently used targets open.
+class ChannelCache
+{
+    public:
+        /// @returns channel to the target, created if not cached yet
+        std::shared_ptr<grpc::Channel> get(const std::string & f_target)
+        {
+            auto it = m_channels.find(f_target);
+            if(it == m_channels.end())
+            {
+                if(m_channels.size() >= s_maxChannels)
+                {
+                    evictLeastRecentlyUsed();
+                }
+                it = m_channels.insert(std::make_pair(f_target, Entry())).first;
+                it->second.channel = grpc::CreateChannel(f_target, grpc::InsecureChannelCredentials());
+            }
+            it->second.lastUse = ++m_useCounter;
+            return it->second.channel;
+        }
+
+        /// Removes the channel to the target from the cache (if cached).
+        void remove(const std::string & f_target)
+        {
+            m_channels.erase(f_target);
+        }
+
+    private:
+        enum { s_maxChannels = 32 };
+
+        struct Entry
+        {
+            std::shared_ptr<grpc::Channel> channel;
+            uint64_t lastUse;
+        };
+
+        void evictLeastRecentlyUsed()
+        {
+            auto oldest = m_channels.begin();
+            for(auto it = m_channels.begin(); it != m_channels.end(); ++it)
+            {
+                if(it->second.lastUse < oldest->second.lastUse)
+                {
+                    oldest = it;
+                }
+            }
+            m_channels.erase(oldest);
+        }
+
+        std::map<std::string, Entry> m_channels;
+        uint64_t m_useCounter = 0;
+};
+
+/// Forwards one call received by the proxy to its target.
+/// All operations of the server side (client -> proxy) and the backend side
+/// (proxy -> target) of the call are driven by one completion queue.
+/// Messages are forwarded as opaque byte buffers in both directions, so all
+/// call types (unary, streaming, reflection) are supported. The object
+/// deletes itself when the call is finished and all operations completed.
+class ProxyCall
+{
+    public:
+        /// Starts waiting for the next incoming call.
+        ProxyCall(grpc::AsyncGenericService & f_service, grpc::ServerCompletionQueue * f_cq, ChannelCache & f_channels, uint32_t f_connectTimeoutMs) :
+            m_service(f_service),
+            m_cq(f_cq),
+            m_channels(f_channels),
+            m_connectTimeoutMs(f_connectTimeoutMs),
+            m_stream(&m_serverContext)
+        {
+            m_serverContext.AsyncNotifyWhenDone(startOperation(&ProxyCall::onDone));
+            m_service.RequestCall(&m_serverContext, &m_stream, m_cq, m_cq, startOperation(&ProxyCall::onNewCall));
+        }
+
+        /// Dispatches an event received from the completion queue.
+        static void handleEvent(void * f_tag, bool f_ok)
+        {
+            Operation * operation = static_cast<Operation *>(f_tag);
+            ProxyCall * call = operation->call;
+            void (ProxyCall::*handler)(bool) = operation->handler;
+            delete operation;
+
+            call->m_pendingOperations--;
+            (call->*handler)(f_ok);
+            if(call->m_finished and (call->m_pendingOperations == 0))
+            {
+                delete call;
+            }
+        }
+
+    private:
+        /// Completion queue tag
+        struct Operation
+        {
+            ProxyCall * call;
+            void (ProxyCall::*handler)(bool);
+        };
+
+        void * startOperation(void (ProxyCall::*f_handler)(bool))
+        {
+            m_pendingOperations++;
+            return new Operation{this, f_handler};
+        }
+
+        void onNewCall(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                // server shutting down
+                m_finished = true;
+                return;
+            }
+            // accept the next call:
+            new ProxyCall(m_service, m_cq, m_channels, m_connectTimeoutMs);
+
+            m_channel = m_channels.get(m_serverContext.host());
+            m_connectDeadline = std::chrono::system_clock::now() + std::chrono::milliseconds(m_connectTimeoutMs);
+            connectBackend(true);
+        }
+
+        /// Waits (without blocking) for the channel to the target to connect.
+        void connectBackend(bool f_ok)
+        {
+            if(m_cancelled)
+            {
+                finish(grpc::Status::CANCELLED);
+                return;
+            }
+            grpc_connectivity_state state = m_channel->GetState(true);
+            if(state == GRPC_CHANNEL_READY)
+            {
+                startBackendCall();
+            }
+            else if( (state == GRPC_CHANNEL_TRANSIENT_FAILURE) or (state == GRPC_CHANNEL_SHUTDOWN) )
+            {
+                // The channel would only retry after a backoff, so we drop it
+                // and let the next call to this target connect from scratch:
+                m_channels.remove(m_serverContext.host());
+                finish(grpc::Status(grpc::StatusCode::UNAVAILABLE, "gWhisper proxy: cannot connect to " + m_serverContext.host()));
+            }
+            else if(std::chrono::system_clock::now() >= m_connectDeadline)
+            {
+                finish(grpc::Status(grpc::StatusCode::UNAVAILABLE, "gWhisper proxy: connection to " + m_serverContext.host() + " timed out"));
+            }
+            else
+            {
+                m_channel->NotifyOnStateChange(state, m_connectDeadline, m_cq, startOperation(&ProxyCall::connectBackend));
+            }
+        }
+
+        void startBackendCall()
+        {
+            for(auto & metadata : m_serverContext.client_metadata())
+            {
+                std::string key(metadata.first.data(), metadata.first.size());
+                if( (key.compare(0, 5, "grpc-") == 0) or (key == "user-agent") )
+                {
+                    // set by gRPC itself
+                    continue;
+                }
+                m_clientContext.AddMetadata(key, std::string(metadata.second.data(), metadata.second.size()));
+            }
+            m_clientContext.set_deadline(m_serverContext.deadline());
+
+            m_stub.reset(new grpc::GenericStub(m_channel));
+            m_backend = m_stub->PrepareCall(&m_clientContext, m_serverContext.method(), m_cq);
+            m_backendStarted = true;
+            m_backend->StartCall(startOperation(&ProxyCall::onBackendStarted));
+        }
+
+        void onBackendStarted(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                finishBackend();
+                return;
+            }
+            // forward both directions independently:
+            m_stream.Read(&m_requestBuffer, startOperation(&ProxyCall::onRequestRead));
+            m_backend->ReadInitialMetadata(startOperation(&ProxyCall::onBackendInitialMetadata));
+        }
+
+        // client -> target:
+
+        void onRequestRead(bool f_ok)
+        {
+            if(m_backendFinishing)
+            {
+                return;
+            }
+            if(f_ok)
+            {
+                m_backend->Write(m_requestBuffer, startOperation(&ProxyCall::onRequestWritten));
+            }
+            else
+            {
+                // client half-closed the call
+                m_backend->WritesDone(startOperation(&ProxyCall::onRequestsDone));
+            }
+        }
+
+        void onRequestWritten(bool f_ok)
+        {
+            if(f_ok and (not m_finishing))
+            {
+                m_stream.Read(&m_requestBuffer, startOperation(&ProxyCall::onRequestRead));
+            }
+            // else: backend call failed, status is forwarded by the reading side
+        }
+
+        void onRequestsDone(bool f_ok)
+        {
+        }
+
+        // target -> client:
+
+        void onBackendInitialMetadata(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                finishBackend();
+                return;
+            }
+            copyMetadata(m_clientContext.GetServerInitialMetadata(), &grpc::ServerContext::AddInitialMetadata);
+            m_backend->Read(&m_responseBuffer, startOperation(&ProxyCall::onResponseRead));
+        }
+
+        void onResponseRead(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                finishBackend();
+                return;
+            }
+            m_stream.Write(m_responseBuffer, startOperation(&ProxyCall::onResponseWritten));
+        }
+
+        void onResponseWritten(bool f_ok)
+        {
+            if(not f_ok)
+            {
+                // client is gone
+                m_clientContext.TryCancel();
+                finishBackend();
+                return;
+            }
+            m_backend->Read(&m_responseBuffer, startOperation(&ProxyCall::onResponseRead));
+        }
+
+        void finishBackend()
+        {
+            if(m_backendFinishing)
+            {
+                return;
+            }
+            m_backendFinishing = true;
+            m_backend->Finish(&m_backendStatus, startOperation(&ProxyCall::onBackendFinished));
+        }
+
+        void onBackendFinished(bool f_ok)
+        {
+            copyMetadata(m_clientContext.GetServerTrailingMetadata(), &grpc::ServerContext::AddTrailingMetadata);
+            finish(m_backendStatus);
+        }
+
+        void finish(const grpc::Status & f_status)
+        {
+            m_finishing = true;
+            m_stream.Finish(f_status, startOperation(&ProxyCall::onFinished));
+        }
+
+        void onFinished(bool f_ok)
+        {
+            m_finished = true;
+        }
+
+        void onDone(bool f_ok)
+        {
+            if(m_serverContext.IsCancelled())
+            {
+                m_cancelled = true;
+                if(m_backendStarted)
+                {
+                    m_clientContext.TryCancel();
+                }
+            }
+        }
+
+        void copyMetadata(const std::multimap<grpc::string_ref, grpc::string_ref> & f_metadata, void (grpc::ServerContext::*f_add)(const std::string &, const std::string &))
+        {
+            for(auto & metadata : f_metadata)
+            {
+                (m_serverContext.*f_add)(std::string(metadata.first.data(), metadata.first.size()), std::string(metadata.second.data(), metadata.second.size()));
+            }
+        }
+
+        grpc::AsyncGenericService & m_service;
+        grpc::ServerCompletionQueue * m_cq;
+        ChannelCache & m_channels;
+        uint32_t m_connectTimeoutMs;
+
+        grpc::GenericServerContext m_serverContext;
+        grpc::GenericServerAsyncReaderWriter m_stream;
+        grpc::ByteBuffer m_requestBuffer;
+
+        std::shared_ptr<grpc::Channel> m_channel;
+        std::chrono::system_clock::time_point m_connectDeadline;
+        std::unique_ptr<grpc::GenericStub> m_stub;
+        grpc::ClientContext m_clientContext;
+        std::unique_ptr<grpc::GenericClientAsyncReaderWriter> m_backend;
+        grpc::ByteBuffer m_responseBuffer;
+        grpc::Status m_backendStatus;
+
+        size_t m_pendingOperations = 0;
+        bool m_backendStarted = false;
+        bool m_backendFinishing = false;
+        bool m_finishing = false;
+        bool m_finished = false;
+        bool m_cancelled = false;
+};
+
+int runProxy(ParsedElement & f_parseTree)
+{
+    std::string socketPath = getProxySocketPath();
+    if(isProxyRunning(socketPath))
+    {
+        std::cerr << "Error: A gWhisper proxy is already running on " << socketPath << std::endl;
+        return -1;
+    }
+    // remove stale socket of a terminated proxy:
+    unlink(socketPath.c_str());
+
+    grpc::AsyncGenericService service;
+    grpc::ServerBuilder builder;
+    builder.AddListeningPort("unix:" + socketPath, grpc::InsecureServerCredentials());
+    builder.RegisterAsyncGenericService(&service);
+    // reflection requests are forwarded to the target:
+    disableServerPlugins(builder);
+    std::unique_ptr<grpc::ServerCompletionQueue> cq = builder.AddCompletionQueue();
+
+    // only the current user may connect to the socket:
+    mode_t oldUmask = umask(0077);
+    std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+    umask(oldUmask);
+    if(server == nullptr)
+    {
+        std::cerr << "Error: Cannot listen on " << socketPath << std::endl;
+        return -1;
+    }
+    std::cerr << "gWhisper proxy listening on " << socketPath << std::endl;
+
+    ChannelCache channels;
+    new ProxyCall(service, cq.get(), channels, getConnectTimeoutMs(&f_parseTree));
+
+    void * tag;
+    bool ok;
+    while(cq->Next(&tag, &ok))
+    {
+        ProxyCall::handleEvent(tag, ok);
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,41 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+
+#include <string>
+
+namespace cli
+{
+    /// Runs gWhisper in proxy mode (until terminated).
+    /// The proxy listens on a Unix socket (see getProxySocketPath()) and
+    /// forwards all gRPC calls (including reflection) to the target given as
+    /// authority of the call. Channels to recently used targets are kept open,
+    /// so subsequent gWhisper invocations do not pay DNS, TCP and HTTP/2
+    /// connection setup again.
+    /// @param f_parseTree Parse-tree containing options (e.g. connect timeout for targets)
+    /// @returns -1 if the proxy could not be started
+    int runProxy(ArgParse::ParsedElement & f_parseTree);
+
+    /// @returns path of the Unix socket the proxy listens on:
+    ///          $XDG_RUNTIME_DIR/gwhisper-proxy.sock or /tmp/gwhisper-proxy-<uid>.sock
+    std::string getProxySocketPath();
+
+    /// Checks if a proxy of the current user accepts connections on the given
+    /// socket. Sockets owned by or accessible to other users are refused.
+    /// @param f_socketPath path of the Unix socket
+    bool isProxyRunning(const std::string & f_socketPath);
+}
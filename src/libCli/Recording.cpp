@@ -0,0 +1,559 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Recording.hpp>
+
+#include <cstring>
+#include <set>
+
+// for truncating recordings before appending
+#include <unistd.h>
+
+namespace cli
+{
+
+// Recording file layout:
+// All integers are in native byte order. The file header is followed by
+// records, each consisting of a RecordHeader and the payload. Strings in
+// payloads are prefixed with their length (uint32_t), metadata with the
+// number of key/value pairs (uint32_t).
+// A properly closed recording ends with an index record (IndexEntry array)
+// and a Trailer pointing to it.
+namespace
+{
+    const char s_recordingMagic[8] = {'g', 'W', 'h', 'R', 'e', 'c', 'd', '1'};
+    const char s_trailerMagic[8] = {'g', 'W', 'h', 'R', 'I', 'd', 'x', '1'};
+    const uint32_t s_byteOrderMark = 0x01020304;
+
+    /// Records are written to the file in blocks of this size, or earlier
+    /// if the oldest buffered record is older than s_flushInterval.
+    const size_t s_bufferSize = 1024 * 1024;
+    const std::chrono::milliseconds s_flushInterval(1000);
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t byteOrderMark;
+        uint32_t reserved;
+    };
+
+    struct RecordHeader
+    {
+        uint32_t type;
+        uint32_t length;  // payload length
+        uint64_t timeNs;  // relative to the start of the recording
+    };
+
+    struct IndexEntry
+    {
+        uint64_t offset;  // offset of the record header
+        uint32_t type;
+        uint32_t reserved;
+    };
+
+    struct Trailer
+    {
+        uint64_t indexOffset; // offset of the index record header
+        char magic[8];
+    };
+
+    enum RecordType : uint32_t
+    {
+        TypeDescriptors = 1,      // serialized FileDescriptorSet
+        TypeCallStart = 2,        // method name, wall clock (int64_t ns), client metadata
+        TypeRequest = 3,          // serialized request
+        TypeInitialMetadata = 4,  // metadata
+        TypeReply = 5,            // serialized reply
+        TypeStatus = 6,           // code (uint32_t), message, trailing metadata
+        TypeIndex = 7             // IndexEntry array
+    };
+
+    template<typename T>
+    void appendValue(const T & f_value, std::string & f_out)
+    {
+        f_out.append(reinterpret_cast<const char *>(&f_value), sizeof(f_value));
+    }
+
+    void appendString(const char * f_data, size_t f_size, std::string & f_out)
+    {
+        appendValue(static_cast<uint32_t>(f_size), f_out);
+        f_out.append(f_data, f_size);
+    }
+
+    template<typename Map>
+    void appendMetadata(const Map & f_metadata, std::string & f_out)
+    {
+        appendValue(static_cast<uint32_t>(f_metadata.size()), f_out);
+        for(const auto & entry : f_metadata)
+        {
+            appendString(entry.first.data(), entry.first.size(), f_out);
+            appendString(entry.second.data(), entry.second.size(), f_out);
+        }
+    }
+
+    /// Reads values from a record payload. All reads fail once the end of
+    /// the payload is exceeded.
+    class PayloadReader
+    {
+        public:
+            PayloadReader(const Recording::Data & f_payload) :
+                m_position(f_payload.data),
+                m_end(f_payload.data + f_payload.size)
+            {
+            }
+
+            template<typename T>
+            bool readValue(T & f_out_value)
+            {
+                if(static_cast<size_t>(m_end - m_position) < sizeof(T))
+                {
+                    return false;
+                }
+                memcpy(&f_out_value, m_position, sizeof(T));
+                m_position += sizeof(T);
+                return true;
+            }
+
+            bool readString(std::string & f_out_string)
+            {
+                uint32_t size;
+                if( (not readValue(size)) or (static_cast<size_t>(m_end - m_position) < size) )
+                {
+                    return false;
+                }
+                f_out_string.assign(m_position, size);
+                m_position += size;
+                return true;
+            }
+
+            bool readMetadata(RecordedMetadata & f_out_metadata)
+            {
+                uint32_t count;
+                if(not readValue(count))
+                {
+                    return false;
+                }
+                f_out_metadata.clear();
+                for(uint32_t i = 0; i < count; i++)
+                {
+                    std::pair<std::string, std::string> entry;
+                    if( (not readString(entry.first)) or (not readString(entry.second)) )
+                    {
+                        return false;
+                    }
+                    f_out_metadata.push_back(std::move(entry));
+                }
+                return true;
+            }
+
+        private:
+            const char * m_position;
+            const char * m_end;
+    };
+}
+
+RecordingWriter::RecordingWriter()
+{
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    std::string error;
+    close(error);
+}
+
+bool RecordingWriter::open(const std::string & f_fileName, const google::protobuf::FileDescriptorSet & f_descriptors, bool f_append, std::string & f_out_error)
+{
+    google::protobuf::FileDescriptorSet descriptors = f_descriptors;
+    uint64_t endOfRecords = 0;
+    if(f_append and std::ifstream(f_fileName))
+    {
+        // append to the existing recording, replacing its index:
+        Recording existing;
+        if(not existing.load(f_fileName, f_out_error))
+        {
+            return false;
+        }
+        endOfRecords = existing.getEndOfRecords();
+        m_index = existing.getIndexEntries();
+
+        // only files not yet in the recording are added:
+        std::set<std::string> knownFiles;
+        for(const grpc::protobuf::FileDescriptorProto & file : existing.getDescriptors().file())
+        {
+            knownFiles.insert(file.name());
+        }
+        descriptors.clear_file();
+        for(const grpc::protobuf::FileDescriptorProto & file : f_descriptors.file())
+        {
+            if(knownFiles.count(file.name()) == 0)
+            {
+                *descriptors.add_file() = file;
+            }
+        }
+    }
+
+    if(endOfRecords > 0)
+    {
+        if(truncate(f_fileName.c_str(), endOfRecords) != 0)
+        {
+            f_out_error = "Cannot append to recording file '" + f_fileName + "'";
+            return false;
+        }
+        m_file.open(f_fileName, std::ios::binary | std::ios::in | std::ios::out);
+        m_file.seekp(endOfRecords);
+    }
+    else
+    {
+        m_file.open(f_fileName, std::ios::binary | std::ios::trunc | std::ios::out);
+    }
+    if(not m_file)
+    {
+        f_out_error = "Cannot create recording file '" + f_fileName + "'";
+        return false;
+    }
+    m_buffer.reserve(s_bufferSize);
+    m_start = Clock::now();
+    m_offset = endOfRecords;
+
+    if(endOfRecords == 0)
+    {
+        FileHeader header;
+        memcpy(header.magic, s_recordingMagic, sizeof(s_recordingMagic));
+        header.byteOrderMark = s_byteOrderMark;
+        header.reserved = 0;
+        appendValue(header, m_buffer);
+        m_offset = m_buffer.size();
+    }
+
+    if( (endOfRecords == 0) or (descriptors.file_size() > 0) )
+    {
+        writeRecord(TypeDescriptors, descriptors.SerializeAsString());
+    }
+    // the recording is readable from the start, even if gWhisper is killed:
+    flushBuffer();
+    return true;
+}
+
+void RecordingWriter::writeRecord(uint32_t f_type, const std::string & f_payload)
+{
+    appendValue(IndexEntry{m_offset, f_type, 0}, m_index);
+
+    Clock::time_point now = Clock::now();
+    if(m_buffer.empty())
+    {
+        m_oldestBufferedRecord = now;
+    }
+    RecordHeader header;
+    header.type = f_type;
+    header.length = static_cast<uint32_t>(f_payload.size());
+    header.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count();
+    appendValue(header, m_buffer);
+    m_buffer += f_payload;
+    m_offset += sizeof(header) + f_payload.size();
+
+    if( (m_buffer.size() >= s_bufferSize) or (now - m_oldestBufferedRecord >= s_flushInterval) )
+    {
+        flushBuffer();
+    }
+}
+
+void RecordingWriter::flushBuffer()
+{
+    m_file.write(m_buffer.data(), m_buffer.size());
+    m_file.flush();
+    m_buffer.clear();
+}
+
+void RecordingWriter::writeCallStart(const std::string & f_method, const std::multimap<grpc::string, grpc::string> & f_clientMetadata)
+{
+    std::string payload;
+    appendString(f_method.data(), f_method.size(), payload);
+    int64_t wallClockNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    appendValue(wallClockNs, payload);
+    appendMetadata(f_clientMetadata, payload);
+    writeRecord(TypeCallStart, payload);
+}
+
+void RecordingWriter::writeRequest(const std::string & f_serializedRequest)
+{
+    writeRecord(TypeRequest, f_serializedRequest);
+}
+
+void RecordingWriter::writeInitialMetadata(const std::multimap<grpc::string_ref, grpc::string_ref> & f_metadata)
+{
+    std::string payload;
+    appendMetadata(f_metadata, payload);
+    writeRecord(TypeInitialMetadata, payload);
+}
+
+void RecordingWriter::writeReply(const std::string & f_serializedReply)
+{
+    writeRecord(TypeReply, f_serializedReply);
+}
+
+void RecordingWriter::writeStatus(const grpc::Status & f_status, const std::multimap<grpc::string_ref, grpc::string_ref> & f_trailingMetadata)
+{
+    std::string payload;
+    appendValue(static_cast<uint32_t>(f_status.error_code()), payload);
+    appendString(f_status.error_message().data(), f_status.error_message().size(), payload);
+    appendMetadata(f_trailingMetadata, payload);
+    writeRecord(TypeStatus, payload);
+}
+
+bool RecordingWriter::close(std::string & f_out_error)
+{
+    if(not m_file.is_open())
+    {
+        return true;
+    }
+
+    uint64_t indexOffset = m_offset;
+    std::string index = m_index;
+    writeRecord(TypeIndex, index);
+
+    Trailer trailer;
+    trailer.indexOffset = indexOffset;
+    memcpy(trailer.magic, s_trailerMagic, sizeof(s_trailerMagic));
+    appendValue(trailer, m_buffer);
+    flushBuffer();
+
+    m_file.close();
+    if(m_file.fail())
+    {
+        f_out_error = "Writing the recording failed";
+        return false;
+    }
+    return true;
+}
+
+/// Adds a file after all of its transitive dependencies.
+static void addFileWithDependencies(const grpc::protobuf::FileDescriptor * f_file, std::set<std::string> & f_knownFiles, google::protobuf::FileDescriptorSet & f_out_descriptors)
+{
+    if(not f_knownFiles.insert(f_file->name()).second)
+    {
+        return;
+    }
+    for(int i = 0; i < f_file->dependency_count(); ++i)
+    {
+        addFileWithDependencies(f_file->dependency(i), f_knownFiles, f_out_descriptors);
+    }
+    f_file->CopyTo(f_out_descriptors.add_file());
+}
+
+void RecordingWriter::addMethodDescriptors(const grpc::protobuf::MethodDescriptor * f_method, google::protobuf::FileDescriptorSet & f_out_descriptors)
+{
+    std::set<std::string> knownFiles;
+    for(const grpc::protobuf::FileDescriptorProto & file : f_out_descriptors.file())
+    {
+        knownFiles.insert(file.name());
+    }
+    addFileWithDependencies(f_method->service()->file(), knownFiles, f_out_descriptors);
+}
+
+bool Recording::readRecord(uint64_t f_offset, Record & f_out_record) const
+{
+    RecordHeader header;
+    if( (f_offset > m_file.size()) or (m_file.size() - f_offset < sizeof(header)) )
+    {
+        return false;
+    }
+    memcpy(&header, m_file.data() + f_offset, sizeof(header));
+    if(m_file.size() - f_offset - sizeof(header) < header.length)
+    {
+        return false;
+    }
+    f_out_record.offset = f_offset;
+    f_out_record.type = header.type;
+    f_out_record.timeNs = header.timeNs;
+    f_out_record.payload.data = m_file.data() + f_offset + sizeof(header);
+    f_out_record.payload.size = header.length;
+    return true;
+}
+
+bool Recording::readIndex(std::vector<Record> & f_out_records) const
+{
+    Trailer trailer;
+    if(m_file.size() < sizeof(FileHeader) + sizeof(trailer))
+    {
+        return false;
+    }
+    memcpy(&trailer, m_file.data() + m_file.size() - sizeof(trailer), sizeof(trailer));
+    Record index;
+    if( (memcmp(trailer.magic, s_trailerMagic, sizeof(s_trailerMagic)) != 0)
+            or (not readRecord(trailer.indexOffset, index))
+            or (index.type != TypeIndex)
+            or (index.payload.size % sizeof(IndexEntry) != 0) )
+    {
+        return false;
+    }
+
+    std::vector<Record> records;
+    for(size_t i = 0; i < index.payload.size / sizeof(IndexEntry); i++)
+    {
+        IndexEntry entry;
+        memcpy(&entry, index.payload.data + i * sizeof(IndexEntry), sizeof(entry));
+        Record record;
+        if( (not readRecord(entry.offset, record)) or (record.type != entry.type) )
+        {
+            return false;
+        }
+        records.push_back(record);
+    }
+    f_out_records = std::move(records);
+    return true;
+}
+
+bool Recording::scanRecords(std::vector<Record> & f_out_records, std::string & f_out_error) const
+{
+    uint64_t offset = sizeof(FileHeader);
+    while(offset < m_file.size())
+    {
+        Record record;
+        if(not readRecord(offset, record))
+        {
+            // the recording was interrupted while writing this record:
+            break;
+        }
+        if(record.type == TypeIndex)
+        {
+            break;
+        }
+        f_out_records.push_back(record);
+        offset += sizeof(RecordHeader) + record.payload.size;
+    }
+    if( f_out_records.empty() or (f_out_records.front().type != TypeDescriptors) )
+    {
+        f_out_error = "The recording contains no descriptors";
+        return false;
+    }
+    return true;
+}
+
+bool Recording::load(const std::string & f_fileName, std::string & f_out_error)
+{
+    if(not m_file.map(f_fileName, f_out_error))
+    {
+        return false;
+    }
+
+    FileHeader header;
+    if(m_file.size() < sizeof(header))
+    {
+        f_out_error = "'" + f_fileName + "' is not a gWhisper recording";
+        return false;
+    }
+    memcpy(&header, m_file.data(), sizeof(header));
+    if( (memcmp(header.magic, s_recordingMagic, sizeof(s_recordingMagic)) != 0)
+            or (header.byteOrderMark != s_byteOrderMark) )
+    {
+        f_out_error = "'" + f_fileName + "' is not a gWhisper recording (or was written on a different platform)";
+        return false;
+    }
+
+    m_records.clear();
+    m_hasIndex = readIndex(m_records);
+    if( (not m_hasIndex) and (not scanRecords(m_records, f_out_error)) )
+    {
+        return false;
+    }
+
+    m_calls.clear();
+    m_descriptors.Clear();
+    std::set<std::string> knownFiles;
+    for(const Record & record : m_records)
+    {
+        PayloadReader reader(record.payload);
+        bool valid = true;
+        if(record.type == TypeDescriptors)
+        {
+            // appended calls may add descriptors:
+            google::protobuf::FileDescriptorSet descriptors;
+            valid = descriptors.ParseFromArray(record.payload.data, record.payload.size);
+            for(const grpc::protobuf::FileDescriptorProto & file : descriptors.file())
+            {
+                if(knownFiles.insert(file.name()).second)
+                {
+                    *m_descriptors.add_file() = file;
+                }
+            }
+        }
+        else if(record.type == TypeCallStart)
+        {
+            m_calls.emplace_back();
+            Call & call = m_calls.back();
+            call.startTimeNs = record.timeNs;
+            valid = reader.readString(call.method)
+                and reader.readValue(call.wallClockStartNs)
+                and reader.readMetadata(call.clientMetadata);
+        }
+        else if(m_calls.empty())
+        {
+            valid = false;
+        }
+        else if(record.type == TypeRequest)
+        {
+            m_calls.back().request = record.payload;
+        }
+        else if(record.type == TypeInitialMetadata)
+        {
+            valid = reader.readMetadata(m_calls.back().initialMetadata);
+        }
+        else if(record.type == TypeReply)
+        {
+            m_calls.back().replies.push_back(Reply{record.timeNs, record.payload});
+        }
+        else if(record.type == TypeStatus)
+        {
+            Call & call = m_calls.back();
+            uint32_t code;
+            valid = reader.readValue(code)
+                and reader.readString(call.statusMessage)
+                and reader.readMetadata(call.trailingMetadata);
+            call.statusCode = code;
+            call.finished = true;
+            call.finishTimeNs = record.timeNs;
+        }
+        // unknown record types are skipped, so newer recordings stay readable
+
+        if(not valid)
+        {
+            f_out_error = "'" + f_fileName + "' contains an invalid record";
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t Recording::getEndOfRecords() const
+{
+    if(m_records.empty())
+    {
+        return sizeof(FileHeader);
+    }
+    const Record & last = m_records.back();
+    return last.offset + sizeof(RecordHeader) + last.payload.size;
+}
+
+std::string Recording::getIndexEntries() const
+{
+    std::string result;
+    for(const Record & record : m_records)
+    {
+        appendValue(IndexEntry{record.offset, record.type, 0}, result);
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,197 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libCli/MappedFile.hpp>
+#include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
+#include <google/protobuf/descriptor.pb.h>
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cli
+{
+    /// Metadata key/value pairs of a recorded call.
+    typedef std::vector<std::pair<std::string, std::string>> RecordedMetadata;
+
+    /// Writes RPC calls to a recording file (--record=).
+    /// A recording is an append-only sequence of length-prefixed records
+    /// (requests, replies, metadata and status), each with a monotonic
+    /// timestamp relative to the start of the recording session. Calls of
+    /// later sessions may be appended to the same file. The first record
+    /// contains the FileDescriptorSet of the recorded methods, so recordings
+    /// can be decoded without access to the server.
+    /// Records are collected in a large buffer and written in blocks (at
+    /// least once a second while records arrive), so recording a reply costs
+    /// little more than copying it. The file header and descriptor set are
+    /// written immediately. close() appends an index of all records.
+    /// Recordings without index (e.g. if gWhisper was killed) are still
+    /// readable sequentially.
+    class RecordingWriter
+    {
+        public:
+            RecordingWriter();
+
+            /// Closes the recording (see close()).
+            ~RecordingWriter();
+
+            RecordingWriter(const RecordingWriter &) = delete;
+            RecordingWriter & operator=(const RecordingWriter &) = delete;
+
+            /// Creates the recording file and writes the file header and
+            /// descriptor set. An existing file is replaced, unless appending
+            /// is requested.
+            /// @param f_descriptors files defining the recorded methods
+            /// @param f_append if the file is an existing recording, append
+            ///        further calls to it (replacing its index). Only
+            ///        descriptors not yet in the recording are added.
+            /// @param f_out_error human readable error description, if the file cannot be created
+            /// @returns false on error
+            bool open(const std::string & f_fileName, const google::protobuf::FileDescriptorSet & f_descriptors, bool f_append, std::string & f_out_error);
+
+            /// @param f_method full name of the called method (e.g. "examples.TestService.Echo")
+            void writeCallStart(const std::string & f_method, const std::multimap<grpc::string, grpc::string> & f_clientMetadata);
+            void writeRequest(const std::string & f_serializedRequest);
+            void writeInitialMetadata(const std::multimap<grpc::string_ref, grpc::string_ref> & f_metadata);
+            void writeReply(const std::string & f_serializedReply);
+            void writeStatus(const grpc::Status & f_status, const std::multimap<grpc::string_ref, grpc::string_ref> & f_trailingMetadata);
+
+            /// Writes the index and closes the file. Does nothing if the file
+            /// is not open.
+            /// @returns false if writing to the file failed
+            bool close(std::string & f_out_error);
+
+            /// Adds the file defining a method and all its dependencies to a
+            /// descriptor set (each file once, dependencies first).
+            static void addMethodDescriptors(const grpc::protobuf::MethodDescriptor * f_method, google::protobuf::FileDescriptorSet & f_out_descriptors);
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            void writeRecord(uint32_t f_type, const std::string & f_payload);
+            void flushBuffer();
+
+            std::ofstream m_file;
+            std::string m_buffer;
+            /// Bytes written to the file or buffered.
+            uint64_t m_offset = 0;
+            /// Index entries of all records written so far, as written to
+            /// the index record.
+            std::string m_index;
+            Clock::time_point m_start;
+            /// Time the oldest record in m_buffer was written.
+            Clock::time_point m_oldestBufferedRecord;
+    };
+
+    /// Recording file written by RecordingWriter, memory mapped for reading.
+    class Recording
+    {
+        public:
+            /// Serialized message in the mapped file.
+            struct Data
+            {
+                const char * data = nullptr;
+                size_t size = 0;
+
+                std::string toString() const
+                {
+                    return std::string(data, size);
+                }
+            };
+
+            struct Reply
+            {
+                /// Reception time relative to the start of the recording session.
+                uint64_t timeNs;
+                Data message;
+            };
+
+            struct Call
+            {
+                /// Full name of the called method.
+                std::string method;
+                /// System clock at the start of the call, in ns since the epoch.
+                int64_t wallClockStartNs = 0;
+                /// Start time relative to the start of the recording session.
+                uint64_t startTimeNs = 0;
+                RecordedMetadata clientMetadata;
+                Data request;
+                RecordedMetadata initialMetadata;
+                std::vector<Reply> replies;
+
+                /// false if the recording ended before the call finished.
+                bool finished = false;
+                uint64_t finishTimeNs = 0;
+                int statusCode = 0;
+                std::string statusMessage;
+                RecordedMetadata trailingMetadata;
+            };
+
+            /// Maps and parses a recording.
+            /// @param f_out_error human readable error description, if the file is no valid recording
+            /// @returns false on error
+            bool load(const std::string & f_fileName, std::string & f_out_error);
+
+            /// @returns files defining the recorded methods
+            const google::protobuf::FileDescriptorSet & getDescriptors() const
+            {
+                return m_descriptors;
+            }
+
+            /// @returns all recorded calls, in order of recording
+            const std::vector<Call> & getCalls() const
+            {
+                return m_calls;
+            }
+
+            /// @returns true if the recording was closed properly and records
+            ///          were located via the index
+            bool hasIndex() const
+            {
+                return m_hasIndex;
+            }
+
+            /// @returns offset after the last record (excluding the index)
+            uint64_t getEndOfRecords() const;
+
+            /// @returns index entries of all records, as written to the
+            ///          index record
+            std::string getIndexEntries() const;
+
+        private:
+            struct Record
+            {
+                uint64_t offset;
+                uint32_t type;
+                uint64_t timeNs;
+                Data payload;
+            };
+
+            bool readIndex(std::vector<Record> & f_out_records) const;
+            bool scanRecords(std::vector<Record> & f_out_records, std::string & f_out_error) const;
+            bool readRecord(uint64_t f_offset, Record & f_out_record) const;
+
+            MappedFile m_file;
+            std::vector<Record> m_records;
+            google::protobuf::FileDescriptorSet m_descriptors;
+            std::vector<Call> m_calls;
+            bool m_hasIndex = false;
+    };
+}
@@ -0,0 +1,288 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Replay.hpp>
+#include <libCli/Interrupt.hpp>
+#include <libCli/Recording.hpp>
+#include <libCli/StreamStatistics.hpp>
+#include <libCli/cliUtils.hpp>
+#include <third_party/gRPC_utils/cli_call.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /// Outcome of one replayed call.
+    struct ReplayResult
+    {
+        int statusCode = 0;
+        std::string statusMessage;
+        uint64_t numberOfReplies = 0;
+        uint64_t latencyNs = 0;
+        /// Time the call was started after its scheduled start time.
+        uint64_t startDelayNs = 0;
+        /// false if the call was skipped, as the replay was interrupted.
+        bool replayed = false;
+    };
+}
+
+/// @returns path used by gRPC for a full method name, e.g.
+///          "/examples.TestService/Echo" for "examples.TestService.Echo"
+static std::string getMethodPath(const std::string & f_fullMethodName)
+{
+    size_t separator = f_fullMethodName.rfind('.');
+    return "/" + f_fullMethodName.substr(0, separator) + "/" + f_fullMethodName.substr(separator + 1);
+}
+
+/// Performs one recorded call.
+static ReplayResult replayCall(std::shared_ptr<grpc::Channel> f_channel, const Recording::Call & f_call)
+{
+    std::multimap<grpc::string, grpc::string> clientMetadata(f_call.clientMetadata.begin(), f_call.clientMetadata.end());
+    std::multimap<grpc::string_ref, grpc::string_ref> serverMetadata;
+    ReplayResult result;
+
+    Clock::time_point start = Clock::now();
+    grpc::testing::CliCall call(f_channel, getMethodPath(f_call.method), clientMetadata);
+    CancelOnInterrupt cancelOnInterrupt(call);
+    call.Write(f_call.request.toString());
+    call.WritesDone();
+    grpc::string serializedResponse;
+    for (bool init = true; call.Read(&serializedResponse, init ? &serverMetadata : nullptr); init= false)
+    {
+        result.numberOfReplies++;
+    }
+    grpc::Status status = call.Finish(&serverMetadata);
+    result.latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    result.statusCode = status.error_code();
+    result.statusMessage = status.error_message();
+    result.replayed = true;
+    return result;
+}
+
+/// Waits until the given time or until SIGINT was received (see
+/// InterruptScope). The signal cannot wake the thread, so it is checked
+/// periodically.
+/// @returns false if interrupted
+static bool sleepUntil(Clock::time_point f_time)
+{
+    while(not InterruptScope::isInterrupted())
+    {
+        Clock::time_point now = Clock::now();
+        if(now >= f_time)
+        {
+            return true;
+        }
+        std::this_thread::sleep_for(std::min<Clock::duration>(f_time - now, std::chrono::milliseconds(100)));
+    }
+    return false;
+}
+
+/// @returns percentiles of a latency histogram, e.g. "p50 1.2 ms, p99 3.4 ms, max 5.0 ms"
+static std::string getLatencySummary(const Histogram::Snapshot & f_latencies)
+{
+    return "p50 " + formatNanoseconds(f_latencies.getPercentile(50))
+        + ", p99 " + formatNanoseconds(f_latencies.getPercentile(99))
+        + ", max " + formatNanoseconds(f_latencies.max);
+}
+
+int replayRecording(ParsedElement & f_parseTree)
+{
+    std::string fileName = f_parseTree.findFirstChild("ReplayFile");
+    Recording recording;
+    std::string error;
+    if(not recording.load(fileName, error))
+    {
+        std::cerr << "Error: " << error << std::endl;
+        return -1;
+    }
+    const std::vector<Recording::Call> & calls = recording.getCalls();
+    if(calls.empty())
+    {
+        std::cerr << "Error: The recording contains no calls" << std::endl;
+        return -1;
+    }
+
+    // speed factor for the recorded inter-arrival times, 0 for as fast as
+    // possible:
+    double speed = 1.0;
+    std::string speedStr = f_parseTree.findFirstChild("ReplaySpeed");
+    if(speedStr == "max")
+    {
+        speed = 0;
+    }
+    else if(speedStr != "")
+    {
+        try
+        {
+            speed = std::stod(speedStr);
+        }
+        catch(std::out_of_range &)
+        {
+            std::cerr << "Error: The replay speed is out of range" << std::endl;
+            return -1;
+        }
+        if(speed <= 0)
+        {
+            std::cerr << "Error: The replay speed has to be greater than 0" << std::endl;
+            return -1;
+        }
+    }
+    uint64_t maxParallelCalls = 16;
+    if(not getNumericOption(&f_parseTree, "Parallel", "--parallel=", SIZE_MAX, maxParallelCalls))
+    {
+        return -1;
+    }
+    maxParallelCalls = std::max<uint64_t>(1, maxParallelCalls);
+
+    std::shared_ptr<grpc::Channel> channel = createChannel(&f_parseTree);
+    if(not waitForChannelConnected(channel, getConnectTimeoutMs(&f_parseTree)))
+    {
+        std::cerr << "Error: channel connection attempt timed out" << std::endl;
+        return -1;
+    }
+
+    // Ctrl-C cancels running calls and skips the remaining ones. Before,
+    // e.g. while connecting, it terminates gWhisper:
+    InterruptScope interruptScope;
+
+    // calls are started in recorded order. Each thread takes the next call
+    // and waits for its scheduled start time, so calls start late if all
+    // threads are busy:
+    std::vector<ReplayResult> results(calls.size());
+    Histogram latencies;
+    std::atomic<size_t> nextCall(0);
+    int64_t firstStartNs = calls.front().wallClockStartNs;
+    Clock::time_point replayStart = Clock::now();
+    auto replayCalls = [&]
+    {
+        for(size_t i = nextCall++; i < calls.size(); i = nextCall++)
+        {
+            Clock::time_point scheduled = replayStart;
+            if(speed > 0)
+            {
+                // bounded, so slow speeds cannot overflow the time point:
+                double offsetNs = std::min(std::max<int64_t>(0, calls[i].wallClockStartNs - firstStartNs) / speed, 1e18);
+                scheduled += std::chrono::nanoseconds(static_cast<int64_t>(offsetNs));
+            }
+            if(not sleepUntil(scheduled))
+            {
+                break;
+            }
+            uint64_t startDelayNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled).count();
+            results[i] = replayCall(channel, calls[i]);
+            results[i].startDelayNs = startDelayNs;
+            latencies.record(results[i].latencyNs);
+        }
+    };
+    std::vector<std::thread> threads;
+    for(size_t i = 0; i < std::min(maxParallelCalls, calls.size()); i++)
+    {
+        threads.emplace_back(replayCalls);
+    }
+    for(std::thread & thread : threads)
+    {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - replayStart).count();
+
+    // compare with the recording:
+    Histogram recordedLatencies;
+    size_t replayedCalls = 0;
+    // replayed calls which also finished in the recording:
+    size_t comparedCalls = 0;
+    double latencyDeltaSumNs = 0;
+    size_t statusDifferences = 0;
+    size_t replyDifferences = 0;
+    uint64_t maxStartDelayNs = 0;
+    for(size_t i = 0; i < calls.size(); i++)
+    {
+        const Recording::Call & recorded = calls[i];
+        const ReplayResult & result = results[i];
+        if(not result.replayed)
+        {
+            continue;
+        }
+        replayedCalls++;
+        std::string callName = "Call " + std::to_string(i + 1) + " (" + recorded.method + ")";
+        maxStartDelayNs = std::max(maxStartDelayNs, result.startDelayNs);
+        if(not recorded.finished)
+        {
+            // unknown status and latency
+            continue;
+        }
+        uint64_t recordedLatencyNs = recorded.finishTimeNs - recorded.startTimeNs;
+        recordedLatencies.record(recordedLatencyNs);
+        comparedCalls++;
+        latencyDeltaSumNs += double(result.latencyNs) - double(recordedLatencyNs);
+        if(result.statusCode != recorded.statusCode)
+        {
+            statusDifferences++;
+            std::cout << callName << ": status " << result.statusCode << " (" << result.statusMessage
+                << "), recorded " << recorded.statusCode << " (" << recorded.statusMessage << ")" << std::endl;
+        }
+        if(result.numberOfReplies != recorded.replies.size())
+        {
+            replyDifferences++;
+            std::cout << callName << ": " << result.numberOfReplies << " replies, recorded " << recorded.replies.size() << std::endl;
+        }
+    }
+
+    Histogram::Snapshot replayed = latencies.takeSnapshot(false);
+    Histogram::Snapshot original = recordedLatencies.takeSnapshot(false);
+    char summary[256];
+    snprintf(summary, sizeof(summary), "Replayed %zu calls in %.3f s", replayedCalls, seconds);
+    std::string speedName = (speedStr != "") ? speedStr : "1";
+    std::cout << summary << " (speed " << speedName << ", at most " << maxParallelCalls << " parallel calls)" << std::endl;
+    if(replayedCalls < calls.size())
+    {
+        std::cout << "Interrupted, " << (calls.size() - replayedCalls) << " of " << calls.size() << " calls were not replayed" << std::endl;
+    }
+    if(comparedCalls < replayedCalls)
+    {
+        std::cout << (replayedCalls - comparedCalls) << " calls did not finish in the recording and are not compared" << std::endl;
+    }
+    std::cout << "Status:   " << (comparedCalls - statusDifferences) << " as recorded, " << statusDifferences << " different" << std::endl;
+    std::cout << "Replies:  " << (comparedCalls - replyDifferences) << " as recorded, " << replyDifferences << " different" << std::endl;
+    std::cout << "Latency:  " << getLatencySummary(replayed) << std::endl;
+    if(comparedCalls > 0)
+    {
+        double meanDelta = latencyDeltaSumNs / comparedCalls;
+        std::cout << "Recorded: " << getLatencySummary(original) << " (mean latency "
+            << ( (meanDelta < 0) ? "-" : "+" ) << formatNanoseconds(std::fabs(meanDelta)) << " in replay, over "
+            << comparedCalls << " calls)" << std::endl;
+    }
+    if(speed > 0)
+    {
+        std::cout << "Schedule: calls started at most " << formatNanoseconds(maxStartDelayNs) << " late" << std::endl;
+    }
+
+    return ( (statusDifferences == 0) and (replayedCalls == calls.size()) ) ? 0 : -1;
+}
+
+}
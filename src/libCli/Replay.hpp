@@ -0,0 +1,31 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+
+namespace cli
+{
+    /// Sends the requests of all calls in a recording (given with --replay=,
+    /// see RecordingWriter) to the server given in the parse tree.
+    /// Calls are started with the inter-arrival times of the recording,
+    /// scaled by --replaySpeed= (or as fast as possible with
+    /// --replaySpeed=max). At most --parallel= calls run concurrently.
+    /// Status, number of replies and latency of each call are compared with
+    /// the recording and the differences are reported.
+    /// @param f_parseTree Parse tree containing server address and options
+    /// @returns 0 if all calls ended with the recorded status, -1 otherwise
+    int replayRecording(ArgParse::ParsedElement & f_parseTree);
+}
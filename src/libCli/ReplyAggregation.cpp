@@ -0,0 +1,487 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/ReplyAggregation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+void ReplyAggregation::Accumulator::add(ValueType f_type, const Value & f_value)
+{
+    bool first = (count == 0);
+    count++;
+    switch(f_type)
+    {
+        case ValueType::Signed:
+            overflow = __builtin_add_overflow(sum.signedValue, f_value.signedValue, &sum.signedValue) or overflow;
+            min.signedValue = first ? f_value.signedValue : std::min(min.signedValue, f_value.signedValue);
+            max.signedValue = first ? f_value.signedValue : std::max(max.signedValue, f_value.signedValue);
+            break;
+        case ValueType::Unsigned:
+            overflow = __builtin_add_overflow(sum.unsignedValue, f_value.unsignedValue, &sum.unsignedValue) or overflow;
+            min.unsignedValue = first ? f_value.unsignedValue : std::min(min.unsignedValue, f_value.unsignedValue);
+            max.unsignedValue = first ? f_value.unsignedValue : std::max(max.unsignedValue, f_value.unsignedValue);
+            break;
+        case ValueType::Float:
+            sum.floatValue += f_value.floatValue;
+            min.floatValue = first ? f_value.floatValue : std::min(min.floatValue, f_value.floatValue);
+            max.floatValue = first ? f_value.floatValue : std::max(max.floatValue, f_value.floatValue);
+            break;
+        default:
+            // strings and messages are only counted
+            break;
+    }
+}
+
+bool ReplyAggregation::compile(ParsedElement & f_aggregationTree, const grpc::protobuf::Descriptor * f_messageDescriptor, std::string & f_out_error)
+{
+    static const std::map<std::string, Function> functions = {
+        {"count", Function::Count},
+        {"sum", Function::Sum},
+        {"min", Function::Min},
+        {"max", Function::Max},
+        {"avg", Function::Avg},
+    };
+
+    m_aggregates.clear();
+    m_groupFields.clear();
+    m_groupNames.clear();
+    m_groupTypes.clear();
+    m_groups.clear();
+
+    std::vector<ParsedElement *> aggregates;
+    f_aggregationTree.findAllSubTrees("Aggregate", aggregates, true);
+    for(ParsedElement * aggregateTree : aggregates)
+    {
+        Aggregate aggregate;
+        std::string functionName = aggregateTree->findFirstChild("AggregateFunction");
+        std::string fieldPath = aggregateTree->findFirstChild("AggregateField");
+        aggregate.function = functions.at(functionName);
+        aggregate.name = functionName + "(" + fieldPath + ")";
+        if(fieldPath == "")
+        {
+            if(aggregate.function != Function::Count)
+            {
+                f_out_error = functionName + "() needs a field";
+                return false;
+            }
+        }
+        else
+        {
+            if(not resolvePath(fieldPath, f_messageDescriptor, true, aggregate.path, f_out_error))
+            {
+                return false;
+            }
+            const grpc::protobuf::FieldDescriptor * field = aggregate.path.back();
+            bool numeric = (field->cpp_type() != grpc::protobuf::FieldDescriptor::CPPTYPE_STRING)
+                and (field->cpp_type() != grpc::protobuf::FieldDescriptor::CPPTYPE_MESSAGE);
+            if( (aggregate.function != Function::Count) and (not numeric) )
+            {
+                f_out_error = "Field '" + fieldPath + "' is not numeric and can only be counted";
+                return false;
+            }
+            aggregate.type = getValueType(field);
+        }
+        m_aggregates.push_back(std::move(aggregate));
+    }
+
+    std::vector<ParsedElement *> groupFields;
+    f_aggregationTree.findAllSubTrees("AggregateGroupField", groupFields, true);
+    for(ParsedElement * groupField : groupFields)
+    {
+        std::string fieldPath = groupField->getMatchedString();
+        std::vector<const grpc::protobuf::FieldDescriptor *> path;
+        if(not resolvePath(fieldPath, f_messageDescriptor, false, path, f_out_error))
+        {
+            return false;
+        }
+        if(path.back()->cpp_type() == grpc::protobuf::FieldDescriptor::CPPTYPE_MESSAGE)
+        {
+            f_out_error = "Field '" + fieldPath + "' is a message and cannot be used for grouping";
+            return false;
+        }
+        m_groupTypes.push_back(getValueType(path.back()));
+        m_groupFields.push_back(std::move(path));
+        m_groupNames.push_back(fieldPath);
+    }
+    return true;
+}
+
+bool ReplyAggregation::resolvePath(const std::string & f_path, const grpc::protobuf::Descriptor * f_messageDescriptor, bool f_allowRepeated, std::vector<const grpc::protobuf::FieldDescriptor *> & f_out_path, std::string & f_out_error)
+{
+    const grpc::protobuf::Descriptor * messageDescriptor = f_messageDescriptor;
+    size_t nameStart = 0;
+    while(true)
+    {
+        size_t nameEnd = f_path.find('.', nameStart);
+        std::string fieldName = f_path.substr(nameStart, nameEnd - nameStart);
+        if(messageDescriptor == nullptr)
+        {
+            f_out_error = "Field '" + f_out_path.back()->name() + "' is no message and has no field '" + fieldName + "'";
+            return false;
+        }
+        const grpc::protobuf::FieldDescriptor * field = messageDescriptor->FindFieldByName(fieldName);
+        if(field == nullptr)
+        {
+            f_out_error = "Message type '" + messageDescriptor->full_name() + "' has no field '" + fieldName + "'";
+            return false;
+        }
+        if( field->is_repeated() and (not f_allowRepeated) )
+        {
+            f_out_error = "Repeated field '" + fieldName + "' cannot be used for grouping";
+            return false;
+        }
+        f_out_path.push_back(field);
+        messageDescriptor = field->message_type();
+        if(nameEnd == std::string::npos)
+        {
+            return true;
+        }
+        nameStart = nameEnd + 1;
+    }
+}
+
+std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> ReplyAggregation::getFieldPaths() const
+{
+    std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> result = m_groupFields;
+    for(const Aggregate & aggregate : m_aggregates)
+    {
+        if(not aggregate.path.empty())
+        {
+            result.push_back(aggregate.path);
+        }
+    }
+    return result;
+}
+
+ReplyAggregation::ValueType ReplyAggregation::getValueType(const grpc::protobuf::FieldDescriptor * f_field)
+{
+    switch(f_field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT32:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT64:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            return ValueType::Signed;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            return ValueType::Unsigned;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+            return ValueType::Float;
+        default:
+            return ValueType::Text;
+    }
+}
+
+ReplyAggregation::Value ReplyAggregation::getNumber(const grpc::protobuf::Message & f_message, const grpc::protobuf::FieldDescriptor * f_field, int f_index)
+{
+    const google::protobuf::Reflection * reflection = f_message.GetReflection();
+    bool repeated = f_field->is_repeated();
+    Value result;
+    switch(f_field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT32:
+            result.signedValue = repeated ? reflection->GetRepeatedInt32(f_message, f_field, f_index) : reflection->GetInt32(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT64:
+            result.signedValue = repeated ? reflection->GetRepeatedInt64(f_message, f_field, f_index) : reflection->GetInt64(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+            result.unsignedValue = repeated ? reflection->GetRepeatedUInt32(f_message, f_field, f_index) : reflection->GetUInt32(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+            result.unsignedValue = repeated ? reflection->GetRepeatedUInt64(f_message, f_field, f_index) : reflection->GetUInt64(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+            result.floatValue = repeated ? reflection->GetRepeatedDouble(f_message, f_field, f_index) : reflection->GetDouble(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+            result.floatValue = repeated ? reflection->GetRepeatedFloat(f_message, f_field, f_index) : reflection->GetFloat(f_message, f_field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            result.unsignedValue = (repeated ? reflection->GetRepeatedBool(f_message, f_field, f_index) : reflection->GetBool(f_message, f_field)) ? 1 : 0;
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            result.signedValue = repeated ? reflection->GetRepeatedEnumValue(f_message, f_field, f_index) : reflection->GetEnumValue(f_message, f_field);
+            break;
+        default:
+            // strings and messages are only counted
+            break;
+    }
+    return result;
+}
+
+void ReplyAggregation::accumulate(const grpc::protobuf::Message & f_message, const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path, size_t f_depth, Accumulator & f_accumulator)
+{
+    const google::protobuf::Reflection * reflection = f_message.GetReflection();
+    const grpc::protobuf::FieldDescriptor * field = f_path[f_depth];
+    bool last = (f_depth + 1 == f_path.size());
+    if(field->is_repeated())
+    {
+        int size = reflection->FieldSize(f_message, field);
+        for(int i = 0; i < size; i++)
+        {
+            if(last)
+            {
+                f_accumulator.add(getValueType(field), getNumber(f_message, field, i));
+            }
+            else
+            {
+                accumulate(reflection->GetRepeatedMessage(f_message, field, i), f_path, f_depth + 1, f_accumulator);
+            }
+        }
+    }
+    else if(last)
+    {
+        if( (field->cpp_type() != grpc::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) or reflection->HasField(f_message, field) )
+        {
+            f_accumulator.add(getValueType(field), getNumber(f_message, field, 0));
+        }
+    }
+    else if(reflection->HasField(f_message, field))
+    {
+        // unset submessages contain no values:
+        accumulate(reflection->GetMessage(f_message, field), f_path, f_depth + 1, f_accumulator);
+    }
+}
+
+std::string ReplyAggregation::getGroupValue(const grpc::protobuf::Message & f_message, const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path, Value & f_out_number)
+{
+    const grpc::protobuf::Message * message = &f_message;
+    for(size_t i = 0; i + 1 < f_path.size(); i++)
+    {
+        message = &message->GetReflection()->GetMessage(*message, f_path[i]);
+    }
+    const google::protobuf::Reflection * reflection = message->GetReflection();
+    const grpc::protobuf::FieldDescriptor * field = f_path.back();
+    f_out_number = getNumber(*message, field, 0);
+    switch(field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_STRING:
+            return reflection->GetString(*message, field);
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            return reflection->GetEnum(*message, field)->name();
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            return reflection->GetBool(*message, field) ? "true" : "false";
+        default:
+            return formatValue(getValueType(field), f_out_number);
+    }
+}
+
+void ReplyAggregation::add(const grpc::protobuf::Message & f_message)
+{
+    std::vector<std::string> values;
+    std::vector<Value> numbers(m_groupFields.size());
+    std::string key;
+    for(size_t i = 0; i < m_groupFields.size(); i++)
+    {
+        values.push_back(getGroupValue(f_message, m_groupFields[i], numbers[i]));
+        // length prefix, so values containing separators cannot collide:
+        key += std::to_string(values.back().size()) + ":" + values.back();
+    }
+
+    auto it = m_groups.find(key);
+    if(it == m_groups.end())
+    {
+        Group group;
+        group.values = std::move(values);
+        group.numbers = std::move(numbers);
+        group.accumulators.resize(m_aggregates.size());
+        it = m_groups.emplace(std::move(key), std::move(group)).first;
+    }
+
+    std::vector<Accumulator> & accumulators = it->second.accumulators;
+    for(size_t i = 0; i < m_aggregates.size(); i++)
+    {
+        const Aggregate & aggregate = m_aggregates[i];
+        if(aggregate.path.empty())
+        {
+            // count() counts messages:
+            accumulators[i].count++;
+            continue;
+        }
+        accumulate(f_message, aggregate.path, 0, accumulators[i]);
+    }
+}
+
+std::string ReplyAggregation::formatValue(ValueType f_type, const Value & f_value)
+{
+    switch(f_type)
+    {
+        case ValueType::Signed:
+            return std::to_string(f_value.signedValue);
+        case ValueType::Unsigned:
+            return std::to_string(f_value.unsignedValue);
+        default:
+            return formatNumber(f_value.floatValue);
+    }
+}
+
+bool ReplyAggregation::isLess(ValueType f_type, const Value & f_left, const Value & f_right)
+{
+    switch(f_type)
+    {
+        case ValueType::Signed:
+            return f_left.signedValue < f_right.signedValue;
+        case ValueType::Unsigned:
+            return f_left.unsignedValue < f_right.unsignedValue;
+        default:
+            if(std::isnan(f_left.floatValue) or std::isnan(f_right.floatValue))
+            {
+                return std::isnan(f_right.floatValue) and (not std::isnan(f_left.floatValue));
+            }
+            return f_left.floatValue < f_right.floatValue;
+    }
+}
+
+std::string ReplyAggregation::formatNumber(double f_value)
+{
+    char result[32];
+    if( (std::floor(f_value) == f_value) and (std::fabs(f_value) < 1e15) )
+    {
+        snprintf(result, sizeof(result), "%.0f", f_value);
+    }
+    else
+    {
+        snprintf(result, sizeof(result), "%.6g", f_value);
+    }
+    return result;
+}
+
+std::string ReplyAggregation::getTable() const
+{
+    // collect all cells, the first row is the header:
+    std::vector<std::vector<std::string>> rows;
+    rows.emplace_back(m_groupNames);
+    for(const Aggregate & aggregate : m_aggregates)
+    {
+        rows.back().push_back(aggregate.name);
+    }
+
+    std::vector<const Group *> groups;
+    for(const auto & group : m_groups)
+    {
+        groups.push_back(&group.second);
+    }
+    std::sort(groups.begin(), groups.end(), [this](const Group * f_a, const Group * f_b)
+            {
+                for(size_t i = 0; i < m_groupTypes.size(); i++)
+                {
+                    if(m_groupTypes[i] == ValueType::Text)
+                    {
+                        if(f_a->values[i] != f_b->values[i])
+                        {
+                            return f_a->values[i] < f_b->values[i];
+                        }
+                    }
+                    else if(isLess(m_groupTypes[i], f_a->numbers[i], f_b->numbers[i]))
+                    {
+                        return true;
+                    }
+                    else if(isLess(m_groupTypes[i], f_b->numbers[i], f_a->numbers[i]))
+                    {
+                        return false;
+                    }
+                }
+                // floats may only differ beyond the printed precision:
+                return f_a->values < f_b->values;
+            });
+
+    for(const Group * group : groups)
+    {
+        rows.emplace_back(group->values);
+        for(size_t i = 0; i < m_aggregates.size(); i++)
+        {
+            const Accumulator & accumulator = group->accumulators[i];
+            ValueType type = m_aggregates[i].type;
+            if( (m_aggregates[i].function != Function::Count) and (accumulator.count == 0) )
+            {
+                // the sum of no values is 0, all others are undefined:
+                rows.back().push_back( (m_aggregates[i].function == Function::Sum) ? "0" : "-");
+                continue;
+            }
+            if( accumulator.overflow and ( (m_aggregates[i].function == Function::Sum) or (m_aggregates[i].function == Function::Avg) ) )
+            {
+                rows.back().push_back("overflow");
+                continue;
+            }
+            switch(m_aggregates[i].function)
+            {
+                case Function::Count:
+                    rows.back().push_back(std::to_string(accumulator.count));
+                    break;
+                case Function::Sum:
+                    rows.back().push_back(formatValue(type, accumulator.sum));
+                    break;
+                case Function::Min:
+                    rows.back().push_back(formatValue(type, accumulator.min));
+                    break;
+                case Function::Max:
+                    rows.back().push_back(formatValue(type, accumulator.max));
+                    break;
+                case Function::Avg:
+                    {
+                        double sum = (type == ValueType::Signed) ? double(accumulator.sum.signedValue)
+                            : (type == ValueType::Unsigned) ? double(accumulator.sum.unsignedValue)
+                            : accumulator.sum.floatValue;
+                        rows.back().push_back(formatNumber(sum / accumulator.count));
+                    }
+                    break;
+            }
+        }
+    }
+
+    std::vector<size_t> widths(rows.front().size(), 0);
+    for(const auto & row : rows)
+    {
+        for(size_t i = 0; i < row.size(); i++)
+        {
+            widths[i] = std::max(widths[i], row[i].size());
+        }
+    }
+
+    // group values are left aligned, aggregates right aligned:
+    std::string result;
+    for(const auto & row : rows)
+    {
+        for(size_t i = 0; i < row.size(); i++)
+        {
+            std::string padding(widths[i] - row[i].size(), ' ');
+            if(i > 0)
+            {
+                result += "  ";
+            }
+            if(i < m_groupNames.size())
+            {
+                result += row[i] + ( (i + 1 < row.size()) ? padding : "" );
+            }
+            else
+            {
+                result += padding + row[i];
+            }
+        }
+        result += "\n";
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,153 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+#include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cli
+{
+    /// Aggregation of numeric reply fields given with --aggregate, e.g.
+    /// "sum(bytes), max(latency_us), count() by status".
+    /// The expression is compiled once against the reply message type, so
+    /// each reply only reads the resolved fields and updates the accumulators
+    /// of its group. Groups are kept in a hash map keyed by the values of the
+    /// group fields.
+    /// Fields of repeated messages and repeated scalar fields contribute one
+    /// value per element.
+    class ReplyAggregation
+    {
+        public:
+            /// Compiles the aggregation expression of a parse tree.
+            /// @param f_aggregationTree parse tree of the expression (element "Aggregation")
+            /// @param f_messageDescriptor type of the aggregated messages
+            /// @param f_out_error description of the problem if compilation fails
+            /// @returns false if the expression does not fit the message type
+            bool compile(ArgParse::ParsedElement & f_aggregationTree, const grpc::protobuf::Descriptor * f_messageDescriptor, std::string & f_out_error);
+
+            /// Adds the field values of a reply to the accumulators of its group.
+            void add(const grpc::protobuf::Message & f_message);
+
+            /// @returns a table with one row per group (sorted by the group
+            ///          values, numbers and enum values by their numeric
+            ///          value) and one column per group field and aggregate
+            std::string getTable() const;
+
+            /// @returns paths of all fields read by the aggregation, starting
+            ///          at the aggregated message type
+            std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> getFieldPaths() const;
+
+        private:
+            enum class Function
+            {
+                Count,
+                Sum,
+                Min,
+                Max,
+                Avg
+            };
+
+            /// Type the values of a field are accumulated and sorted as.
+            /// Integers are kept exactly.
+            enum class ValueType
+            {
+                Signed,
+                Unsigned,
+                Float,
+                Text
+            };
+
+            /// A numeric field value, as its ValueType.
+            struct Value
+            {
+                int64_t signedValue = 0;
+                uint64_t unsignedValue = 0;
+                double floatValue = 0;
+            };
+
+            struct Aggregate
+            {
+                Function function;
+                ValueType type = ValueType::Text;
+                /// Column header, e.g. "sum(bytes)".
+                std::string name;
+                /// Fields from the reply message to the aggregated field,
+                /// empty for count().
+                std::vector<const grpc::protobuf::FieldDescriptor *> path;
+            };
+
+            struct Accumulator
+            {
+                uint64_t count = 0;
+                /// Only valid if count > 0.
+                Value sum;
+                Value min;
+                Value max;
+                /// true if an integer sum exceeded the range of its type.
+                bool overflow = false;
+
+                void add(ValueType f_type, const Value & f_value);
+            };
+
+            struct Group
+            {
+                /// Values of the group fields, as printed.
+                std::vector<std::string> values;
+                /// Numeric values of the group fields, for sorting.
+                std::vector<Value> numbers;
+                /// One accumulator per aggregate.
+                std::vector<Accumulator> accumulators;
+            };
+
+            std::vector<Aggregate> m_aggregates;
+
+            std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> m_groupFields;
+            std::vector<std::string> m_groupNames;
+            std::vector<ValueType> m_groupTypes;
+
+            /// Groups by key: the length-prefixed values of all group fields
+            /// concatenated (built in add()).
+            std::unordered_map<std::string, Group> m_groups;
+
+            /// Resolves a dot separated field path.
+            /// @param f_allowRepeated if false, repeated fields are rejected
+            static bool resolvePath(const std::string & f_path, const grpc::protobuf::Descriptor * f_messageDescriptor, bool f_allowRepeated, std::vector<const grpc::protobuf::FieldDescriptor *> & f_out_path, std::string & f_out_error);
+
+            /// Adds all values of a field path (starting at f_depth) to an accumulator.
+            static void accumulate(const grpc::protobuf::Message & f_message, const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path, size_t f_depth, Accumulator & f_accumulator);
+
+            /// Reads the value of a non-repeated scalar field.
+            /// @param f_out_number the value if the field is numeric
+            /// @returns the value as printed in the table
+            static std::string getGroupValue(const grpc::protobuf::Message & f_message, const std::vector<const grpc::protobuf::FieldDescriptor *> & f_path, Value & f_out_number);
+
+            static ValueType getValueType(const grpc::protobuf::FieldDescriptor * f_field);
+
+            /// @returns element f_index of a numeric field (f_index is ignored
+            ///          for non-repeated fields), stored as getValueType()
+            static Value getNumber(const grpc::protobuf::Message & f_message, const grpc::protobuf::FieldDescriptor * f_field, int f_index);
+
+            /// @returns true if f_left is sorted before f_right (not-a-number last)
+            static bool isLess(ValueType f_type, const Value & f_left, const Value & f_right);
+
+            static std::string formatValue(ValueType f_type, const Value & f_value);
+            static std::string formatNumber(double f_value);
+    };
+}
@@ -0,0 +1,531 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/ReplyFilter.hpp>
+
+#include <google/protobuf/wire_format_lite.h>
+
+#include <stdexcept>
+
+using namespace ArgParse;
+using google::protobuf::internal::WireFormatLite;
+
+namespace cli
+{
+
+/// Parses a complete string as integer (decimal, 0x-hex or 0-octal).
+/// @returns false if the string is no valid number
+template<typename T>
+static bool parseInteger(const std::string & f_string, T (*f_convert)(const std::string &, size_t *, int), T & f_out_value)
+{
+    try
+    {
+        size_t parsed = 0;
+        f_out_value = f_convert(f_string, &parsed, 0);
+        return parsed == f_string.size();
+    }
+    catch(std::exception &)
+    {
+        return false;
+    }
+}
+
+static long long toSigned(const std::string & f_string, size_t * f_pos, int f_base)
+{
+    return std::stoll(f_string, f_pos, f_base);
+}
+
+static unsigned long long toUnsigned(const std::string & f_string, size_t * f_pos, int f_base)
+{
+    if( (not f_string.empty()) and (f_string[0] == '-') )
+    {
+        throw std::invalid_argument("negative value");
+    }
+    return std::stoull(f_string, f_pos, f_base);
+}
+
+bool ReplyFilter::compile(ParsedElement & f_filterTree, const grpc::protobuf::Descriptor * f_messageDescriptor, std::string & f_out_error)
+{
+    std::vector<ParsedElement *> conditions;
+    f_filterTree.findAllSubTrees("FilterCondition", conditions, true);
+    std::vector<ParsedElement *> connectors;
+    f_filterTree.findAllSubTrees("FilterConnector", connectors, true);
+
+    m_alternatives.clear();
+    m_alternatives.emplace_back();
+    m_defaultValues.clear();
+    m_evaluateSerialized = true;
+    for(size_t i = 0; i < conditions.size(); i++)
+    {
+        Condition condition;
+        if(not compileCondition(*conditions[i], f_messageDescriptor, condition, f_out_error))
+        {
+            return false;
+        }
+        m_defaultValues.push_back(getDefaultValue(condition.path.back()));
+        m_alternatives.back().push_back(std::move(condition));
+
+        if( (i < connectors.size()) and (connectors[i]->getMatchedString() == "||") )
+        {
+            m_alternatives.emplace_back();
+        }
+    }
+    return true;
+}
+
+std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> ReplyFilter::getFieldPaths() const
+{
+    std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> result;
+    for(const std::vector<Condition> & conditions : m_alternatives)
+    {
+        for(const Condition & condition : conditions)
+        {
+            result.push_back(condition.path);
+        }
+    }
+    return result;
+}
+
+bool ReplyFilter::compileCondition(ParsedElement & f_conditionTree, const grpc::protobuf::Descriptor * f_messageDescriptor, Condition & f_out_condition, std::string & f_out_error)
+{
+    // resolve the field path:
+    std::string fieldPath = f_conditionTree.findFirstChild("FilterField");
+    const grpc::protobuf::Descriptor * messageDescriptor = f_messageDescriptor;
+    size_t nameStart = 0;
+    while(true)
+    {
+        size_t nameEnd = fieldPath.find('.', nameStart);
+        std::string fieldName = fieldPath.substr(nameStart, nameEnd - nameStart);
+        if(messageDescriptor == nullptr)
+        {
+            f_out_error = "Field '" + f_out_condition.path.back()->name() + "' is no message and has no field '" + fieldName + "'";
+            return false;
+        }
+        const grpc::protobuf::FieldDescriptor * field = messageDescriptor->FindFieldByName(fieldName);
+        if(field == nullptr)
+        {
+            f_out_error = "Message type '" + messageDescriptor->full_name() + "' has no field '" + fieldName + "'";
+            return false;
+        }
+        if(field->is_repeated())
+        {
+            f_out_error = "Repeated field '" + fieldName + "' cannot be used in a filter";
+            return false;
+        }
+        f_out_condition.path.push_back(field);
+        messageDescriptor = field->message_type();
+        if(nameEnd == std::string::npos)
+        {
+            break;
+        }
+        nameStart = nameEnd + 1;
+    }
+
+    const grpc::protobuf::FieldDescriptor * field = f_out_condition.path.back();
+    if(field->cpp_type() == grpc::protobuf::FieldDescriptor::CPPTYPE_MESSAGE)
+    {
+        f_out_error = "Field '" + fieldPath + "' is a message and cannot be compared";
+        return false;
+    }
+    if( (f_out_condition.path.size() > 1) or (field->containing_oneof() != nullptr) )
+    {
+        m_evaluateSerialized = false;
+    }
+
+    std::string op = f_conditionTree.findFirstChild("FilterOperator");
+    if(op == "==") f_out_condition.op = Operator::Equal;
+    else if(op == "!=") f_out_condition.op = Operator::NotEqual;
+    else if(op == "<") f_out_condition.op = Operator::Less;
+    else if(op == "<=") f_out_condition.op = Operator::LessEqual;
+    else if(op == ">") f_out_condition.op = Operator::Greater;
+    else f_out_condition.op = Operator::GreaterEqual;
+
+    // convert the value to the field type:
+    std::string valueString = f_conditionTree.findFirstChild("FilterValue");
+    if( (valueString.size() >= 2) and (valueString.front() == '"') and (valueString.back() == '"') )
+    {
+        valueString = valueString.substr(1, valueString.size() - 2);
+    }
+    bool valid = true;
+    Value & value = f_out_condition.value;
+    switch(field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT32:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT64:
+            f_out_condition.type = ValueType::Signed;
+            {
+                long long parsed = 0;
+                valid = parseInteger<long long>(valueString, toSigned, parsed);
+                value.signedValue = parsed;
+            }
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+            f_out_condition.type = ValueType::Unsigned;
+            {
+                unsigned long long parsed = 0;
+                valid = parseInteger<unsigned long long>(valueString, toUnsigned, parsed);
+                value.unsignedValue = parsed;
+            }
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            f_out_condition.type = ValueType::Unsigned;
+            valid = (valueString == "true") or (valueString == "false");
+            value.unsignedValue = (valueString == "true") ? 1 : 0;
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            f_out_condition.type = ValueType::Signed;
+            {
+                const google::protobuf::EnumValueDescriptor * enumValue = field->enum_type()->FindValueByName(valueString);
+                if(enumValue != nullptr)
+                {
+                    value.signedValue = enumValue->number();
+                }
+                else
+                {
+                    long long parsed = 0;
+                    valid = parseInteger<long long>(valueString, toSigned, parsed);
+                    value.signedValue = parsed;
+                }
+            }
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+            f_out_condition.type = ValueType::Float;
+            try
+            {
+                size_t parsed = 0;
+                value.floatValue = std::stod(valueString, &parsed);
+                valid = (parsed == valueString.size());
+            }
+            catch(std::exception &)
+            {
+                valid = false;
+            }
+            if(field->cpp_type() == grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT)
+            {
+                // compare with the value as it can be stored in the field:
+                value.floatValue = static_cast<float>(value.floatValue);
+            }
+            break;
+        default:
+            f_out_condition.type = ValueType::String;
+            value.stringValue = valueString;
+            break;
+    }
+    if(not valid)
+    {
+        f_out_error = "Invalid value '" + valueString + "' for field '" + fieldPath + "' of type " + field->type_name();
+        return false;
+    }
+    return true;
+}
+
+template<typename T>
+static bool compare(const T & f_left, const T & f_right, int f_op)
+{
+    switch(f_op)
+    {
+        case 0: return f_left == f_right;
+        case 1: return f_left != f_right;
+        case 2: return f_left < f_right;
+        case 3: return f_left <= f_right;
+        case 4: return f_left > f_right;
+        default: return f_left >= f_right;
+    }
+}
+
+bool ReplyFilter::evaluate(const Condition & f_condition, const Value & f_fieldValue) const
+{
+    int op = static_cast<int>(f_condition.op);
+    switch(f_condition.type)
+    {
+        case ValueType::Signed:
+            return compare(f_fieldValue.signedValue, f_condition.value.signedValue, op);
+        case ValueType::Unsigned:
+            return compare(f_fieldValue.unsignedValue, f_condition.value.unsignedValue, op);
+        case ValueType::Float:
+            return compare(f_fieldValue.floatValue, f_condition.value.floatValue, op);
+        default:
+            return compare(f_fieldValue.stringValue, f_condition.value.stringValue, op);
+    }
+}
+
+bool ReplyFilter::evaluateAll(const std::vector<Value> & f_fieldValues) const
+{
+    size_t valueIndex = 0;
+    for(const std::vector<Condition> & conditions : m_alternatives)
+    {
+        bool allMatch = true;
+        for(const Condition & condition : conditions)
+        {
+            allMatch = allMatch and evaluate(condition, f_fieldValues[valueIndex]);
+            valueIndex++;
+        }
+        if(allMatch)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ReplyFilter::matches(const grpc::protobuf::Message & f_message) const
+{
+    std::vector<Value> fieldValues;
+    fieldValues.reserve(m_defaultValues.size());
+    for(const std::vector<Condition> & conditions : m_alternatives)
+    {
+        for(const Condition & condition : conditions)
+        {
+            fieldValues.push_back(getValue(f_message, condition));
+        }
+    }
+    return evaluateAll(fieldValues);
+}
+
+ReplyFilter::Value ReplyFilter::getValue(const grpc::protobuf::Message & f_message, const Condition & f_condition)
+{
+    // unset submessages are default instances, so their fields have default
+    // values:
+    const grpc::protobuf::Message * message = &f_message;
+    for(size_t i = 0; i + 1 < f_condition.path.size(); i++)
+    {
+        message = &message->GetReflection()->GetMessage(*message, f_condition.path[i]);
+    }
+
+    const google::protobuf::Reflection * reflection = message->GetReflection();
+    const grpc::protobuf::FieldDescriptor * field = f_condition.path.back();
+    Value result;
+    switch(field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT32:
+            result.signedValue = reflection->GetInt32(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT64:
+            result.signedValue = reflection->GetInt64(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+            result.unsignedValue = reflection->GetUInt32(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+            result.unsignedValue = reflection->GetUInt64(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            result.unsignedValue = reflection->GetBool(*message, field) ? 1 : 0;
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            result.signedValue = reflection->GetEnumValue(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+            result.floatValue = reflection->GetFloat(*message, field);
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+            result.floatValue = reflection->GetDouble(*message, field);
+            break;
+        default:
+            result.stringValue = reflection->GetString(*message, field);
+            break;
+    }
+    return result;
+}
+
+ReplyFilter::Value ReplyFilter::getDefaultValue(const grpc::protobuf::FieldDescriptor * f_field)
+{
+    Value result;
+    switch(f_field->cpp_type())
+    {
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT32:
+            result.signedValue = f_field->default_value_int32();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_INT64:
+            result.signedValue = f_field->default_value_int64();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+            result.unsignedValue = f_field->default_value_uint32();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+            result.unsignedValue = f_field->default_value_uint64();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+            result.unsignedValue = f_field->default_value_bool() ? 1 : 0;
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+            result.signedValue = f_field->default_value_enum()->number();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+            result.floatValue = f_field->default_value_float();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+            result.floatValue = f_field->default_value_double();
+            break;
+        case grpc::protobuf::FieldDescriptor::CPPTYPE_STRING:
+            result.stringValue = f_field->default_value_string();
+            break;
+        default:
+            break;
+    }
+    return result;
+}
+
+bool ReplyFilter::readValue(google::protobuf::io::CodedInputStream & f_input, uint32_t f_tag, const grpc::protobuf::FieldDescriptor * f_field, Value & f_out_value)
+{
+    WireFormatLite::FieldType fieldType = static_cast<WireFormatLite::FieldType>(f_field->type());
+    if(WireFormatLite::GetTagWireType(f_tag) != WireFormatLite::WireTypeForFieldType(fieldType))
+    {
+        return false;
+    }
+
+    uint64_t varint = 0;
+    uint32_t fixed32 = 0;
+    uint64_t fixed64 = 0;
+    switch(WireFormatLite::GetTagWireType(f_tag))
+    {
+        case WireFormatLite::WIRETYPE_VARINT:
+            if(not f_input.ReadVarint64(&varint))
+            {
+                return false;
+            }
+            break;
+        case WireFormatLite::WIRETYPE_FIXED32:
+            if(not f_input.ReadLittleEndian32(&fixed32))
+            {
+                return false;
+            }
+            break;
+        case WireFormatLite::WIRETYPE_FIXED64:
+            if(not f_input.ReadLittleEndian64(&fixed64))
+            {
+                return false;
+            }
+            break;
+        case WireFormatLite::WIRETYPE_LENGTH_DELIMITED:
+            {
+                uint32_t length = 0;
+                if( (not f_input.ReadVarint32(&length)) or (not f_input.ReadString(&f_out_value.stringValue, length)) )
+                {
+                    return false;
+                }
+            }
+            return true;
+        default:
+            return false;
+    }
+
+    switch(fieldType)
+    {
+        case WireFormatLite::TYPE_ENUM:
+            if( (f_field->enum_type()->file()->syntax() == grpc::protobuf::FileDescriptor::SYNTAX_PROTO2)
+                and (f_field->enum_type()->FindValueByNumber(static_cast<int32_t>(varint)) == nullptr) )
+            {
+                // decoding keeps unknown values of closed (proto2) enums as
+                // unknown fields, so the field keeps its value:
+                break;
+            }
+            f_out_value.signedValue = static_cast<int32_t>(varint);
+            break;
+        case WireFormatLite::TYPE_INT32:
+            f_out_value.signedValue = static_cast<int32_t>(varint);
+            break;
+        case WireFormatLite::TYPE_INT64:
+            f_out_value.signedValue = static_cast<int64_t>(varint);
+            break;
+        case WireFormatLite::TYPE_SINT32:
+            f_out_value.signedValue = WireFormatLite::ZigZagDecode32(static_cast<uint32_t>(varint));
+            break;
+        case WireFormatLite::TYPE_SINT64:
+            f_out_value.signedValue = WireFormatLite::ZigZagDecode64(varint);
+            break;
+        case WireFormatLite::TYPE_UINT32:
+            f_out_value.unsignedValue = static_cast<uint32_t>(varint);
+            break;
+        case WireFormatLite::TYPE_UINT64:
+            f_out_value.unsignedValue = varint;
+            break;
+        case WireFormatLite::TYPE_BOOL:
+            f_out_value.unsignedValue = (varint != 0) ? 1 : 0;
+            break;
+        case WireFormatLite::TYPE_SFIXED32:
+            f_out_value.signedValue = static_cast<int32_t>(fixed32);
+            break;
+        case WireFormatLite::TYPE_FIXED32:
+            f_out_value.unsignedValue = fixed32;
+            break;
+        case WireFormatLite::TYPE_FLOAT:
+            f_out_value.floatValue = WireFormatLite::DecodeFloat(fixed32);
+            break;
+        case WireFormatLite::TYPE_SFIXED64:
+            f_out_value.signedValue = static_cast<int64_t>(fixed64);
+            break;
+        case WireFormatLite::TYPE_FIXED64:
+            f_out_value.unsignedValue = fixed64;
+            break;
+        case WireFormatLite::TYPE_DOUBLE:
+            f_out_value.floatValue = WireFormatLite::DecodeDouble(fixed64);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool ReplyFilter::rejectsSerialized(const std::string & f_serializedMessage) const
+{
+    if(not m_evaluateSerialized)
+    {
+        return false;
+    }
+
+    // scan the wire format for the compared fields, skipping all others:
+    std::vector<Value> fieldValues = m_defaultValues;
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const uint8_t *>(f_serializedMessage.data()), f_serializedMessage.size());
+    for(uint32_t tag = input.ReadTag(); tag != 0; tag = input.ReadTag())
+    {
+        int fieldNumber = WireFormatLite::GetTagFieldNumber(tag);
+        const Value * readValue = nullptr;
+        size_t valueIndex = 0;
+        for(const std::vector<Condition> & conditions : m_alternatives)
+        {
+            for(const Condition & condition : conditions)
+            {
+                if(condition.path[0]->number() == fieldNumber)
+                {
+                    if(readValue == nullptr)
+                    {
+                        // the last occurrence of a field wins:
+                        if(not ReplyFilter::readValue(input, tag, condition.path[0], fieldValues[valueIndex]))
+                        {
+                            // cannot decide on the wire format
+                            return false;
+                        }
+                        readValue = &fieldValues[valueIndex];
+                    }
+                    else
+                    {
+                        // several conditions on the same field:
+                        fieldValues[valueIndex] = *readValue;
+                    }
+                }
+                valueIndex++;
+            }
+        }
+        if( (readValue == nullptr) and (not WireFormatLite::SkipField(&input, tag)) )
+        {
+            return false;
+        }
+    }
+    return not evaluateAll(fieldValues);
+}
+
+}
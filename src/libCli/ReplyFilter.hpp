@@ -0,0 +1,122 @@
+// Copyright 2019 IBM Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+#include <third_party/gRPC_utils/proto_reflection_descriptor_database.h>
+#include <google/protobuf/io/coded_stream.h>
+
+#include <string>
+#include <vector>
+
+namespace cli
+{
+    /// Filter for reply messages given with --filter.
+    /// The filter expression is compiled once against the reply message type:
+    /// field paths are resolved to FieldDescriptors and comparison values are
+    /// converted to the field type. Conditions are combined with && and ||
+    /// (&& binds stronger).
+    /// Filters referencing only non-repeated scalar fields of the reply itself
+    /// are evaluated on the serialized reply, so rejected replies are never
+    /// decoded.
+    class ReplyFilter
+    {
+        public:
+            /// Compiles the filter expression of a parse tree.
+            /// @param f_filterTree parse tree of the filter expression (element "Filter")
+            /// @param f_messageDescriptor type of the messages to filter
+            /// @param f_out_error description of the problem if compilation fails
+            /// @returns false if the expression does not fit the message type
+            bool compile(ArgParse::ParsedElement & f_filterTree, const grpc::protobuf::Descriptor * f_messageDescriptor, std::string & f_out_error);
+
+            /// Evaluates the filter on a serialized message, if possible.
+            /// @returns true if the message is rejected. false if it matches or
+            ///          if the filter can only be evaluated on the decoded
+            ///          message (see matches()).
+            bool rejectsSerialized(const std::string & f_serializedMessage) const;
+
+            /// Evaluates the filter on a decoded message.
+            /// @returns true if the message matches the filter
+            bool matches(const grpc::protobuf::Message & f_message) const;
+
+            /// @returns paths of all compared fields, starting at the
+            ///          filtered message type
+            std::vector<std::vector<const grpc::protobuf::FieldDescriptor *>> getFieldPaths() const;
+
+        private:
+            enum class Operator
+            {
+                Equal,
+                NotEqual,
+                Less,
+                LessEqual,
+                Greater,
+                GreaterEqual
+            };
+
+            /// Type the field value is compared as.
+            enum class ValueType
+            {
+                Signed,
+                Unsigned,
+                Float,
+                String
+            };
+
+            /// A comparison value or a field value converted to the
+            /// comparison type.
+            struct Value
+            {
+                int64_t signedValue = 0;
+                uint64_t unsignedValue = 0;
+                double floatValue = 0;
+                std::string stringValue;
+            };
+
+            struct Condition
+            {
+                /// Fields from the reply message to the compared field.
+                std::vector<const grpc::protobuf::FieldDescriptor *> path;
+                Operator op;
+                ValueType type;
+                Value value;
+            };
+
+            /// Conditions combined with ||, each a list of conditions
+            /// combined with &&.
+            std::vector<std::vector<Condition>> m_alternatives;
+
+            /// true if all conditions reference non-repeated top-level
+            /// scalar fields, which are not part of a oneof.
+            bool m_evaluateSerialized = true;
+
+            /// Values of unset fields, for all conditions in order.
+            std::vector<Value> m_defaultValues;
+
+            bool compileCondition(ArgParse::ParsedElement & f_conditionTree, const grpc::protobuf::Descriptor * f_messageDescriptor, Condition & f_out_condition, std::string & f_out_error);
+            bool evaluate(const Condition & f_condition, const Value & f_fieldValue) const;
+
+            /// Evaluates all conditions with the given field values (one value
+            /// per condition, in order of m_alternatives).
+            bool evaluateAll(const std::vector<Value> & f_fieldValues) const;
+
+            static Value getValue(const grpc::protobuf::Message & f_message, const Condition & f_condition);
+            static Value getDefaultValue(const grpc::protobuf::FieldDescriptor * f_field);
+
+            /// Reads the value of a field from the wire format.
+            /// @returns false if the wire type does not fit the field type
+            static bool readValue(google::protobuf::io::CodedInputStream & f_input, uint32_t f_tag, const grpc::protobuf::FieldDescriptor * f_field, Value & f_out_value);
+    };
+}
@@ -0,0 +1,206 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/ReplyPipeline.hpp>
+
+#include <algorithm>
+#include <map>
+
+namespace cli
+{
+
+/// Number of formatted replies per worker which may wait for output.
+static const size_t s_resultsPerWorker = 4;
+
+ReplyPipeline::ReplyPipeline(size_t f_numberOfWorkers, size_t f_queueSize, QueuePolicy f_policy, FormatFunction f_format, std::ostream & f_output) :
+    m_format(f_format),
+    m_output(f_output),
+    m_queueSize(std::max<size_t>(1, f_queueSize)),
+    m_policy(f_policy),
+    m_maxResults(f_numberOfWorkers * s_resultsPerWorker)
+{
+    for(size_t i = 0; i < f_numberOfWorkers; i++)
+    {
+        m_workers.emplace_back(&ReplyPipeline::work, this, i);
+    }
+    m_outputThread = std::thread(&ReplyPipeline::writeOutput, this);
+}
+
+ReplyPipeline::~ReplyPipeline()
+{
+    finish();
+}
+
+bool ReplyPipeline::parseQueuePolicy(const std::string & f_name, QueuePolicy & f_out_policy)
+{
+    static const std::map<std::string, QueuePolicy> policies = {
+        {"block", QueuePolicy::Block},
+        {"dropOldest", QueuePolicy::DropOldest},
+        {"dropNewest", QueuePolicy::DropNewest},
+        {"sample", QueuePolicy::Sample},
+    };
+    auto it = policies.find(f_name);
+    if(it == policies.end())
+    {
+        return false;
+    }
+    f_out_policy = it->second;
+    return true;
+}
+
+void ReplyPipeline::push(const std::string & f_receptionTime, std::string && f_serializedReply)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_statistics.received++;
+    if(m_queue.size() >= m_queueSize)
+    {
+        switch(m_policy)
+        {
+            case QueuePolicy::Block:
+                m_queueSpaceAvailable.wait(lock, [this]{ return m_queue.size() < m_queueSize; });
+                break;
+            case QueuePolicy::DropOldest:
+                m_queue.pop_front();
+                m_statistics.dropped++;
+                break;
+            case QueuePolicy::DropNewest:
+                m_statistics.dropped++;
+                return;
+            case QueuePolicy::Sample:
+                {
+                    // keep every second reply, starting with the oldest
+                    // (which stays in place, self-moves clear strings):
+                    size_t kept = 1;
+                    for(size_t i = 2; i < m_queue.size(); i += 2)
+                    {
+                        m_queue[kept++] = std::move(m_queue[i]);
+                    }
+                    m_statistics.dropped += m_queue.size() - kept;
+                    m_queue.resize(kept);
+                    if(m_queue.size() >= m_queueSize)
+                    {
+                        // too small to thin out
+                        m_queue.pop_front();
+                        m_statistics.dropped++;
+                    }
+                }
+                break;
+        }
+    }
+    m_queue.emplace_back();
+    m_queue.back().receptionTime = f_receptionTime;
+    m_queue.back().serializedReply = std::move(f_serializedReply);
+    m_statistics.maxQueueDepth = std::max(m_statistics.maxQueueDepth, m_queue.size());
+    m_workAvailable.notify_one();
+}
+
+void ReplyPipeline::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_finishing)
+        {
+            return;
+        }
+        m_finishing = true;
+    }
+    m_workAvailable.notify_all();
+    m_resultSpaceAvailable.notify_all();
+    m_outputAvailable.notify_all();
+
+    for(std::thread & worker : m_workers)
+    {
+        worker.join();
+    }
+    m_outputThread.join();
+}
+
+ReplyPipeline::Statistics ReplyPipeline::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void ReplyPipeline::work(size_t f_worker)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_workAvailable.wait(lock, [this]{ return m_finishing or (not m_queue.empty()); });
+        if(m_queue.empty())
+        {
+            // finishing and nothing left to format
+            return;
+        }
+        // do not take more replies than the output can keep up with, so they
+        // stay in the queue, where the queue policy applies:
+        m_resultSpaceAvailable.wait(lock, [this]{ return m_results.size() < m_maxResults; });
+        if(m_queue.empty())
+        {
+            continue;
+        }
+
+        Reply reply = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_queueSpaceAvailable.notify_one();
+
+        // references to deque elements stay valid while other elements are
+        // added at the back or removed at the front:
+        m_results.emplace_back();
+        Result & result = m_results.back();
+
+        lock.unlock();
+        std::string text = m_format(f_worker, reply.receptionTime, reply.serializedReply);
+        lock.lock();
+
+        result.text = std::move(text);
+        result.formatted = true;
+        if(&result == &m_results.front())
+        {
+            m_outputAvailable.notify_one();
+        }
+    }
+}
+
+void ReplyPipeline::writeOutput()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(true)
+    {
+        m_outputAvailable.wait(lock, [this]{ return (m_finishing and m_results.empty() and m_queue.empty()) or ( (not m_results.empty()) and m_results.front().formatted ); });
+        if(m_results.empty())
+        {
+            // finishing and everything printed
+            return;
+        }
+
+        std::string text = std::move(m_results.front().text);
+        m_results.pop_front();
+        m_resultSpaceAvailable.notify_all();
+
+        // only flush if no further output is ready, so bursts of replies
+        // are written in large blocks:
+        bool moreOutputReady = (not m_results.empty()) and m_results.front().formatted;
+
+        lock.unlock();
+        m_output << text;
+        if(not moreOutputReady)
+        {
+            m_output << std::flush;
+        }
+        lock.lock();
+    }
+}
+
+}
@@ -0,0 +1,134 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cli
+{
+    /// Decodes and formats replies of a streaming RPC on a pool of worker
+    /// threads and prints them in the order they were received.
+    /// The thread reading the replies only hands the serialized replies to
+    /// push(), so reading continues while earlier replies are formatted.
+    /// Received replies wait in a bounded queue until a worker is free. If
+    /// the output is too slow, the queue policy decides whether the reader
+    /// waits or replies are dropped.
+    class ReplyPipeline
+    {
+        public:
+            /// Decodes and formats one serialized reply.
+            /// Called concurrently. Each worker passes its own index
+            /// (0 .. number of workers - 1), so state which is not thread
+            /// safe (e.g. an OutputFormatter) can be kept per worker.
+            typedef std::function<std::string(size_t f_worker, const std::string & f_receptionTime, const std::string & f_serializedReply)> FormatFunction;
+
+            /// Behavior of push() if the queue is full.
+            enum class QueuePolicy
+            {
+                Block,      // wait until a worker takes a reply from the queue
+                DropOldest, // drop the oldest queued reply
+                DropNewest, // drop the reply being pushed
+                Sample      // drop every second queued reply, keeping an evenly spread sample
+            };
+
+            /// Counters describing the queue usage.
+            struct Statistics
+            {
+                uint64_t received = 0;
+                uint64_t dropped = 0;
+                size_t maxQueueDepth = 0;
+            };
+
+            /// Starts the worker and output threads.
+            /// @param f_numberOfWorkers number of threads formatting replies
+            /// @param f_queueSize maximum number of replies waiting for a worker
+            /// @param f_policy behavior if the queue is full
+            /// @param f_format function formatting a reply
+            /// @param f_output stream all formatted replies are written to
+            ReplyPipeline(size_t f_numberOfWorkers, size_t f_queueSize, QueuePolicy f_policy, FormatFunction f_format, std::ostream & f_output);
+
+            /// Waits for all replies to be printed (see finish()).
+            ~ReplyPipeline();
+
+            ReplyPipeline(const ReplyPipeline &) = delete;
+            ReplyPipeline & operator=(const ReplyPipeline &) = delete;
+
+            /// Queues a reply for formatting.
+            /// If the queue is full, the queue policy is applied. Formatted
+            /// replies waiting for output are limited as well, so memory
+            /// usage stays bounded.
+            /// @param f_receptionTime time the reply was received (printed with the reply)
+            /// @param f_serializedReply the reply as received, moved into the queue
+            void push(const std::string & f_receptionTime, std::string && f_serializedReply);
+
+            /// Waits until all queued replies are printed and stops all threads.
+            void finish();
+
+            Statistics getStatistics();
+
+            /// Parses a queue policy name (block, dropOldest, dropNewest, sample).
+            /// @returns false if the name is unknown
+            static bool parseQueuePolicy(const std::string & f_name, QueuePolicy & f_out_policy);
+
+        private:
+            struct Reply
+            {
+                std::string receptionTime;
+                std::string serializedReply;
+            };
+
+            struct Result
+            {
+                std::string text;
+                bool formatted = false;
+            };
+
+            void work(size_t f_worker);
+            void writeOutput();
+
+            FormatFunction m_format;
+            std::ostream & m_output;
+
+            /// Received replies waiting for a worker, oldest first.
+            std::deque<Reply> m_queue;
+            size_t m_queueSize;
+            QueuePolicy m_policy;
+
+            /// Replies taken by workers, in order of reception, from the
+            /// oldest reply not yet printed to the newest.
+            std::deque<Result> m_results;
+            size_t m_maxResults;
+
+            Statistics m_statistics;
+            bool m_finishing = false;
+
+            std::mutex m_mutex;
+            std::condition_variable m_workAvailable;
+            std::condition_variable m_outputAvailable;
+            std::condition_variable m_queueSpaceAvailable;
+            std::condition_variable m_resultSpaceAvailable;
+
+            std::vector<std::thread> m_workers;
+            std::thread m_outputThread;
+    };
+}
@@ -0,0 +1,96 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/SessionCache.hpp>
+#include <libCli/DescriptorSource.hpp>
+
+#include <grpcpp/grpcpp.h>
+
+namespace cli
+{
+
+static SessionCache * s_activeCache = nullptr;
+
+SessionCache::SessionCache()
+{
+    s_activeCache = this;
+}
+
+SessionCache::~SessionCache()
+{
+    s_activeCache = nullptr;
+    clear();
+}
+
+SessionCache * SessionCache::getActive()
+{
+    return s_activeCache;
+}
+
+std::shared_ptr<grpc::Channel> SessionCache::getChannel(const std::string & f_key, std::function<std::shared_ptr<grpc::Channel>()> f_create)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_channels.find(f_key);
+    if(it != m_channels.end())
+    {
+        grpc_connectivity_state state = it->second->GetState(false);
+        if( (state != GRPC_CHANNEL_TRANSIENT_FAILURE) and (state != GRPC_CHANNEL_SHUTDOWN) )
+        {
+            return it->second;
+        }
+        // descriptor sources of the failed channel would fail as well:
+        for(auto source = m_descriptorSources.begin(); source != m_descriptorSources.end(); )
+        {
+            if(source->second.channel == it->second)
+            {
+                source = m_descriptorSources.erase(source);
+            }
+            else
+            {
+                ++source;
+            }
+        }
+        m_channels.erase(it);
+    }
+    std::shared_ptr<grpc::Channel> channel = f_create();
+    m_channels[f_key] = channel;
+    return channel;
+}
+
+std::shared_ptr<DescriptorSource> SessionCache::getDescriptorSource(const std::string & f_key, std::shared_ptr<grpc::Channel> f_channel, std::function<std::unique_ptr<DescriptorSource>()> f_create)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_descriptorSources.find(f_key);
+    if( (it != m_descriptorSources.end()) and (it->second.channel == f_channel) )
+    {
+        return it->second.source;
+    }
+    std::shared_ptr<DescriptorSource> source(f_create());
+    if(source == nullptr)
+    {
+        return nullptr;
+    }
+    m_descriptorSources[f_key] = CachedSource{source, f_channel};
+    return source;
+}
+
+void SessionCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // sources may use the channels, so they are released first:
+    m_descriptorSources.clear();
+    m_channels.clear();
+}
+
+}
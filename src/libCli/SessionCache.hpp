@@ -0,0 +1,79 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <grpc++/channel.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace cli
+{
+    class DescriptorSource;
+
+    /// Keeps channels and descriptor sources for all commands of an
+    /// interactive session (--shell), so connections stay established and
+    /// descriptors retrieved via reflection are reused by later commands.
+    /// While a SessionCache exists, createChannel() and
+    /// createDescriptorSource() return cached objects. Without session,
+    /// every call creates new objects.
+    class SessionCache
+    {
+        public:
+            /// Activates the cache. Only one cache may be active at a time.
+            SessionCache();
+
+            /// Deactivates the cache and releases all cached objects.
+            ~SessionCache();
+
+            SessionCache(const SessionCache &) = delete;
+            SessionCache & operator=(const SessionCache &) = delete;
+
+            /// @returns the active cache, nullptr outside of sessions
+            static SessionCache * getActive();
+
+            /// @param f_key identifies the target (and how it is reached)
+            /// @param f_create creates the channel if not cached
+            /// @returns cached channel. Channels which failed to connect are
+            ///          replaced, as they would only retry after a backoff.
+            std::shared_ptr<grpc::Channel> getChannel(const std::string & f_key, std::function<std::shared_ptr<grpc::Channel>()> f_create);
+
+            /// @param f_key identifies the schema
+            /// @param f_channel channel the source retrieves descriptors from
+            ///        (nullptr for local schemas). Sources of replaced channels
+            ///        are released.
+            /// @param f_create creates the source if not cached
+            /// @returns cached source, nullptr if f_create failed (failures
+            ///          are not cached)
+            std::shared_ptr<DescriptorSource> getDescriptorSource(const std::string & f_key, std::shared_ptr<grpc::Channel> f_channel, std::function<std::unique_ptr<DescriptorSource>()> f_create);
+
+            /// Releases all cached objects, e.g. after a server restarted.
+            void clear();
+
+        private:
+            struct CachedSource
+            {
+                std::shared_ptr<DescriptorSource> source;
+                std::shared_ptr<grpc::Channel> channel;
+            };
+
+            std::mutex m_mutex;
+            std::map<std::string, std::shared_ptr<grpc::Channel>> m_channels;
+            std::map<std::string, CachedSource> m_descriptorSources;
+    };
+}
@@ -0,0 +1,261 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Shell.hpp>
+#include <libCli/GrammarConstruction.hpp>
+#include <libCli/Interrupt.hpp>
+#include <libCli/SessionCache.hpp>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <unistd.h>
+
+#ifdef BUILD_CONFIG_HAVE_READLINE
+#include <cstdio>
+#include <readline/readline.h>
+#include <readline/history.h>
+#endif
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+namespace
+{
+    /// Grammar of the running shell, also used by the completion callback.
+    struct ShellGrammar
+    {
+        std::unique_ptr<Grammar> pool;
+        GrammarElement * root = nullptr;
+        std::string prefix;
+    };
+
+    ShellGrammar * s_shellGrammar = nullptr;
+
+    const char s_prompt[] = "gwhisper> ";
+
+    /// Set by SIGINT while waiting for a command.
+    volatile sig_atomic_t s_promptInterrupted = 0;
+}
+
+/// Handles SIGINT (Ctrl-C) while waiting for a command: the line typed so
+/// far is discarded (by the terminal or by discardLineOnInterrupt()) and
+/// the shell continues.
+static void handlePromptInterrupt(int)
+{
+    s_promptInterrupted = 1;
+#ifndef BUILD_CONFIG_HAVE_READLINE
+    const char newPrompt[] = "\ngwhisper> ";
+    ssize_t written = write(STDOUT_FILENO, newPrompt, sizeof(newPrompt) - 1);
+    (void)written;
+#endif
+}
+
+/// (Re-)constructs the grammar, dropping all injected grammar.
+static void constructShellGrammar(ShellGrammar & f_grammar)
+{
+    f_grammar.pool.reset(new Grammar());
+    f_grammar.root = constructGrammar(*f_grammar.pool);
+}
+
+/// @returns the gWhisper arguments of a shell line
+static std::string getArgs(const std::string & f_prefix, const std::string & f_line)
+{
+    if(f_prefix == "")
+    {
+        return f_line;
+    }
+    return f_prefix + " " + f_line;
+}
+
+#ifdef BUILD_CONFIG_HAVE_READLINE
+/// @param f_args arguments up to the cursor
+/// @param f_wordLength length of the word ending at the cursor
+/// @returns replacements of the word, i.e. the completed word followed by
+///          everything the grammar completes after it
+static std::vector<std::string> getCompletions(GrammarElement * f_grammarRoot, const std::string & f_args, size_t f_wordLength)
+{
+    ParsedElement parseTree;
+    ParseRc rc = f_grammarRoot->parse(f_args.c_str(), parseTree);
+
+    std::vector<std::string> result;
+    size_t wordStart = f_args.size() - f_wordLength;
+    for(auto & candidate : rc.candidates)
+    {
+        std::string candidateStr = candidate->getMatchedString();
+        if(candidateStr.compare(0, f_args.size(), f_args) != 0)
+        {
+            continue;
+        }
+        result.push_back(candidateStr.substr(wordStart));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+/// Word delimiters, the same as in bash completion (see complete.bash).
+static char s_wordBreakCharacters[] = " =:,";
+
+static std::vector<std::string> s_completions;
+
+static char * generateCompletion(const char * f_text, int f_state)
+{
+    if(static_cast<size_t>(f_state) >= s_completions.size())
+    {
+        return nullptr;
+    }
+    return strdup(s_completions[f_state].c_str());
+}
+
+static char ** completeLine(const char * f_text, int f_start, int f_end)
+{
+    // no file name completion:
+    rl_attempted_completion_over = 1;
+    // completions end with a space where the grammar requires one:
+    rl_completion_append_character = '\0';
+
+    std::string line(rl_line_buffer, f_end);
+    s_completions = getCompletions(s_shellGrammar->root, getArgs(s_shellGrammar->prefix, line), f_end - f_start);
+    return rl_completion_matches(f_text, generateCompletion);
+}
+
+/// Called by readline after a signal was handled. Ctrl-C discards the line
+/// being edited and shows a new prompt, like in bash.
+static int discardLineOnInterrupt()
+{
+    if(s_promptInterrupted)
+    {
+        s_promptInterrupted = 0;
+        rl_replace_line("", 0);
+        rl_crlf();
+        rl_on_new_line();
+        rl_redisplay();
+    }
+    return 0;
+}
+#endif
+
+/// Reads a line, with line editing and prompt if reading from a terminal.
+/// @returns false at the end of input
+static bool readLine(bool f_interactive, std::string & f_out_line)
+{
+#ifdef BUILD_CONFIG_HAVE_READLINE
+    if(f_interactive)
+    {
+        char * line = readline(s_prompt);
+        if(line == nullptr)
+        {
+            return false;
+        }
+        f_out_line = line;
+        if(line[0] != '\0')
+        {
+            add_history(line);
+        }
+        free(line);
+        return true;
+    }
+#else
+    if(f_interactive)
+    {
+        std::cout << s_prompt << std::flush;
+    }
+#endif
+    return static_cast<bool>(std::getline(std::cin, f_out_line));
+}
+
+int runShell(const std::string & f_prefix, ShellCommandFunction f_execute)
+{
+    ShellGrammar grammar;
+    grammar.prefix = f_prefix;
+    constructShellGrammar(grammar);
+    s_shellGrammar = &grammar;
+
+    SessionCache cache;
+
+#ifdef BUILD_CONFIG_HAVE_READLINE
+    rl_readline_name = "gwhisper";
+    rl_attempted_completion_function = completeLine;
+    rl_completer_word_break_characters = s_wordBreakCharacters;
+    rl_signal_event_hook = discardLineOnInterrupt;
+#endif
+
+    // commands may also be piped into the shell:
+    bool interactive = isatty(STDIN_FILENO);
+    struct sigaction previousAction;
+    if(interactive)
+    {
+        // Ctrl-C does not end the shell:
+        struct sigaction action;
+        action.sa_handler = handlePromptInterrupt;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGINT, &action, &previousAction);
+    }
+    std::string line;
+    while(readLine(interactive, line))
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if(start == std::string::npos)
+        {
+            continue;
+        }
+        line = line.substr(start, line.find_last_not_of(" \t\r") - start + 1);
+
+        if( (line == "exit") or (line == "quit") )
+        {
+            break;
+        }
+        if(line == "reload")
+        {
+            cache.clear();
+            constructShellGrammar(grammar);
+            continue;
+        }
+
+        // Ctrl-C cancels the calls of the command and returns to the prompt:
+        InterruptScope interruptScope;
+        std::string args = getArgs(f_prefix, line);
+        ParsedElement parseTree;
+        ParseRc rc = grammar.root->parse(args.c_str(), parseTree);
+        if(parseTree.findFirstChild("Shell") != "")
+        {
+            std::cerr << "Error: The shell is already running" << std::endl;
+            continue;
+        }
+        if( (f_execute(*grammar.pool, rc, parseTree, args) != 0) and (not InterruptScope::isInterrupted()) )
+        {
+            // e.g. the server restarted: connections and descriptors are
+            // retrieved again by the next command
+            cache.clear();
+        }
+    }
+
+    if(interactive)
+    {
+        sigaction(SIGINT, &previousAction, nullptr);
+    }
+    s_shellGrammar = nullptr;
+    return 0;
+}
+
+}
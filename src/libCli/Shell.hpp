@@ -0,0 +1,49 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+
+#include <functional>
+#include <string>
+
+namespace cli
+{
+    /// Executes one command of the shell, like gWhisper invoked with the
+    /// given arguments.
+    /// @param f_grammarPool pool of the grammar the arguments were parsed with
+    /// @param f_rc result of parsing the arguments
+    /// @param f_parseTree parse tree of the arguments
+    /// @param f_args the arguments
+    /// @returns exit code of the command
+    typedef std::function<int(ArgParse::Grammar & f_grammarPool, ArgParse::ParseRc & f_rc, ArgParse::ParsedElement & f_parseTree, const std::string & f_args)> ShellCommandFunction;
+
+    /// Runs an interactive shell (--shell) until "exit", "quit" or end of
+    /// input. Each line is executed like the arguments of a gWhisper
+    /// invocation. The grammar is constructed once and grammar injected for a
+    /// server, service or method is reused by all later commands. Channels
+    /// and descriptors are kept in a SessionCache, so completion and calls
+    /// need no new connection or reflection request after the first command
+    /// to a server. After a failed command, the session cache is cleared.
+    /// "reload" clears the cache and the injected grammar (e.g. after the
+    /// schema of a server changed).
+    /// If gWhisper is built with GNU readline, lines can be edited and
+    /// completed in-process with TAB.
+    /// @param f_prefix arguments prepended to each line (e.g. options or the
+    ///        server address given with --shell)
+    /// @param f_execute executes a parsed line
+    /// @returns exit code of gWhisper
+    int runShell(const std::string & f_prefix, ShellCommandFunction f_execute);
+}
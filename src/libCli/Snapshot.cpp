@@ -0,0 +1,511 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/Snapshot.hpp>
+#include <libCli/MappedFile.hpp>
+#include <libCli/cliUtils.hpp>
+#include <google/protobuf/descriptor.pb.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+using namespace ArgParse;
+
+namespace cli
+{
+
+// Snapshot file layout:
+// All integers are uint32_t in native byte order. The header is followed by
+// the index tables (4 byte aligned, each sorted by name) and a blob area
+// containing all names and serialized FileDescriptorProtos. All offsets are
+// relative to the start of the file.
+namespace
+{
+    const char s_snapshotMagic[8] = {'g', 'W', 'h', 'S', 'n', 'a', 'p', '1'};
+    const uint32_t s_byteOrderMark = 0x01020304;
+
+    /// Range in the snapshot file. For tables, length is the element count.
+    struct SnapshotRef
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t byteOrderMark;
+        uint32_t reserved;
+        SnapshotRef files;    // FileEntry table
+        SnapshotRef symbols;  // SymbolEntry table
+        SnapshotRef services; // ServiceEntry table
+        SnapshotRef methods;  // method names (SnapshotRef table), grouped by service
+    };
+
+    struct FileEntry
+    {
+        SnapshotRef name;
+        SnapshotRef data; // serialized FileDescriptorProto
+    };
+
+    /// Top-level symbol (message, enum, service or extension) of a file.
+    struct SymbolEntry
+    {
+        SnapshotRef name;
+        uint32_t fileIndex;
+    };
+
+    struct ServiceEntry
+    {
+        SnapshotRef name;
+        uint32_t firstMethod;
+        uint32_t methodCount;
+    };
+}
+
+/// Descriptor database and name index on top of a mapped snapshot file.
+class SnapshotDescriptorSource : public DescriptorSource, public grpc::protobuf::DescriptorDatabase
+{
+    public:
+        SnapshotDescriptorSource() :
+            m_header(nullptr)
+        {
+        }
+
+        bool load(const std::string & f_fileName)
+        {
+            std::string error;
+            if(not m_file.map(f_fileName, error))
+            {
+                std::cerr << "Error: " << error << std::endl;
+                return false;
+            }
+
+            m_header = reinterpret_cast<const SnapshotHeader *>(m_file.data());
+            if( (m_file.size() < sizeof(SnapshotHeader))
+                    or (memcmp(m_header->magic, s_snapshotMagic, sizeof(s_snapshotMagic)) != 0)
+                    or (m_header->byteOrderMark != s_byteOrderMark)
+                    or (not isValidTable<FileEntry>(m_header->files))
+                    or (not isValidTable<SymbolEntry>(m_header->symbols))
+                    or (not isValidTable<ServiceEntry>(m_header->services))
+                    or (not isValidTable<SnapshotRef>(m_header->methods)) )
+            {
+                std::cerr << "Error: '" << f_fileName << "' is not a valid gWhisper snapshot (or was written on a different platform)" << std::endl;
+                m_header = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        virtual grpc::protobuf::DescriptorDatabase & getDatabase() override
+        {
+            return *this;
+        }
+
+        virtual bool getServices(std::vector<std::string> & f_out_services) override
+        {
+            const ServiceEntry * services = table<ServiceEntry>(m_header->services);
+            for(uint32_t i = 0; i < m_header->services.length; i++)
+            {
+                f_out_services.push_back(getString(services[i].name));
+            }
+            return true;
+        }
+
+        virtual bool getMethods(const std::string & f_serviceName, std::vector<std::string> & f_out_methods) override
+        {
+            const ServiceEntry * services = table<ServiceEntry>(m_header->services);
+            const ServiceEntry * service = findByName(services, m_header->services.length, f_serviceName);
+            if(service == nullptr)
+            {
+                return false;
+            }
+            const SnapshotRef * methods = table<SnapshotRef>(m_header->methods);
+            for(uint32_t i = 0; i < service->methodCount; i++)
+            {
+                uint32_t index = service->firstMethod + i;
+                if(index >= m_header->methods.length)
+                {
+                    return false;
+                }
+                f_out_methods.push_back(getString(methods[index]));
+            }
+            return true;
+        }
+
+        virtual bool usesReflection() const override
+        {
+            return false;
+        }
+
+        // DescriptorDatabase interface:
+
+        virtual bool FindFileByName(const std::string & f_fileName, grpc::protobuf::FileDescriptorProto * f_output) override
+        {
+            const FileEntry * files = table<FileEntry>(m_header->files);
+            const FileEntry * file = findByName(files, m_header->files.length, f_fileName);
+            if(file == nullptr)
+            {
+                return false;
+            }
+            return parseFile(*file, f_output);
+        }
+
+        virtual bool FindFileContainingSymbol(const std::string & f_symbolName, grpc::protobuf::FileDescriptorProto * f_output) override
+        {
+            // Only top-level symbols are indexed. Nested symbols (e.g. nested
+            // messages or methods) are found via the closest preceding
+            // top-level symbol, which has to be a prefix of the symbol name:
+            const SymbolEntry * symbols = table<SymbolEntry>(m_header->symbols);
+            const SymbolEntry * end = symbols + m_header->symbols.length;
+            const SymbolEntry * it = std::upper_bound(symbols, end, f_symbolName,
+                    [this](const std::string & f_name, const SymbolEntry & f_entry)
+                    {
+                        return compare(f_entry.name, f_name) > 0;
+                    });
+            if(it == symbols)
+            {
+                return false;
+            }
+            --it;
+
+            std::string symbol = getString(it->name);
+            bool isMatch = (symbol == f_symbolName)
+                or ( (f_symbolName.size() > symbol.size())
+                        and (f_symbolName.compare(0, symbol.size(), symbol) == 0)
+                        and (f_symbolName[symbol.size()] == '.') );
+            if( (not isMatch) or (it->fileIndex >= m_header->files.length) )
+            {
+                return false;
+            }
+            return parseFile(table<FileEntry>(m_header->files)[it->fileIndex], f_output);
+        }
+
+        virtual bool FindFileContainingExtension(const std::string & f_containingType, int f_fieldNumber, grpc::protobuf::FileDescriptorProto * f_output) override
+        {
+            // extensions are not indexed by extendee
+            return false;
+        }
+
+        virtual bool FindAllFileNames(std::vector<std::string> * f_output) override
+        {
+            const FileEntry * files = table<FileEntry>(m_header->files);
+            for(uint32_t i = 0; i < m_header->files.length; i++)
+            {
+                f_output->push_back(getString(files[i].name));
+            }
+            return true;
+        }
+
+    private:
+        bool isValidRange(uint32_t f_offset, uint64_t f_size) const
+        {
+            return (f_offset <= m_file.size()) and (f_size <= m_file.size() - f_offset);
+        }
+
+        template<typename T>
+        bool isValidTable(const SnapshotRef & f_table) const
+        {
+            return ( (f_table.offset % alignof(T)) == 0 )
+                and isValidRange(f_table.offset, uint64_t(f_table.length) * sizeof(T));
+        }
+
+        template<typename T>
+        const T * table(const SnapshotRef & f_table) const
+        {
+            return reinterpret_cast<const T *>(m_file.data() + f_table.offset);
+        }
+
+        /// @returns referenced string, empty string if the reference is out of range
+        std::string getString(const SnapshotRef & f_ref) const
+        {
+            if(not isValidRange(f_ref.offset, f_ref.length))
+            {
+                return "";
+            }
+            return std::string(m_file.data() + f_ref.offset, f_ref.length);
+        }
+
+        /// Compares the referenced string with f_value (like std::string::compare)
+        int compare(const SnapshotRef & f_ref, const std::string & f_value) const
+        {
+            if(not isValidRange(f_ref.offset, f_ref.length))
+            {
+                return -1;
+            }
+            size_t length = std::min<size_t>(f_ref.length, f_value.size());
+            int result = memcmp(m_file.data() + f_ref.offset, f_value.data(), length);
+            if(result != 0)
+            {
+                return result;
+            }
+            if(f_ref.length == f_value.size())
+            {
+                return 0;
+            }
+            return (f_ref.length < f_value.size()) ? -1 : 1;
+        }
+
+        /// Binary search in a table sorted by name.
+        /// @returns matching entry or nullptr
+        template<typename T>
+        const T * findByName(const T * f_table, uint32_t f_count, const std::string & f_name) const
+        {
+            const T * end = f_table + f_count;
+            const T * it = std::lower_bound(f_table, end, f_name,
+                    [this](const T & f_entry, const std::string & f_value)
+                    {
+                        return compare(f_entry.name, f_value) < 0;
+                    });
+            if( (it == end) or (compare(it->name, f_name) != 0) )
+            {
+                return nullptr;
+            }
+            return it;
+        }
+
+        bool parseFile(const FileEntry & f_file, grpc::protobuf::FileDescriptorProto * f_output) const
+        {
+            if(not isValidRange(f_file.data.offset, f_file.data.length))
+            {
+                return false;
+            }
+            return f_output->ParseFromArray(m_file.data() + f_file.data.offset, f_file.data.length);
+        }
+
+        MappedFile m_file;
+        const SnapshotHeader * m_header;
+};
+
+std::unique_ptr<DescriptorSource> loadSnapshot(const std::string & f_fileName)
+{
+    std::unique_ptr<SnapshotDescriptorSource> source(new SnapshotDescriptorSource());
+    if(not source->load(f_fileName))
+    {
+        return nullptr;
+    }
+    return source;
+}
+
+/// Adds a file and (before it) all of its transitive dependencies.
+static void addFileWithDependencies(const grpc::protobuf::FileDescriptor * f_file, std::set<std::string> & f_knownFiles, std::vector<grpc::protobuf::FileDescriptorProto> & f_out_files)
+{
+    if(not f_knownFiles.insert(f_file->name()).second)
+    {
+        return;
+    }
+    for(int i = 0; i < f_file->dependency_count(); ++i)
+    {
+        addFileWithDependencies(f_file->dependency(i), f_knownFiles, f_out_files);
+    }
+    f_out_files.emplace_back();
+    f_file->CopyTo(&f_out_files.back());
+}
+
+/// Builds a snapshot file in memory.
+class SnapshotBuilder
+{
+    public:
+        SnapshotBuilder(std::vector<grpc::protobuf::FileDescriptorProto> & f_files, std::map<std::string, std::vector<std::string> > & f_services)
+        {
+            std::sort(f_files.begin(), f_files.end(),
+                    [](const grpc::protobuf::FileDescriptorProto & f_lhs, const grpc::protobuf::FileDescriptorProto & f_rhs)
+                    {
+                        return f_lhs.name() < f_rhs.name();
+                    });
+
+            // std::map keeps symbols sorted, first definition wins:
+            std::map<std::string, uint32_t> symbols;
+            for(uint32_t i = 0; i < f_files.size(); i++)
+            {
+                const grpc::protobuf::FileDescriptorProto & file = f_files[i];
+                std::string prefix = file.package().empty() ? "" : file.package() + ".";
+                for(auto & message : file.message_type())
+                {
+                    symbols.insert(std::make_pair(prefix + message.name(), i));
+                }
+                for(auto & enumType : file.enum_type())
+                {
+                    symbols.insert(std::make_pair(prefix + enumType.name(), i));
+                }
+                for(auto & service : file.service())
+                {
+                    symbols.insert(std::make_pair(prefix + service.name(), i));
+                }
+                for(auto & extension : file.extension())
+                {
+                    symbols.insert(std::make_pair(prefix + extension.name(), i));
+                }
+            }
+
+            uint32_t methodCount = 0;
+            for(auto & service : f_services)
+            {
+                methodCount += service.second.size();
+            }
+
+            memcpy(m_header.magic, s_snapshotMagic, sizeof(s_snapshotMagic));
+            m_header.byteOrderMark = s_byteOrderMark;
+            m_header.reserved = 0;
+            uint32_t offset = sizeof(SnapshotHeader);
+            m_header.files = {offset, uint32_t(f_files.size())};
+            offset += f_files.size() * sizeof(FileEntry);
+            m_header.symbols = {offset, uint32_t(symbols.size())};
+            offset += symbols.size() * sizeof(SymbolEntry);
+            m_header.services = {offset, uint32_t(f_services.size())};
+            offset += f_services.size() * sizeof(ServiceEntry);
+            m_header.methods = {offset, methodCount};
+            offset += methodCount * sizeof(SnapshotRef);
+            m_blobOffset = offset;
+
+            for(auto & file : f_files)
+            {
+                FileEntry entry;
+                entry.name = addToBlob(file.name());
+                entry.data = addToBlob(file.SerializeAsString());
+                m_files.push_back(entry);
+            }
+            for(auto & symbol : symbols)
+            {
+                SymbolEntry entry;
+                entry.name = addToBlob(symbol.first);
+                entry.fileIndex = symbol.second;
+                m_symbols.push_back(entry);
+            }
+            for(auto & service : f_services)
+            {
+                ServiceEntry entry;
+                entry.name = addToBlob(service.first);
+                entry.firstMethod = m_methods.size();
+                entry.methodCount = service.second.size();
+                m_services.push_back(entry);
+                for(auto & method : service.second)
+                {
+                    m_methods.push_back(addToBlob(method));
+                }
+            }
+        }
+
+        /// @returns false if the snapshot exceeds the 4GiB addressable by the format
+        bool isValid() const
+        {
+            return (uint64_t(m_blobOffset) + m_blob.size()) <= UINT32_MAX;
+        }
+
+        bool write(std::ostream & f_out) const
+        {
+            f_out.write(reinterpret_cast<const char *>(&m_header), sizeof(m_header));
+            f_out.write(reinterpret_cast<const char *>(m_files.data()), m_files.size() * sizeof(FileEntry));
+            f_out.write(reinterpret_cast<const char *>(m_symbols.data()), m_symbols.size() * sizeof(SymbolEntry));
+            f_out.write(reinterpret_cast<const char *>(m_services.data()), m_services.size() * sizeof(ServiceEntry));
+            f_out.write(reinterpret_cast<const char *>(m_methods.data()), m_methods.size() * sizeof(SnapshotRef));
+            f_out.write(m_blob.data(), m_blob.size());
+            return f_out.good();
+        }
+
+    private:
+        SnapshotRef addToBlob(const std::string & f_data)
+        {
+            SnapshotRef ref = {uint32_t(m_blobOffset + m_blob.size()), uint32_t(f_data.size())};
+            m_blob += f_data;
+            return ref;
+        }
+
+        SnapshotHeader m_header;
+        std::vector<FileEntry> m_files;
+        std::vector<SymbolEntry> m_symbols;
+        std::vector<ServiceEntry> m_services;
+        std::vector<SnapshotRef> m_methods;
+        uint32_t m_blobOffset;
+        std::string m_blob;
+};
+
+int writeSnapshot(ParsedElement & f_parseTree)
+{
+    std::string snapshotFile = f_parseTree.findFirstChild("WriteSnapshot");
+    std::shared_ptr<grpc::Channel> channel = createChannel(&f_parseTree);
+
+    std::unique_ptr<DescriptorSource> descSource = createDescriptorSource(&f_parseTree, channel);
+    if(descSource == nullptr)
+    {
+        return -1;
+    }
+
+    if(descSource->usesReflection() and not waitForChannelConnected(channel, getConnectTimeoutMs(&f_parseTree)))
+    {
+        std::cerr << "Error: channel connection attempt timed out" << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> serviceNames;
+    if(not descSource->getServices(serviceNames))
+    {
+        std::cerr << "Error: Cannot retrieve service list" << std::endl;
+        return -1;
+    }
+
+    grpc::protobuf::DescriptorPool descPool(&descSource->getDatabase());
+    std::set<std::string> knownFiles;
+    std::vector<grpc::protobuf::FileDescriptorProto> files;
+    std::map<std::string, std::vector<std::string> > services;
+    for(auto & serviceName : serviceNames)
+    {
+        const grpc::protobuf::ServiceDescriptor * service = descPool.FindServiceByName(serviceName);
+        if(service == nullptr)
+        {
+            std::cerr << "Warning: Service '" << serviceName << "' not found, skipping it" << std::endl;
+            continue;
+        }
+        addFileWithDependencies(service->file(), knownFiles, files);
+        std::vector<std::string> & methods = services[serviceName];
+        for(int i = 0; i < service->method_count(); ++i)
+        {
+            methods.push_back(service->method(i)->name());
+        }
+    }
+
+    SnapshotBuilder builder(files, services);
+    if(not builder.isValid())
+    {
+        std::cerr << "Error: Schema too large for a snapshot" << std::endl;
+        return -1;
+    }
+
+    // Write to a temporary file first, so concurrent readers never map a
+    // partially written snapshot:
+    std::string tmpFile = snapshotFile + ".tmp";
+    {
+        std::ofstream out(tmpFile, std::ios::binary | std::ios::trunc);
+        if( (not out.is_open()) or (not builder.write(out)) )
+        {
+            std::cerr << "Error: Cannot write '" << tmpFile << "'" << std::endl;
+            return -1;
+        }
+    }
+    if(std::rename(tmpFile.c_str(), snapshotFile.c_str()) != 0)
+    {
+        std::cerr << "Error: Cannot rename '" << tmpFile << "' to '" << snapshotFile << "'" << std::endl;
+        std::remove(tmpFile.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+}
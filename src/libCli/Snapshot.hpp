@@ -0,0 +1,45 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <libArgParse/ArgParse.hpp>
+#include <libCli/DescriptorSource.hpp>
+
+#include <memory>
+#include <string>
+
+namespace cli
+{
+    /// Writes a schema snapshot of all services (as given by the descriptor
+    /// source selected in the parse tree) to the file given with the
+    /// --writeSnapshot option.
+    /// A snapshot contains all files defining the services and their
+    /// dependencies, together with sorted index tables for files, top-level
+    /// symbols, services and methods. It can be loaded with loadSnapshot().
+    /// @param f_parseTree Parse tree containing server address and options
+    /// @returns 0 on success, -1 otherwise
+    int writeSnapshot(ArgParse::ParsedElement & f_parseTree);
+
+    /// Memory maps a schema snapshot written by writeSnapshot().
+    /// Only the fixed size header is validated on load. Services and methods
+    /// are listed directly from the index tables, files and symbols are
+    /// looked up via binary search and only files actually requested by a
+    /// DescriptorPool are deserialized. So load time does not depend on the
+    /// size of the schema.
+    /// Errors are printed to stderr.
+    /// @param f_fileName file to be loaded
+    /// @returns nullptr on error
+    std::unique_ptr<DescriptorSource> loadSnapshot(const std::string & f_fileName);
+}
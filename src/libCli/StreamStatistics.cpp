@@ -0,0 +1,243 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <libCli/StreamStatistics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace cli
+{
+
+Histogram::Histogram() :
+    m_sum(0),
+    m_max(0)
+{
+    for(std::atomic<uint64_t> & bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Histogram::getBucketIndex(uint64_t f_value)
+{
+    if(f_value < (1u << s_subBucketBits))
+    {
+        return f_value;
+    }
+    unsigned exponent = 63 - __builtin_clzll(f_value);
+    unsigned shift = exponent - s_subBucketBits;
+    size_t subBucket = (f_value >> shift) & ((1u << s_subBucketBits) - 1);
+    return ((shift + 1) << s_subBucketBits) + subBucket;
+}
+
+uint64_t Histogram::getBucketUpperBound(size_t f_index)
+{
+    if(f_index < (1u << s_subBucketBits))
+    {
+        return f_index;
+    }
+    unsigned shift = (f_index >> s_subBucketBits) - 1;
+    uint64_t subBucket = f_index & ((1u << s_subBucketBits) - 1);
+    uint64_t lower = ((uint64_t(1) << s_subBucketBits) + subBucket) << shift;
+    uint64_t width = uint64_t(1) << shift;
+    if(lower > std::numeric_limits<uint64_t>::max() - width)
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return lower + width - 1;
+}
+
+void Histogram::record(uint64_t f_value)
+{
+    m_buckets[getBucketIndex(f_value)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(f_value, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while( (f_value > max) and (not m_max.compare_exchange_weak(max, f_value, std::memory_order_relaxed)) )
+    {
+    }
+}
+
+Histogram::Snapshot Histogram::takeSnapshot(bool f_reset)
+{
+    Snapshot result;
+    // the count is the sum of the bucket counts:
+    for(size_t i = 0; i < m_buckets.size(); i++)
+    {
+        result.buckets[i] = f_reset ? m_buckets[i].exchange(0, std::memory_order_relaxed) : m_buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    if(f_reset)
+    {
+        result.sum = m_sum.exchange(0, std::memory_order_relaxed);
+        result.max = m_max.exchange(0, std::memory_order_relaxed);
+    }
+    else
+    {
+        result.sum = m_sum.load(std::memory_order_relaxed);
+        result.max = m_max.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void Histogram::Snapshot::merge(const Snapshot & f_other)
+{
+    count += f_other.count;
+    sum += f_other.sum;
+    max = std::max(max, f_other.max);
+    for(size_t i = 0; i < buckets.size(); i++)
+    {
+        buckets[i] += f_other.buckets[i];
+    }
+}
+
+uint64_t Histogram::Snapshot::getPercentile(double f_percentile) const
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(count * f_percentile / 100.0)));
+    uint64_t seen = 0;
+    for(size_t i = 0; i < buckets.size(); i++)
+    {
+        seen += buckets[i];
+        if(seen >= rank)
+        {
+            return std::min(getBucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+/// @returns human readable size, e.g. "1.5 KiB"
+static std::string formatBytes(double f_bytes)
+{
+    const char * units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    size_t unit = 0;
+    while( (f_bytes >= 1024) and (unit < 4) )
+    {
+        f_bytes /= 1024;
+        unit++;
+    }
+    char result[32];
+    snprintf(result, sizeof(result), (unit == 0) ? "%.0f %s" : "%.1f %s", f_bytes, units[unit]);
+    return result;
+}
+
+std::string formatNanoseconds(double f_ns)
+{
+    char result[32];
+    if(f_ns < 1e3)
+    {
+        snprintf(result, sizeof(result), "%.0f ns", f_ns);
+    }
+    else if(f_ns < 1e6)
+    {
+        snprintf(result, sizeof(result), "%.1f us", f_ns / 1e3);
+    }
+    else if(f_ns < 1e9)
+    {
+        snprintf(result, sizeof(result), "%.1f ms", f_ns / 1e6);
+    }
+    else
+    {
+        snprintf(result, sizeof(result), "%.2f s", f_ns / 1e9);
+    }
+    return result;
+}
+
+/// @returns rate with one decimal, e.g. "1234.5"
+static std::string formatRate(double f_count, double f_seconds)
+{
+    char result[32];
+    snprintf(result, sizeof(result), "%.1f", (f_seconds > 0) ? f_count / f_seconds : 0.0);
+    return result;
+}
+
+StreamStatistics::StreamStatistics() :
+    m_start(Clock::now()),
+    m_lastReport(m_start)
+{
+}
+
+void StreamStatistics::recordMessage(size_t f_size)
+{
+    Clock::time_point now = Clock::now();
+    m_sizes.record(f_size);
+    if(m_haveMessage)
+    {
+        m_interArrivalNs.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_lastMessage).count());
+    }
+    m_lastMessage = now;
+    m_haveMessage = true;
+}
+
+std::string StreamStatistics::getIntervalReport()
+{
+    Clock::time_point now = Clock::now();
+    double seconds = std::chrono::duration<double>(now - m_lastReport).count();
+    double sinceStart = std::chrono::duration<double>(now - m_start).count();
+    m_lastReport = now;
+
+    Histogram::Snapshot sizes = m_sizes.takeSnapshot(true);
+    Histogram::Snapshot interArrival = m_interArrivalNs.takeSnapshot(true);
+    m_totalSizes.merge(sizes);
+    m_totalInterArrivalNs.merge(interArrival);
+
+    char time[32];
+    snprintf(time, sizeof(time), "%8.1f s", sinceStart);
+    return std::string(time) + ": " + formatRate(sizes.count, seconds) + " msg/s, "
+        + formatBytes((seconds > 0) ? sizes.sum / seconds : 0) + "/s"
+        + ", size p50 " + formatBytes(sizes.getPercentile(50))
+        + " p99 " + formatBytes(sizes.getPercentile(99))
+        + " max " + formatBytes(sizes.max)
+        + ", inter-arrival p50 " + formatNanoseconds(interArrival.getPercentile(50))
+        + " p99 " + formatNanoseconds(interArrival.getPercentile(99))
+        + " max " + formatNanoseconds(interArrival.max)
+        + "\n";
+}
+
+std::string StreamStatistics::getSummary()
+{
+    // include messages recorded since the last report:
+    m_totalSizes.merge(m_sizes.takeSnapshot(true));
+    m_totalInterArrivalNs.merge(m_interArrivalNs.takeSnapshot(true));
+    double seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+
+    std::string result = "Received " + std::to_string(m_totalSizes.count) + " messages ("
+        + formatBytes(m_totalSizes.sum) + ") in " + formatNanoseconds(seconds * 1e9) + ": "
+        + formatRate(m_totalSizes.count, seconds) + " msg/s, "
+        + formatBytes((seconds > 0) ? m_totalSizes.sum / seconds : 0) + "/s\n";
+
+    const double percentiles[] = {50, 90, 99, 99.9};
+    std::string sizes = "Message size:  ";
+    std::string interArrival = "Inter-arrival: ";
+    for(double percentile : percentiles)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "p%g ", percentile);
+        sizes += name + formatBytes(m_totalSizes.getPercentile(percentile)) + ", ";
+        interArrival += name + formatNanoseconds(m_totalInterArrivalNs.getPercentile(percentile)) + ", ";
+    }
+    double meanSize = (m_totalSizes.count > 0) ? double(m_totalSizes.sum) / m_totalSizes.count : 0;
+    double meanInterArrival = (m_totalInterArrivalNs.count > 0) ? double(m_totalInterArrivalNs.sum) / m_totalInterArrivalNs.count : 0;
+    sizes += "max " + formatBytes(m_totalSizes.max) + ", mean " + formatBytes(meanSize) + "\n";
+    interArrival += "max " + formatNanoseconds(m_totalInterArrivalNs.max) + ", mean " + formatNanoseconds(meanInterArrival) + "\n";
+    return result + sizes + interArrival;
+}
+
+}
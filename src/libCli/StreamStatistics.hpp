@@ -0,0 +1,107 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace cli
+{
+    /// Histogram of non-negative integer values with log-linear buckets.
+    /// Each power of two range is divided into 8 buckets, so reported
+    /// percentiles deviate at most 12.5% from the exact value.
+    /// Recording is lock-free, so a reporting thread can take snapshots while
+    /// another thread records values.
+    class Histogram
+    {
+        public:
+            enum { s_subBucketBits = 3 };
+            enum { s_numberOfBuckets = (64 - s_subBucketBits + 1) << s_subBucketBits };
+
+            /// Histogram data at one point in time.
+            struct Snapshot
+            {
+                uint64_t count = 0;
+                uint64_t sum = 0;
+                uint64_t max = 0;
+                std::array<uint64_t, s_numberOfBuckets> buckets{};
+
+                /// Adds the values of another snapshot.
+                void merge(const Snapshot & f_other);
+
+                /// @param f_percentile percentile from 0 to 100
+                /// @returns upper bound of the bucket containing the percentile
+                uint64_t getPercentile(double f_percentile) const;
+            };
+
+            Histogram();
+
+            void record(uint64_t f_value);
+
+            /// @param f_reset if true, all values recorded so far are removed
+            ///        from the histogram
+            Snapshot takeSnapshot(bool f_reset);
+
+            static size_t getBucketIndex(uint64_t f_value);
+            static uint64_t getBucketUpperBound(size_t f_index);
+
+        private:
+            std::array<std::atomic<uint64_t>, s_numberOfBuckets> m_buckets;
+            std::atomic<uint64_t> m_sum;
+            std::atomic<uint64_t> m_max;
+    };
+
+    /// @returns human readable duration, e.g. "12.3 us"
+    std::string formatNanoseconds(double f_ns);
+
+    /// Collects rates, message sizes and inter-arrival times of a reply stream
+    /// (--stats). Messages are recorded by the receiving thread, reports are
+    /// generated by a reporting thread.
+    class StreamStatistics
+    {
+        public:
+            StreamStatistics();
+
+            /// Records a received message. Uses the monotonic clock.
+            /// @param f_size size of the serialized message in bytes
+            void recordMessage(size_t f_size);
+
+            /// @returns one line with rates and percentiles since the
+            ///          previous report (or since the start)
+            std::string getIntervalReport();
+
+            /// @returns a summary of all messages recorded
+            std::string getSummary();
+
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            Histogram m_sizes;
+            Histogram m_interArrivalNs;
+
+            Clock::time_point m_start;
+            Clock::time_point m_lastReport;
+            /// Reception time of the last message, only used by the receiving thread.
+            Clock::time_point m_lastMessage;
+            bool m_haveMessage = false;
+
+            /// All data up to the last report, only used by the reporting thread.
+            Histogram::Snapshot m_totalSizes;
+            Histogram::Snapshot m_totalInterArrivalNs;
+    };
+}
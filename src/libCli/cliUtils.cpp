@@ -1,14 +1,128 @@
 #include "libCli/cliUtils.hpp"
+#include "libCli/Proxy.hpp"
+#include "libCli/SessionCache.hpp"
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/impl/server_builder_option.h>
+
+#include <iostream>
+#include <stdexcept>
 
 namespace cli
 {
+    std::shared_ptr<grpc::Channel> createChannel(ArgParse::ParsedElement * f_parseTree)
+    {
+        std::string serverAddress = f_parseTree->findFirstChild("ServerAddress");
+        std::string serverPort = f_parseTree->findFirstChild("ServerPort");
+        if(serverPort == "")
+        {
+            serverPort = "50051";
+        }
+        serverAddress += ":" + serverPort;
+        return createChannel(serverAddress, f_parseTree);
+    }
+
+    /// Creates a channel to the target, via the proxy if a socket is given.
+    static std::shared_ptr<grpc::Channel> newChannel(const std::string & f_target, const std::string & f_proxySocket)
+    {
+        if(f_proxySocket != "")
+        {
+            // the proxy forwards all calls to the target given as authority:
+            grpc::ChannelArguments args;
+            args.SetString(GRPC_ARG_DEFAULT_AUTHORITY, f_target);
+            return grpc::CreateCustomChannel("unix:" + f_proxySocket, grpc::InsecureChannelCredentials(), args);
+        }
+        return grpc::CreateChannel(f_target, grpc::InsecureChannelCredentials());
+    }
+
+    std::shared_ptr<grpc::Channel> createChannel(const std::string & f_target, ArgParse::ParsedElement * f_parseTree)
+    {
+        std::string proxySocket;
+        if(f_parseTree->findFirstChild("NoProxy") == "")
+        {
+            proxySocket = getProxySocketPath();
+            if(not isProxyRunning(proxySocket))
+            {
+                proxySocket = "";
+            }
+        }
+        SessionCache * cache = SessionCache::getActive();
+        if(cache != nullptr)
+        {
+            return cache->getChannel(proxySocket + " " + f_target, [&]{ return newChannel(f_target, proxySocket); });
+        }
+        return newChannel(f_target, proxySocket);
+    }
+
     bool waitForChannelConnected(std::shared_ptr<grpc::Channel> f_channel, uint32_t f_timeoutMs)
     {
         gpr_timespec deadline = gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC), gpr_time_from_micros(f_timeoutMs*1000, GPR_TIMESPAN));
-        bool result = f_channel->WaitForConnected(deadline);
+
+        // Instead of waiting for READY until the deadline (as WaitForConnected
+        // does), we get notified about every state transition and return as soon
+        // as the outcome of the connection attempt is known:
+        grpc::CompletionQueue cq;
+        grpc_connectivity_state state = f_channel->GetState(true);
+        bool timedOut = false;
+        while( (state == GRPC_CHANNEL_IDLE) or (state == GRPC_CHANNEL_CONNECTING) )
+        {
+            f_channel->NotifyOnStateChange(state, deadline, &cq, nullptr);
+            void * tag;
+            bool ok;
+            cq.Next(&tag, &ok);
+            if(not ok)
+            {
+                timedOut = true;
+                break;
+            }
+            state = f_channel->GetState(true);
+        }
+        cq.Shutdown();
+        void * tag;
+        bool ok;
+        while(cq.Next(&tag, &ok))
+        {
+        }
+        return (not timedOut) and (state == GRPC_CHANNEL_READY);
+    }
+
+    std::vector<std::string> findAllOptionValues(ArgParse::ParsedElement * f_parseTree, const std::string & f_elementName)
+    {
+        std::vector<ArgParse::ParsedElement *> elements;
+        f_parseTree->findAllSubTrees(f_elementName, elements);
+        std::vector<std::string> result;
+        for(auto element : elements)
+        {
+            result.push_back(element->getMatchedString());
+        }
         return result;
     }
 
+    bool getNumericOption(ArgParse::ParsedElement * f_parseTree, const std::string & f_elementName, const std::string & f_optionName, uint64_t f_max, uint64_t & f_out_value)
+    {
+        std::string valueStr = f_parseTree->findFirstChild(f_elementName);
+        if(valueStr == "")
+        {
+            return true;
+        }
+        uint64_t value = 0;
+        bool inRange = true;
+        try
+        {
+            value = std::stoull(valueStr);
+        }
+        catch(std::out_of_range &)
+        {
+            inRange = false;
+        }
+        if( (not inRange) or (value > f_max) )
+        {
+            std::cerr << "Error: The value of " << f_optionName << " must not exceed " << f_max << std::endl;
+            return false;
+        }
+        f_out_value = value;
+        return true;
+    }
+
     uint32_t getConnectTimeoutMs(ArgParse::ParsedElement * f_parseTree, uint32_t f_default)
     {
         // TODO: it would be nice to encode default values for options in the grammar
@@ -21,4 +135,25 @@ namespace cli
         }
         return connectTimeoutMs;
     }
+
+    /// Removes all server builder plugins.
+    /// The reflection library linked into gWhisper registers a reflection
+    /// service plugin with every server.
+    class NoPluginsOption : public grpc::ServerBuilderOption
+    {
+        public:
+            virtual void UpdateArguments(grpc::ChannelArguments * f_args) override
+            {
+            }
+
+            virtual void UpdatePlugins(std::vector<std::unique_ptr<grpc::ServerBuilderPlugin>> * f_plugins) override
+            {
+                f_plugins->clear();
+            }
+    };
+
+    void disableServerPlugins(grpc::ServerBuilder & f_builder)
+    {
+        f_builder.SetOption(std::unique_ptr<grpc::ServerBuilderOption>(new NoPluginsOption()));
+    }
 }
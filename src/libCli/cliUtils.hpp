@@ -15,17 +15,66 @@
 #pragma once
 #include "libArgParse/ArgParse.hpp"
 #include <grpc++/channel.h>
+
+#include <string>
+#include <vector>
+
+namespace grpc
+{
+    class ServerBuilder;
+}
+
 namespace cli
 {
+    /// Creates a channel to the server given in the parse tree.
+    /// If a gWhisper proxy (see runProxy()) is running, the channel is routed
+    /// through the proxy, unless the "NoProxy" option is given.
+    /// Within a session (see SessionCache), channels are reused.
+    /// @param f_parseTree Parse-tree containing server address, port and options
+    /// @returns the channel (not necessarily connected yet)
+    std::shared_ptr<grpc::Channel> createChannel(ArgParse::ParsedElement * f_parseTree);
+
+    /// Creates a channel to the given target, routed through the proxy like
+    /// createChannel(ArgParse::ParsedElement*).
+    /// @param f_target target in "host:port" notation
+    /// @param f_parseTree Parse-tree containing the options
+    /// @returns the channel (not necessarily connected yet)
+    std::shared_ptr<grpc::Channel> createChannel(const std::string & f_target, ArgParse::ParsedElement * f_parseTree);
+
     /// Wait for a gRPC channel to go into connected state.
+    /// Returns as soon as the channel is connected or the connection attempt
+    /// failed (e.g. connection refused), without waiting for the timeout.
     /// @param f_channel the channel to be waited on
     /// @param f_timeoutMs Timeout in milliseconds
-    /// @returns true if channel is connected, false if timeout exceeded and channel is still not in connected state.
+    /// @returns true if channel is connected, false if connecting failed or timeout exceeded and channel is still not in connected state.
     bool waitForChannelConnected(std::shared_ptr<grpc::Channel> f_channel, uint32_t f_timeoutMs);
 
+    /// Retrieves the values of an option which may be given multiple times.
+    /// @param f_parseTree Parse-tree which should be searched for the option
+    /// @param f_elementName name of the element holding the option value
+    /// @returns matched strings of all elements with the given name in the parse tree
+    std::vector<std::string> findAllOptionValues(ArgParse::ParsedElement * f_parseTree, const std::string & f_elementName);
+
+    /// Retrieves the value of a numeric option (matched by "[0-9]+").
+    /// Prints an error if the value exceeds the given maximum.
+    /// @param f_parseTree Parse-tree which should be searched for the option
+    /// @param f_elementName name of the element holding the option value
+    /// @param f_optionName the option as typed by the user (e.g. "--parallel="), for the error message
+    /// @param f_max largest accepted value
+    /// @param f_out_value the value, unchanged if the option is not given
+    /// @returns false if the value is out of range
+    bool getNumericOption(ArgParse::ParsedElement * f_parseTree, const std::string & f_elementName, const std::string & f_optionName, uint64_t f_max, uint64_t & f_out_value);
+
     /// Retrieves the "connectTimeout" option from the parse tree
     /// @param f_parseTree Parse-tree which should be searched for the option
     /// @param f_default default value returned, if parse-tree did not contain the option.
     /// @returns the value as an integer
     uint32_t getConnectTimeoutMs(ArgParse::ParsedElement * f_parseTree, uint32_t f_default = 500);
+
+    /// Removes the server builder plugins registered by linked libraries
+    /// (e.g. the reflection service of the gRPC reflection library, which only
+    /// knows the descriptors compiled into gWhisper). Servers of gWhisper
+    /// answer reflection requests themselves or forward them.
+    /// @param f_builder builder of the server
+    void disableServerPlugins(grpc::ServerBuilder & f_builder);
 }
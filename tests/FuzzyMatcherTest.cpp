@@ -0,0 +1,96 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <libArgParse/FuzzyMatcher.hpp>
+using namespace ArgParse;
+
+TEST(FuzzyMatcherTest, EmptyQuery) {
+    FuzzyMatcher matcher({"Echo", "EchoTree"});
+
+    EXPECT_EQ(0, matcher.match("", 10).size());
+}
+
+TEST(FuzzyMatcherTest, NoSubsequence) {
+    FuzzyMatcher matcher({"Echo", "EchoTree", "StreamEcho"});
+
+    EXPECT_EQ(0, matcher.match("xyz", 10).size());
+    EXPECT_EQ(0, matcher.match("ohce", 10).size());
+    EXPECT_EQ(0, matcher.match("EchoTreeX", 10).size());
+}
+
+TEST(FuzzyMatcherTest, CaseInsensitive) {
+    FuzzyMatcher matcher({"RED", "GREEN", "BLUE"});
+
+    std::vector<size_t> result = matcher.match("gn", 10);
+
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(1, result[0]);
+}
+
+TEST(FuzzyMatcherTest, SegmentStartsAreRanked) {
+    FuzzyMatcher matcher({"examples.TestService", "examples.Tester", "examples.StreamingServer"});
+
+    std::vector<size_t> result = matcher.match("TstSvc", 10);
+
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(0, result[0]);
+
+    result = matcher.match("ss", 10);
+    ASSERT_EQ(3, result.size());
+    // both 's' of "StreamingServer" are segment starts, only one of "TestService":
+    EXPECT_EQ(2, result[0]);
+    EXPECT_EQ(0, result[1]);
+    EXPECT_EQ(1, result[2]);
+}
+
+TEST(FuzzyMatcherTest, LastSegmentIsPreferred) {
+    FuzzyMatcher matcher({"foo.bar.Other", "other.bar.Foo"});
+
+    std::vector<size_t> result = matcher.match("foo", 10);
+
+    ASSERT_EQ(2, result.size());
+    EXPECT_EQ(1, result[0]);
+    EXPECT_EQ(0, result[1]);
+}
+
+TEST(FuzzyMatcherTest, SegmentInitials) {
+    FuzzyMatcher matcher({"com.company.team.FooService", "com.company.FooService", "com.FooTeamService"});
+
+    std::vector<size_t> result = matcher.match("c.c.t.Foo", 10);
+
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(0, result[0]);
+}
+
+TEST(FuzzyMatcherTest, ShorterKeywordWinsTie) {
+    FuzzyMatcher matcher({"EchoTree", "Echo"});
+
+    std::vector<size_t> result = matcher.match("ech", 10);
+
+    ASSERT_EQ(2, result.size());
+    EXPECT_EQ(1, result[0]);
+    EXPECT_EQ(0, result[1]);
+}
+
+TEST(FuzzyMatcherTest, MaxResults) {
+    FuzzyMatcher matcher({"a1", "a2", "a3", "a4"});
+
+    std::vector<size_t> result = matcher.match("a", 2);
+
+    ASSERT_EQ(2, result.size());
+    EXPECT_EQ(0, result[0]);
+    EXPECT_EQ(1, result[1]);
+}
@@ -0,0 +1,89 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+
+#include <gtest/gtest.h>
+#include <libArgParse/ArgParse.hpp>
+using namespace ArgParse;
+
+/// Injects the fixed string "<key>!", where <key> is the word parsed before.
+class KeyedInjector : public GrammarInjector
+{
+    public:
+        KeyedInjector(Grammar & f_grammar) :
+            GrammarInjector("Keyed"),
+            m_grammar(f_grammar)
+        {
+        }
+
+        virtual GrammarElement * getGrammar(ParsedElement * f_parseTree) override
+        {
+            numberOfInjections++;
+            return m_grammar.createElement<FixedString>(f_parseTree->findFirstChild("Key") + "!");
+        }
+
+        virtual std::string getGrammarKey(ParsedElement * f_parseTree) override
+        {
+            return f_parseTree->findFirstChild("Key");
+        }
+
+        size_t numberOfInjections = 0;
+
+    private:
+        Grammar & m_grammar;
+};
+
+// Grammar used in the following tests:
+//  c1
+//      r1 "[a-z]+" (Key)
+//      w1
+//      i1 -> "<Key>!"
+class KeyedInjectionTest : public ::testing::Test
+{
+    protected:
+        KeyedInjectionTest() :
+            r1("[a-z]+", "Key"),
+            i1(grammar)
+        {
+            c1.addChild(&r1);
+            c1.addChild(&w1);
+            c1.addChild(&i1);
+        }
+
+        ParseRc parse(const std::string & f_string)
+        {
+            // the injector looks the key up from the root of the parse tree:
+            ParsedElement parseTree;
+            return c1.parse(f_string.c_str(), parseTree);
+        }
+
+        Grammar grammar;
+        Concatenation c1;
+        RegEx r1;
+        WhiteSpace w1;
+        KeyedInjector i1;
+};
+
+TEST_F(KeyedInjectionTest, InjectsOncePerKey) {
+    EXPECT_EQ(ParseRc::ErrorType::success, parse("abc abc!").errorType);
+    EXPECT_EQ(ParseRc::ErrorType::success, parse("xy xy!").errorType);
+    EXPECT_EQ(ParseRc::ErrorType::success, parse("abc abc!").errorType);
+    EXPECT_EQ(2, i1.numberOfInjections);
+}
+
+TEST_F(KeyedInjectionTest, GrammarOfOtherKeyDoesNotMatch) {
+    EXPECT_EQ(ParseRc::ErrorType::success, parse("abc abc!").errorType);
+    EXPECT_NE(ParseRc::ErrorType::success, parse("xy abc!").errorType);
+}
@@ -0,0 +1,205 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <libArgParse/ArgParse.hpp>
+#include <algorithm>
+using namespace ArgParse;
+
+TEST(KeywordSetTest, NoKeywords) {
+    KeywordSet k1(std::vector<std::string>{});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("asd", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+    EXPECT_EQ(0, rc.candidates.size());
+}
+
+TEST(KeywordSetTest, EmptyString) {
+    KeywordSet k1({"green", "blue", "red"});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+    ASSERT_EQ(3, rc.candidates.size());
+    EXPECT_EQ("blue", rc.candidates[0]->getMatchedString());
+    EXPECT_EQ("green", rc.candidates[1]->getMatchedString());
+    EXPECT_EQ("red", rc.candidates[2]->getMatchedString());
+    EXPECT_EQ(&k1, rc.candidates[0]->getGrammarElement());
+}
+
+TEST(KeywordSetTest, MatchingStringWithLongerCandidate) {
+    KeywordSet k1({"Echo", "EchoTree", "Other"});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("Echo", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(4, rc.lenParsedSuccessfully);
+    EXPECT_EQ("Echo", parsedElement.getMatchedString());
+    ASSERT_EQ(1, rc.candidates.size());
+    EXPECT_EQ("EchoTree", rc.candidates[0]->getMatchedString());
+}
+
+TEST(KeywordSetTest, LongestMatchWins) {
+    KeywordSet k1({"Echo", "EchoTree", "Other"});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("EchoTree rest", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(8, rc.lenParsedSuccessfully);
+    EXPECT_EQ("EchoTree", parsedElement.getMatchedString());
+    EXPECT_EQ(0, rc.candidates.size());
+}
+
+TEST(KeywordSetTest, NonMatchingString) {
+    KeywordSet k1({"Echo", "EchoTree", "Other"});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("Ea", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::unexpectedText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+    EXPECT_EQ(0, rc.candidates.size());
+}
+
+// KeywordSet must behave like an Alternation of FixedStrings
+TEST(KeywordSetTest, EquivalentToAlternation) {
+    std::vector<std::string> keywords = {"a", "ab", "abc", "abd", "b", "ba", "bcd", "x.y.Service", "x.y.ServiceB", "zzz"};
+    KeywordSet k1(keywords);
+    Alternation a1;
+    std::vector<std::unique_ptr<FixedString>> fixedStrings;
+    for(auto & keyword : keywords)
+    {
+        fixedStrings.emplace_back(new FixedString(keyword));
+        a1.addChild(fixedStrings.back().get());
+    }
+
+    std::vector<std::string> inputs = {"", "a", "ab", "abc", "abcd", "ab ", "abx", "b", "bc", "c", "x.", "x.y.Service", "x.y.ServiceBB", "zz", "zzzz", "zzzzzzzzzzzzzzzzzzzzzzzz"};
+    for(auto & input : inputs)
+    {
+        ParsedElement parentA;
+        ParsedElement parsedA(&parentA);
+        ParsedElement parentK;
+        ParsedElement parsedK(&parentK);
+        ParseRc rcA = a1.parse(input.c_str(), parsedA);
+        ParseRc rcK = k1.parse(input.c_str(), parsedK);
+
+        EXPECT_EQ(rcA.errorType, rcK.errorType) << "input: '" << input << "'";
+        EXPECT_EQ(rcA.lenParsed, rcK.lenParsed) << "input: '" << input << "'";
+        EXPECT_EQ(rcA.lenParsedSuccessfully, rcK.lenParsedSuccessfully) << "input: '" << input << "'";
+        EXPECT_EQ(parsedA.getMatchedString(), parsedK.getMatchedString()) << "input: '" << input << "'";
+
+        std::vector<std::string> candidatesA;
+        for(auto & candidate : rcA.candidates)
+        {
+            candidatesA.push_back(candidate->getMatchedString());
+        }
+        std::sort(candidatesA.begin(), candidatesA.end());
+        std::vector<std::string> candidatesK;
+        for(auto & candidate : rcK.candidates)
+        {
+            candidatesK.push_back(candidate->getMatchedString());
+        }
+        EXPECT_EQ(candidatesA, candidatesK) << "input: '" << input << "'";
+    }
+}
+
+TEST(KeywordSetTest, ManyKeywords) {
+    std::vector<std::string> keywords;
+    for(size_t i = 0; i < 100000; i++)
+    {
+        keywords.push_back("VALUE_" + std::to_string(i));
+    }
+    KeywordSet k1(keywords);
+
+    ParsedElement parsedElement;
+    ParseRc rc = k1.parse("VALUE_9999", parsedElement);
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(10, rc.lenParsedSuccessfully);
+    // VALUE_99990 .. VALUE_99999
+    EXPECT_EQ(10, rc.candidates.size());
+
+    ParsedElement parsedElement2;
+    rc = k1.parse("VALUE_12345 more", parsedElement2);
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ("VALUE_12345", parsedElement2.getMatchedString());
+}
+
+TEST(KeywordSetTest, FuzzyCompletionDisabledByDefault) {
+    KeywordSet k1({"examples.TestService", "examples.OtherService"});
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("TstSvc", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::unexpectedText, rc.errorType);
+    EXPECT_EQ(0, rc.candidates.size());
+}
+
+TEST(KeywordSetTest, FuzzyCompletion) {
+    KeywordSet k1({"examples.TestService", "examples.OtherService", "examples.Tester"});
+    k1.enableFuzzyCompletion();
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("TstSvc", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    EXPECT_EQ(6, rc.lenParsed);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+    ASSERT_EQ(1, rc.candidates.size());
+    EXPECT_EQ("examples.TestService", rc.candidates[0]->getMatchedString());
+    EXPECT_EQ(&k1, rc.candidates[0]->getGrammarElement());
+}
+
+TEST(KeywordSetTest, FuzzyCompletionOnlyWithoutPrefixCandidates) {
+    KeywordSet k1({"Echo", "EchoTree", "StreamEcho"});
+    k1.enableFuzzyCompletion();
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("Ech", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    ASSERT_EQ(2, rc.candidates.size());
+    EXPECT_EQ("Echo", rc.candidates[0]->getMatchedString());
+    EXPECT_EQ("EchoTree", rc.candidates[1]->getMatchedString());
+}
+
+TEST(KeywordSetTest, FuzzyCompletionOnlyAtEndOfInput) {
+    KeywordSet k1({"Echo", "EchoTree", "StreamEcho"});
+    k1.enableFuzzyCompletion();
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("tree ", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::unexpectedText, rc.errorType);
+    EXPECT_EQ(0, rc.candidates.size());
+}
+
+TEST(KeywordSetTest, FuzzyCompletionMaxCandidates) {
+    KeywordSet k1({"Echo", "EchoTree", "StreamEcho"});
+    k1.enableFuzzyCompletion(1);
+    ParsedElement parsedElement;
+
+    ParseRc rc = k1.parse("ho", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    ASSERT_EQ(1, rc.candidates.size());
+    EXPECT_EQ("Echo", rc.candidates[0]->getMatchedString());
+}
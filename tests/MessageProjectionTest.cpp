@@ -0,0 +1,209 @@
+// Copyright 2019 IBM Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <libCli/MessageProjection.hpp>
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/text_format.h>
+
+#include <memory>
+
+using namespace cli;
+
+// Message types used in the following tests (proto2):
+//  message Leaf { required int32 id = 1; optional string name = 2; optional int32 value = 3; }
+//  message Node {
+//      optional Leaf leaf = 1; repeated Leaf leaves = 2; optional string label = 3;
+//      optional Node child = 4; repeated int32 numbers = 5 [packed = true];
+//  }
+//  message Root { optional Node node = 1; repeated Node nodes = 2; optional int32 count = 3; optional string text = 4; }
+static const char * s_protoFile = R"(
+    name: "projection_test.proto"
+    package: "projectiontest"
+    syntax: "proto2"
+    message_type { name: "Leaf"
+        field { name: "id" number: 1 label: LABEL_REQUIRED type: TYPE_INT32 }
+        field { name: "name" number: 2 label: LABEL_OPTIONAL type: TYPE_STRING }
+        field { name: "value" number: 3 label: LABEL_OPTIONAL type: TYPE_INT32 } }
+    message_type { name: "Node"
+        field { name: "leaf" number: 1 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: ".projectiontest.Leaf" }
+        field { name: "leaves" number: 2 label: LABEL_REPEATED type: TYPE_MESSAGE type_name: ".projectiontest.Leaf" }
+        field { name: "label" number: 3 label: LABEL_OPTIONAL type: TYPE_STRING }
+        field { name: "child" number: 4 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: ".projectiontest.Node" }
+        field { name: "numbers" number: 5 label: LABEL_REPEATED type: TYPE_INT32 options { packed: true } } }
+    message_type { name: "Root"
+        field { name: "node" number: 1 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: ".projectiontest.Node" }
+        field { name: "nodes" number: 2 label: LABEL_REPEATED type: TYPE_MESSAGE type_name: ".projectiontest.Node" }
+        field { name: "count" number: 3 label: LABEL_OPTIONAL type: TYPE_INT32 }
+        field { name: "text" number: 4 label: LABEL_OPTIONAL type: TYPE_STRING } }
+)";
+
+static const char * s_rootText =
+    "node { leaf { id: 1 name: \"a\" value: 10 } leaves { id: 2 name: \"b\" } leaves { id: 3 value: 30 } "
+    "label: \"n\" child { label: \"c\" leaf { id: 4 name: \"d\" } numbers: 7 } numbers: 1 numbers: 2 } "
+    "nodes { label: \"x\" leaf { id: 5 } } nodes { label: \"y\" numbers: 3 } nodes { child { label: \"z\" } } "
+    "count: 42 text: \"t\"";
+
+class MessageProjectionTest : public ::testing::Test
+{
+    protected:
+        MessageProjectionTest() :
+            factory(&pool)
+        {
+            google::protobuf::FileDescriptorProto fileProto;
+            EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(s_protoFile, &fileProto));
+            EXPECT_NE(nullptr, pool.BuildFile(fileProto));
+            rootType = pool.FindMessageTypeByName("projectiontest.Root");
+            serializedRoot = newRoot(s_rootText)->SerializePartialAsString();
+        }
+
+        std::unique_ptr<google::protobuf::Message> newRoot(const std::string & f_text)
+        {
+            std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(rootType)->New());
+            google::protobuf::TextFormat::Parser parser;
+            parser.AllowPartialMessage(true);
+            EXPECT_TRUE(parser.ParseFromString(f_text, message.get())) << f_text;
+            return message;
+        }
+
+        /// Adds a field path like "node.leaf.name" to the projection.
+        void addField(MessageProjection & f_projection, const std::string & f_path)
+        {
+            std::vector<const google::protobuf::FieldDescriptor *> path;
+            const google::protobuf::Descriptor * type = rootType;
+            size_t nameStart = 0;
+            while(nameStart <= f_path.size())
+            {
+                size_t nameEnd = std::min(f_path.find('.', nameStart), f_path.size());
+                ASSERT_NE(nullptr, type) << f_path;
+                const google::protobuf::FieldDescriptor * field = type->FindFieldByName(f_path.substr(nameStart, nameEnd - nameStart));
+                ASSERT_NE(nullptr, field) << f_path;
+                path.push_back(field);
+                type = field->message_type();
+                nameStart = nameEnd + 1;
+            }
+            f_projection.addField(path);
+        }
+
+        /// Projects the serialized message and parses the result like
+        /// decodeReply() does.
+        /// @returns the projected message in text format
+        std::string project(const std::vector<std::string> & f_paths, const std::string & f_serialized)
+        {
+            MessageProjection projection;
+            for(const std::string & path : f_paths)
+            {
+                addField(projection, path);
+            }
+            std::string projected;
+            EXPECT_TRUE(projection.project(f_serialized, projected));
+            // required fields may have been projected away:
+            std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(rootType)->New());
+            EXPECT_TRUE(message->ParsePartialFromString(projected));
+            return message->ShortDebugString();
+        }
+
+        std::string project(const std::vector<std::string> & f_paths)
+        {
+            return project(f_paths, serializedRoot);
+        }
+
+        /// @returns a message in the same text format as project()
+        std::string expected(const std::string & f_text)
+        {
+            return newRoot(f_text)->ShortDebugString();
+        }
+
+        google::protobuf::DescriptorPool pool;
+        google::protobuf::DynamicMessageFactory factory;
+        const google::protobuf::Descriptor * rootType = nullptr;
+        std::string serializedRoot;
+};
+
+TEST_F(MessageProjectionTest, NoFields) {
+    EXPECT_EQ("", project({}));
+}
+
+TEST_F(MessageProjectionTest, TopLevelFields) {
+    EXPECT_EQ(expected("count: 42"), project({"count"}));
+    EXPECT_EQ(expected("count: 42 text: \"t\""), project({"text", "count"}));
+}
+
+TEST_F(MessageProjectionTest, NestedField) {
+    EXPECT_EQ(expected("node { leaf { name: \"a\" } }"), project({"node.leaf.name"}));
+    EXPECT_EQ(expected("node { label: \"n\" child { leaf { name: \"d\" } } }"), project({"node.child.leaf.name", "node.label"}));
+}
+
+TEST_F(MessageProjectionTest, CompleteSubmessage) {
+    EXPECT_EQ(expected("node { leaf { id: 1 name: \"a\" value: 10 } }"), project({"node.leaf"}));
+    EXPECT_EQ(expected("node { child { label: \"c\" leaf { id: 4 name: \"d\" } numbers: 7 } }"), project({"node.child"}));
+}
+
+TEST_F(MessageProjectionTest, ParentFieldIsNeededCompletely) {
+    std::string completeNode = expected("node { leaf { id: 1 name: \"a\" value: 10 } leaves { id: 2 name: \"b\" } leaves { id: 3 value: 30 } "
+        "label: \"n\" child { label: \"c\" leaf { id: 4 name: \"d\" } numbers: 7 } numbers: 1 numbers: 2 }");
+
+    EXPECT_EQ(completeNode, project({"node", "node.leaf.name"}));
+    EXPECT_EQ(completeNode, project({"node.leaf.name", "node"}));
+}
+
+TEST_F(MessageProjectionTest, RepeatedFields) {
+    // every element of repeated submessages is projected:
+    EXPECT_EQ(expected("nodes { label: \"x\" } nodes { label: \"y\" } nodes { }"), project({"nodes.label"}));
+    EXPECT_EQ(expected("node { leaves { } leaves { value: 30 } }"), project({"node.leaves.value"}));
+    EXPECT_EQ(expected("nodes { } nodes { } nodes { child { label: \"z\" } }"), project({"nodes.child.label"}));
+    // packed repeated scalars are copied as they are:
+    EXPECT_EQ(expected("node { numbers: 1 numbers: 2 }"), project({"node.numbers"}));
+}
+
+TEST_F(MessageProjectionTest, RequiredFieldsMayBeMissing) {
+    MessageProjection projection;
+    addField(projection, "node.leaf.name");
+    std::string projected;
+    ASSERT_TRUE(projection.project(serializedRoot, projected));
+
+    // Leaf.id is required, so only partial parsing (as in decodeReply())
+    // accepts the projection:
+    std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(rootType)->New());
+    EXPECT_FALSE(message->ParseFromString(projected));
+    message.reset(factory.GetPrototype(rootType)->New());
+    EXPECT_TRUE(message->ParsePartialFromString(projected));
+    EXPECT_FALSE(message->IsInitialized());
+    EXPECT_EQ(expected("node { leaf { name: \"a\" } }"), message->ShortDebugString());
+}
+
+TEST_F(MessageProjectionTest, RepeatedOccurrencesAreMerged) {
+    // a submessage may occur several times, the parser merges them:
+    std::string serialized = newRoot("node { label: \"first\" leaf { id: 1 name: \"a\" } }")->SerializePartialAsString()
+        + newRoot("node { leaf { value: 3 } } count: 1")->SerializePartialAsString();
+
+    EXPECT_EQ(expected("node { label: \"first\" leaf { value: 3 } }"), project({"node.label", "node.leaf.value"}, serialized));
+}
+
+TEST_F(MessageProjectionTest, MalformedMessage) {
+    MessageProjection projection;
+    addField(projection, "node.label");
+    std::string projected;
+
+    // truncated length delimited field:
+    EXPECT_FALSE(projection.project(serializedRoot.substr(0, serializedRoot.size() - 1), projected));
+    // malformed tags, also at the end:
+    EXPECT_FALSE(projection.project(std::string("\xff\xff\xff\xff\xff\xff", 6), projected));
+    EXPECT_FALSE(projection.project(serializedRoot + std::string("\x00", 1), projected));
+    // truncated submessage:
+    std::string node = newRoot("node { label: \"n\" }")->SerializePartialAsString();
+    EXPECT_FALSE(projection.project(node.substr(0, node.size() - 1), projected));
+}
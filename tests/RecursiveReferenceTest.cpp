@@ -0,0 +1,165 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <gtest/gtest.h>
+#include <libArgParse/ArgParse.hpp>
+
+#include <thread>
+
+using namespace ArgParse;
+
+// Grammar used in the following tests: nested parentheses
+//  a1
+//      f1 "x"
+//      c1
+//          f2 "("
+//          r1 -> a1
+//          f3 ")"
+class RecursiveReferenceTest : public ::testing::Test
+{
+    protected:
+        RecursiveReferenceTest() :
+            f1("x"),
+            f2("("),
+            f3(")"),
+            r1(&a1)
+        {
+            a1.addChild(&f1);
+            a1.addChild(&c1);
+            c1.addChild(&f2);
+            c1.addChild(&r1);
+            c1.addChild(&f3);
+        }
+
+        FixedString f1;
+        FixedString f2;
+        FixedString f3;
+        Alternation a1;
+        Concatenation c1;
+        RecursiveReference r1;
+};
+
+TEST_F(RecursiveReferenceTest, NestedMatch) {
+    ParsedElement parent;
+    ParsedElement parsedElement(&parent);
+
+    ParseRc rc = a1.parse("((x))", parsedElement);
+
+    // rc:
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(5, rc.lenParsedSuccessfully);
+
+    // candidates:
+    ASSERT_EQ(0, rc.candidates.size());
+
+    // parsedElement
+    EXPECT_EQ("((x))", parsedElement.getMatchedString());
+    EXPECT_EQ(&a1, parsedElement.getGrammarElement());
+}
+
+TEST_F(RecursiveReferenceTest, EmptyStringTerminates) {
+    ParsedElement parent;
+    ParsedElement parsedElement(&parent);
+
+    ParseRc rc = a1.parse("", parsedElement);
+
+    // rc:
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+
+    // candidates:
+    ASSERT_EQ(2, rc.candidates.size());
+    EXPECT_EQ("x", rc.candidates[0]->getMatchedString());
+    EXPECT_EQ("(", rc.candidates[1]->getMatchedString());
+    EXPECT_EQ(&parent, rc.candidates[0]->getParent());
+    EXPECT_EQ(&parent, rc.candidates[1]->getParent());
+}
+
+TEST_F(RecursiveReferenceTest, PartialNestedCompletion) {
+    ParsedElement parent;
+    ParsedElement parsedElement(&parent);
+
+    ParseRc rc = a1.parse("((", parsedElement);
+
+    // rc:
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+
+    // candidates:
+    ASSERT_EQ(2, rc.candidates.size());
+    EXPECT_EQ("((x)", rc.candidates[0]->getMatchedString());
+    EXPECT_EQ("(((", rc.candidates[1]->getMatchedString());
+
+    // parsedElement
+    EXPECT_EQ("((", parsedElement.getMatchedString());
+}
+
+TEST_F(RecursiveReferenceTest, DeepNesting) {
+    // this would take forever if nesting levels multiply parse time
+    const size_t depth = 200;
+    std::string input = std::string(depth, '(') + "x" + std::string(depth, ')');
+    ParsedElement parent;
+    ParsedElement parsedElement(&parent);
+
+    ParseRc rc = a1.parse(input.c_str(), parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(input.size(), rc.lenParsedSuccessfully);
+    EXPECT_EQ(input, parsedElement.getMatchedString());
+
+    // incomplete input still yields candidates:
+    input = std::string(depth, '(');
+    ParsedElement parsedElement2(&parent);
+    rc = a1.parse(input.c_str(), parsedElement2);
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    ASSERT_EQ(2, rc.candidates.size());
+    EXPECT_EQ(std::string(depth, '(') + "x)", rc.candidates[0]->getMatchedString());
+}
+
+TEST_F(RecursiveReferenceTest, ConcurrentParses) {
+    // the recursion guard belongs to each parse, not to the shared grammar:
+    std::vector<size_t> wrongResults(8, 0);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < wrongResults.size(); t++)
+    {
+        threads.emplace_back([this, t, &wrongResults]()
+        {
+            for(size_t i = 0; i < 200; i++)
+            {
+                ParsedElement parent;
+                ParsedElement parsedElement(&parent);
+                ParseRc rc = a1.parse((t % 2 == 0) ? "((" : "", parsedElement);
+                if(rc.candidates.size() != 2)
+                {
+                    wrongResults[t]++;
+                }
+            }
+        });
+    }
+    for(auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    for(size_t t = 0; t < wrongResults.size(); t++)
+    {
+        EXPECT_EQ(0, wrongResults[t]) << "thread " << t;
+    }
+}
+
+TEST_F(RecursiveReferenceTest, ToStringTerminates) {
+    std::string result = a1.toString();
+    EXPECT_NE(std::string::npos, result.find("x"));
+}
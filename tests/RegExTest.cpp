@@ -0,0 +1,96 @@
+// Copyright 2019 IBM Corporation
+// 
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// 
+//     http://www.apache.org/licenses/LICENSE-2.0
+// 
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <libArgParse/ArgParse.hpp>
+using namespace ArgParse;
+
+// -----------------------------------------------------------------------------
+//          RegEx
+// -----------------------------------------------------------------------------
+
+TEST(RegExTest, CharacterClassMatch) {
+    RegEx myRegEx("[^ ]+");
+    ParsedElement parsedElement;
+
+    ParseRc rc = myRegEx.parse("abc def", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(3, rc.lenParsedSuccessfully);
+    EXPECT_EQ("abc", parsedElement.getMatchedString());
+}
+
+TEST(RegExTest, CharacterClassNoMatch) {
+    RegEx myRegEx("[^ ]+");
+    ParsedElement parsedElement;
+
+    ParseRc rc = myRegEx.parse(" abc", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::unexpectedText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+}
+
+TEST(RegExTest, CharacterClassEmptyString) {
+    RegEx myRegEx("[^ ]+");
+    ParsedElement parsedElement;
+
+    ParseRc rc = myRegEx.parse("", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::missingText, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+}
+
+TEST(RegExTest, CharacterClassOptional) {
+    RegEx myRegEx("[0-9a-fA-F]*");
+    ParsedElement parsedElement;
+
+    ParseRc rc = myRegEx.parse("xyz", parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(0, rc.lenParsedSuccessfully);
+}
+
+TEST(RegExTest, CharacterClassLongInput) {
+    RegEx myRegEx("[0-9a-fA-F]*");
+    ParsedElement parsedElement;
+    std::string input(1000000, 'a');
+    input += " ";
+
+    ParseRc rc = myRegEx.parse(input.c_str(), parsedElement);
+
+    EXPECT_EQ(ParseRc::ErrorType::success, rc.errorType);
+    EXPECT_EQ(1000000, rc.lenParsedSuccessfully);
+}
+
+TEST(RegExTest, CharacterClassSameAsRegexEngine) {
+    // wrapping the bracket expression in a group bypasses the fast path:
+    std::vector<std::string> patterns = {"[^ ]+", "[0-9a-fA-F]*", "[^ ,:]+", "[A-Za-z0-9+/_=-]*", "[\\+-\\.pP0-9a-fA-F]+", "[^\\.:\\[\\] ]+", "[\\+-]+"};
+    std::vector<std::string> inputs = {"", " ", "abc", "ab c", "0x1F:", "+-,.p9", "a.b:c", "[::1]", "-+ 3", "QUJD==/_-x,y"};
+    for(auto & pattern : patterns)
+    {
+        RegEx fastRegEx(pattern);
+        RegEx engineRegEx("(?:" + pattern.substr(0, pattern.size()-1) + ")" + pattern.back());
+        for(auto & input : inputs)
+        {
+            ParsedElement fastElement;
+            ParsedElement engineElement;
+            ParseRc fastRc = fastRegEx.parse(input.c_str(), fastElement);
+            ParseRc engineRc = engineRegEx.parse(input.c_str(), engineElement);
+
+            EXPECT_EQ(engineRc.errorType, fastRc.errorType) << pattern << " on '" << input << "'";
+            EXPECT_EQ(engineRc.lenParsedSuccessfully, fastRc.lenParsedSuccessfully) << pattern << " on '" << input << "'";
+            EXPECT_EQ(engineElement.getMatchedString(), fastElement.getMatchedString()) << pattern << " on '" << input << "'";
+        }
+    }
+}
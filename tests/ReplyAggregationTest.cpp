@@ -0,0 +1,194 @@
+// Copyright 2019 IBM Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <libCli/GrammarConstruction.hpp>
+#include <libCli/ReplyAggregation.hpp>
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/text_format.h>
+
+#include <memory>
+#include <sstream>
+
+using namespace ArgParse;
+using namespace cli;
+
+// Message types used in the following tests (proto3):
+//  enum Color { RED = 0; GREEN = 1; BLUE = 2; }
+//  message Reply {
+//      int32 i32 = 1; int64 i64 = 2; uint64 u64 = 3; double d = 4;
+//      string label = 5; Color color = 6; bool flag = 7; repeated int32 numbers = 8;
+//  }
+static const char * s_protoFile = R"(
+    name: "aggregation_test.proto"
+    package: "aggregationtest"
+    syntax: "proto3"
+    enum_type { name: "Color"
+        value { name: "RED" number: 0 }
+        value { name: "GREEN" number: 1 }
+        value { name: "BLUE" number: 2 } }
+    message_type { name: "Reply"
+        field { name: "i32" number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 }
+        field { name: "i64" number: 2 label: LABEL_OPTIONAL type: TYPE_INT64 }
+        field { name: "u64" number: 3 label: LABEL_OPTIONAL type: TYPE_UINT64 }
+        field { name: "d" number: 4 label: LABEL_OPTIONAL type: TYPE_DOUBLE }
+        field { name: "label" number: 5 label: LABEL_OPTIONAL type: TYPE_STRING }
+        field { name: "color" number: 6 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: ".aggregationtest.Color" }
+        field { name: "flag" number: 7 label: LABEL_OPTIONAL type: TYPE_BOOL }
+        field { name: "numbers" number: 8 label: LABEL_REPEATED type: TYPE_INT32 } }
+)";
+
+class ReplyAggregationTest : public ::testing::Test
+{
+    protected:
+        ReplyAggregationTest() :
+            factory(&pool)
+        {
+            google::protobuf::FileDescriptorProto fileProto;
+            EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(s_protoFile, &fileProto));
+            EXPECT_NE(nullptr, pool.BuildFile(fileProto));
+            replyType = pool.FindMessageTypeByName("aggregationtest.Reply");
+        }
+
+        /// Aggregates replies given in text format with the --aggregate
+        /// grammar.
+        /// @returns the cells of the table, one vector per row, including the
+        ///          header row
+        std::vector<std::vector<std::string>> aggregate(const std::string & f_expression, const std::vector<std::string> & f_replies)
+        {
+            Grammar grammar;
+            GrammarElement * root = constructAggregationGrammar(grammar);
+            ParsedElement parseTree;
+            ParseRc rc = root->parse(f_expression.c_str(), parseTree);
+            EXPECT_TRUE(rc.isGood()) << rc.toString();
+            EXPECT_EQ(f_expression.size(), rc.lenParsedSuccessfully);
+
+            ReplyAggregation aggregation;
+            std::string error;
+            EXPECT_TRUE(aggregation.compile(parseTree, replyType, error)) << error;
+            for(const std::string & reply : f_replies)
+            {
+                std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(replyType)->New());
+                EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(reply, message.get())) << reply;
+                aggregation.add(*message);
+            }
+
+            // none of the cells in these tests contain spaces:
+            std::vector<std::vector<std::string>> rows;
+            std::istringstream table(aggregation.getTable());
+            std::string line;
+            while(std::getline(table, line))
+            {
+                rows.emplace_back();
+                std::istringstream cells(line);
+                std::string cell;
+                while(cells >> cell)
+                {
+                    rows.back().push_back(cell);
+                }
+            }
+            return rows;
+        }
+
+        /// @returns column f_column of all rows after the header
+        static std::vector<std::string> column(const std::vector<std::vector<std::string>> & f_rows, size_t f_column)
+        {
+            std::vector<std::string> result;
+            for(size_t i = 1; i < f_rows.size(); i++)
+            {
+                result.push_back(f_rows[i].at(f_column));
+            }
+            return result;
+        }
+
+        google::protobuf::DescriptorPool pool;
+        google::protobuf::DynamicMessageFactory factory;
+        const google::protobuf::Descriptor * replyType = nullptr;
+};
+
+TEST_F(ReplyAggregationTest, NumericGroupsAreSortedByValue) {
+    std::vector<std::string> replies = {"i32: 10", "i32: 9", "i32: -1", "i32: 100", "i32: 9"};
+    auto rows = aggregate("count() by i32", replies);
+    EXPECT_EQ(std::vector<std::string>({"-1", "9", "10", "100"}), column(rows, 0));
+    EXPECT_EQ(std::vector<std::string>({"1", "2", "1", "1"}), column(rows, 1));
+
+    rows = aggregate("count() by d", {"d: 10", "d: 2.5", "d: -0.5", "d: 100"});
+    EXPECT_EQ(std::vector<std::string>({"-0.5", "2.5", "10", "100"}), column(rows, 0));
+
+    rows = aggregate("count() by u64", {"u64: 18446744073709551615", "u64: 18446744073709551614", "u64: 2"});
+    EXPECT_EQ(std::vector<std::string>({"2", "18446744073709551614", "18446744073709551615"}), column(rows, 0));
+}
+
+TEST_F(ReplyAggregationTest, EnumGroupsAreSortedByNumber) {
+    auto rows = aggregate("count() by color", {"color: BLUE", "color: RED", "color: GREEN"});
+    EXPECT_EQ(std::vector<std::string>({"RED", "GREEN", "BLUE"}), column(rows, 0));
+
+    rows = aggregate("count() by flag", {"flag: true", "flag: false"});
+    EXPECT_EQ(std::vector<std::string>({"false", "true"}), column(rows, 0));
+}
+
+TEST_F(ReplyAggregationTest, TextGroupsAreSortedAsText) {
+    auto rows = aggregate("count() by label", {"label: \"9\"", "label: \"10\"", "label: \"b\"", "label: \"a\""});
+    EXPECT_EQ(std::vector<std::string>({"10", "9", "a", "b"}), column(rows, 0));
+}
+
+TEST_F(ReplyAggregationTest, SeveralGroupFields) {
+    auto rows = aggregate("count() by label, i32", {
+            "label: \"b\" i32: 1", "label: \"a\" i32: 10", "label: \"a\" i32: 9", "label: \"b\" i32: 1"});
+    ASSERT_EQ(4u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"label", "i32", "count()"}), rows[0]);
+    EXPECT_EQ(std::vector<std::string>({"a", "9", "1"}), rows[1]);
+    EXPECT_EQ(std::vector<std::string>({"a", "10", "1"}), rows[2]);
+    EXPECT_EQ(std::vector<std::string>({"b", "1", "2"}), rows[3]);
+}
+
+TEST_F(ReplyAggregationTest, IntegerAggregatesAreExact) {
+    // 2^53 + 1 can not be represented as double:
+    auto rows = aggregate("sum(u64), min(u64), max(u64)", {"u64: 9007199254740993", "u64: 1", "u64: 0"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"9007199254740994", "0", "9007199254740993"}), rows[1]);
+
+    rows = aggregate("sum(i64), min(i64), max(i64)", {"i64: -9007199254740993", "i64: -2", "i64: 4"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"-9007199254740991", "-9007199254740993", "4"}), rows[1]);
+}
+
+TEST_F(ReplyAggregationTest, Overflow) {
+    auto rows = aggregate("sum(u64), avg(u64), max(u64), count(u64)", {"u64: 18446744073709551615", "u64: 1"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"overflow", "overflow", "18446744073709551615", "2"}), rows[1]);
+
+    rows = aggregate("sum(i64), min(i64)", {"i64: -9223372036854775808", "i64: -1"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"overflow", "-9223372036854775808"}), rows[1]);
+}
+
+TEST_F(ReplyAggregationTest, FloatAndAverage) {
+    auto rows = aggregate("sum(d), min(d), max(d), avg(i32)", {"d: 0.5 i32: 1", "d: -1.25 i32: 2"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"-0.75", "-1.25", "0.5", "1.5"}), rows[1]);
+}
+
+TEST_F(ReplyAggregationTest, NoValues) {
+    // a repeated field may have no elements:
+    auto rows = aggregate("sum(numbers), min(numbers), avg(numbers), count(numbers)", {"i32: 1"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"0", "-", "-", "0"}), rows[1]);
+
+    rows = aggregate("sum(numbers), min(numbers), max(numbers)", {"numbers: 3 numbers: -4", "numbers: 5"});
+    ASSERT_EQ(2u, rows.size());
+    EXPECT_EQ(std::vector<std::string>({"4", "-4", "5"}), rows[1]);
+}
@@ -0,0 +1,352 @@
+// Copyright 2019 IBM Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <libCli/GrammarConstruction.hpp>
+#include <libCli/ReplyFilter.hpp>
+
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/text_format.h>
+
+#include <memory>
+
+using namespace ArgParse;
+using namespace cli;
+
+// Message types used in the following tests:
+//  proto3:
+//      enum Color { RED = 0; GREEN = 1; BLUE = 2; }
+//      message Inner { int32 x = 1; string name = 2; Inner child = 3; }
+//      message Reply {
+//          int32 i32 = 1; sint64 s64 = 2; uint32 u32 = 3; fixed64 f64 = 4;
+//          bool flag = 5; float f = 6; double d = 7; string label = 8;
+//          bytes data = 9; Color color = 10; Inner inner = 11;
+//          repeated Inner items = 12; repeated int32 numbers = 13;
+//          oneof choice { int32 choice_a = 14; string choice_b = 15; }
+//      }
+//  proto2:
+//      enum Level { LOW = 1; HIGH = 2; }
+//      message Legacy {
+//          optional Level level = 1 [default = HIGH];
+//          optional int32 count = 2 [default = 7];
+//      }
+static const char * s_proto3File = R"(
+    name: "filter_test.proto"
+    package: "filtertest"
+    syntax: "proto3"
+    enum_type { name: "Color"
+        value { name: "RED" number: 0 }
+        value { name: "GREEN" number: 1 }
+        value { name: "BLUE" number: 2 } }
+    message_type { name: "Inner"
+        field { name: "x" number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 }
+        field { name: "name" number: 2 label: LABEL_OPTIONAL type: TYPE_STRING }
+        field { name: "child" number: 3 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: ".filtertest.Inner" } }
+    message_type { name: "Reply"
+        field { name: "i32" number: 1 label: LABEL_OPTIONAL type: TYPE_INT32 }
+        field { name: "s64" number: 2 label: LABEL_OPTIONAL type: TYPE_SINT64 }
+        field { name: "u32" number: 3 label: LABEL_OPTIONAL type: TYPE_UINT32 }
+        field { name: "f64" number: 4 label: LABEL_OPTIONAL type: TYPE_FIXED64 }
+        field { name: "flag" number: 5 label: LABEL_OPTIONAL type: TYPE_BOOL }
+        field { name: "f" number: 6 label: LABEL_OPTIONAL type: TYPE_FLOAT }
+        field { name: "d" number: 7 label: LABEL_OPTIONAL type: TYPE_DOUBLE }
+        field { name: "label" number: 8 label: LABEL_OPTIONAL type: TYPE_STRING }
+        field { name: "data" number: 9 label: LABEL_OPTIONAL type: TYPE_BYTES }
+        field { name: "color" number: 10 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: ".filtertest.Color" }
+        field { name: "inner" number: 11 label: LABEL_OPTIONAL type: TYPE_MESSAGE type_name: ".filtertest.Inner" }
+        field { name: "items" number: 12 label: LABEL_REPEATED type: TYPE_MESSAGE type_name: ".filtertest.Inner" }
+        field { name: "numbers" number: 13 label: LABEL_REPEATED type: TYPE_INT32 }
+        field { name: "choice_a" number: 14 label: LABEL_OPTIONAL type: TYPE_INT32 oneof_index: 0 }
+        field { name: "choice_b" number: 15 label: LABEL_OPTIONAL type: TYPE_STRING oneof_index: 0 }
+        oneof_decl { name: "choice" } }
+)";
+
+static const char * s_proto2File = R"(
+    name: "filter_test_legacy.proto"
+    package: "filtertest"
+    syntax: "proto2"
+    enum_type { name: "Level"
+        value { name: "LOW" number: 1 }
+        value { name: "HIGH" number: 2 } }
+    message_type { name: "Legacy"
+        field { name: "level" number: 1 label: LABEL_OPTIONAL type: TYPE_ENUM type_name: ".filtertest.Level" default_value: "HIGH" }
+        field { name: "count" number: 2 label: LABEL_OPTIONAL type: TYPE_INT32 default_value: "7" } }
+)";
+
+class ReplyFilterTest : public ::testing::Test
+{
+    protected:
+        ReplyFilterTest() :
+            factory(&pool)
+        {
+            for(const char * file : {s_proto3File, s_proto2File})
+            {
+                google::protobuf::FileDescriptorProto fileProto;
+                EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(file, &fileProto));
+                EXPECT_NE(nullptr, pool.BuildFile(fileProto));
+            }
+            replyType = pool.FindMessageTypeByName("filtertest.Reply");
+            legacyType = pool.FindMessageTypeByName("filtertest.Legacy");
+        }
+
+        /// @returns a new message of the given type, set from text format
+        std::unique_ptr<google::protobuf::Message> newMessage(const google::protobuf::Descriptor * f_type, const std::string & f_text)
+        {
+            std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(f_type)->New());
+            EXPECT_TRUE(google::protobuf::TextFormat::ParseFromString(f_text, message.get())) << f_text;
+            return message;
+        }
+
+        /// Compiles a filter expression with the --filter grammar.
+        /// @returns false if the expression does not fit the message type
+        bool compile(ReplyFilter & f_filter, const std::string & f_expression, const google::protobuf::Descriptor * f_type)
+        {
+            Grammar grammar;
+            GrammarElement * root = constructFilterGrammar(grammar);
+            ParsedElement parseTree;
+            ParseRc rc = root->parse(f_expression.c_str(), parseTree);
+            EXPECT_TRUE(rc.isGood()) << rc.toString();
+            EXPECT_EQ(f_expression.size(), rc.lenParsedSuccessfully);
+            std::string error;
+            return f_filter.compile(parseTree, f_type, error);
+        }
+
+        struct Result
+        {
+            bool matches;
+            bool rejectsSerialized;
+        };
+
+        /// Evaluates a filter with both evaluators: on the wire format and
+        /// on the decoded message.
+        Result evaluate(const std::string & f_expression, const google::protobuf::Descriptor * f_type, const std::string & f_serialized)
+        {
+            ReplyFilter filter;
+            EXPECT_TRUE(compile(filter, f_expression, f_type)) << f_expression;
+            std::unique_ptr<google::protobuf::Message> message(factory.GetPrototype(f_type)->New());
+            EXPECT_TRUE(message->ParseFromString(f_serialized));
+            Result result;
+            result.matches = filter.matches(*message);
+            result.rejectsSerialized = filter.rejectsSerialized(f_serialized);
+            return result;
+        }
+
+        /// Expects both evaluators to decide the same on a filter
+        /// referencing only top-level scalar fields.
+        void expectMatch(bool f_expectedMatch, const std::string & f_expression, const google::protobuf::Descriptor * f_type, const std::string & f_serialized)
+        {
+            Result result = evaluate(f_expression, f_type, f_serialized);
+            EXPECT_EQ(f_expectedMatch, result.matches) << f_expression;
+            EXPECT_EQ(not f_expectedMatch, result.rejectsSerialized) << f_expression;
+        }
+
+        void expectMatch(bool f_expectedMatch, const std::string & f_expression, const std::string & f_replyText)
+        {
+            expectMatch(f_expectedMatch, f_expression, replyType, newMessage(replyType, f_replyText)->SerializeAsString());
+        }
+
+        google::protobuf::DescriptorPool pool;
+        google::protobuf::DynamicMessageFactory factory;
+        const google::protobuf::Descriptor * replyType = nullptr;
+        const google::protobuf::Descriptor * legacyType = nullptr;
+};
+
+TEST_F(ReplyFilterTest, Operators) {
+    const std::string reply = "i32: 5";
+
+    expectMatch(true, "i32 == 5", reply);
+    expectMatch(false, "i32 == 4", reply);
+    expectMatch(true, "i32 != 4", reply);
+    expectMatch(false, "i32 != 5", reply);
+    expectMatch(true, "i32 < 6", reply);
+    expectMatch(false, "i32 < 5", reply);
+    expectMatch(true, "i32 <= 5", reply);
+    expectMatch(false, "i32 <= 4", reply);
+    expectMatch(true, "i32 > 4", reply);
+    expectMatch(false, "i32 > 5", reply);
+    expectMatch(true, "i32 >= 5", reply);
+    expectMatch(false, "i32 >= 6", reply);
+}
+
+TEST_F(ReplyFilterTest, ScalarTypes) {
+    const std::string reply = "i32: -3 s64: -5000000000 u32: 4000000000 f64: 18446744073709551615 "
+        "flag: true f: 0.1 d: 2.5 label: \"foo bar\" data: \"\\001\\002\"";
+
+    expectMatch(true, "i32 == -3", reply);
+    expectMatch(true, "i32 < 0", reply);
+    expectMatch(true, "s64 == -5000000000", reply);
+    expectMatch(true, "s64 < -4999999999", reply);
+    expectMatch(true, "u32 == 4000000000", reply);
+    expectMatch(true, "u32 > 3999999999", reply);
+    expectMatch(true, "f64 == 0xffffffffffffffff", reply);
+    expectMatch(true, "flag == true", reply);
+    expectMatch(false, "flag == false", reply);
+    // the float field is compared with the value as stored in a float:
+    expectMatch(true, "f == 0.1", reply);
+    expectMatch(true, "d > 2.4", reply);
+    expectMatch(true, "label == \"foo bar\"", reply);
+    expectMatch(true, "label > foo", reply);
+    expectMatch(false, "data == \"\"", reply);
+}
+
+TEST_F(ReplyFilterTest, EnumValues) {
+    const std::string reply = "color: BLUE";
+
+    expectMatch(true, "color == BLUE", reply);
+    expectMatch(true, "color == 2", reply);
+    expectMatch(true, "color > GREEN", reply);
+    expectMatch(false, "color == RED", reply);
+
+    // unknown values of open enums are kept:
+    std::string serialized = newMessage(replyType, "")->SerializeAsString() + std::string("\x50\x07", 2);
+    expectMatch(true, "color == 7", replyType, serialized);
+}
+
+TEST_F(ReplyFilterTest, MissingFieldsHaveDefaultValues) {
+    const std::string reply = "label: \"x\"";
+
+    expectMatch(true, "i32 == 0", reply);
+    expectMatch(true, "flag == false", reply);
+    expectMatch(true, "d == 0", reply);
+    expectMatch(true, "color == RED", reply);
+    expectMatch(true, "data == \"\"", reply);
+    expectMatch(false, "label == \"\"", reply);
+
+    // proto2 fields may have other default values:
+    std::string legacy = newMessage(legacyType, "")->SerializeAsString();
+    expectMatch(true, "count == 7", legacyType, legacy);
+    expectMatch(true, "level == HIGH", legacyType, legacy);
+}
+
+TEST_F(ReplyFilterTest, UnknownClosedEnumValue) {
+    // decoding keeps unknown values of proto2 enums as unknown fields, so the
+    // field keeps its default or previous value:
+    std::string unknownValue("\x08\x05", 2);
+    expectMatch(true, "level == HIGH", legacyType, unknownValue);
+    expectMatch(false, "level == 5", legacyType, unknownValue);
+
+    std::string lowThenUnknown = newMessage(legacyType, "level: LOW")->SerializeAsString() + unknownValue;
+    expectMatch(true, "level == LOW", legacyType, lowThenUnknown);
+    expectMatch(true, "level == LOW && level != HIGH", legacyType, lowThenUnknown);
+}
+
+TEST_F(ReplyFilterTest, LastOccurrenceWins) {
+    // concatenated messages are merged, scalar fields are overwritten:
+    std::string serialized = newMessage(replyType, "i32: 1 label: \"a\"")->SerializeAsString()
+        + newMessage(replyType, "i32: 2")->SerializeAsString();
+
+    expectMatch(true, "i32 == 2", replyType, serialized);
+    expectMatch(false, "i32 == 1", replyType, serialized);
+    expectMatch(true, "label == a && i32 > 1", replyType, serialized);
+}
+
+TEST_F(ReplyFilterTest, AndBindsStrongerThanOr) {
+    const std::string reply = "i32: 1 u32: 2 label: \"x\"";
+
+    expectMatch(true, "i32 == 1 && u32 == 2", reply);
+    expectMatch(false, "i32 == 1 && u32 == 3", reply);
+    expectMatch(true, "i32 == 9 || u32 == 2", reply);
+    expectMatch(true, "i32 == 9 && u32 == 9 || label == x", reply);
+    expectMatch(false, "i32 == 9 && label == x || u32 == 9", reply);
+    expectMatch(true, "i32 == 9 || u32 == 9 || i32 == 1 && label == x", reply);
+    // several conditions on the same field:
+    expectMatch(true, "i32 > 0 && i32 < 2", reply);
+    expectMatch(false, "i32 > 1 || i32 < 1", reply);
+}
+
+TEST_F(ReplyFilterTest, OtherFieldsAreSkipped) {
+    // repeated, nested and length delimited fields not referenced by the
+    // filter are skipped in the wire format:
+    const std::string reply = "inner { x: 3 name: \"n\" } items { x: 1 } items { x: 2 } "
+        "numbers: 1 numbers: 2 label: \"after\" i32: 42";
+
+    expectMatch(true, "i32 == 42 && label == after", reply);
+    expectMatch(false, "i32 == 41", reply);
+}
+
+TEST_F(ReplyFilterTest, NestedFieldsAreEvaluatedDecoded) {
+    std::string serialized = newMessage(replyType, "inner { x: 3 child { name: \"deep\" } } i32: 1")->SerializeAsString();
+
+    // nested fields cannot be evaluated on the wire format, which never
+    // rejects:
+    Result result = evaluate("inner.x == 3", replyType, serialized);
+    EXPECT_TRUE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+
+    result = evaluate("inner.x == 4", replyType, serialized);
+    EXPECT_FALSE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+
+    result = evaluate("inner.child.name == deep && i32 == 1", replyType, serialized);
+    EXPECT_TRUE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+
+    // unset submessages have default values:
+    result = evaluate("inner.child.child.x == 0", replyType, serialized);
+    EXPECT_TRUE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+}
+
+TEST_F(ReplyFilterTest, OneofFieldsAreEvaluatedDecoded) {
+    std::string serialized = newMessage(replyType, "choice_b: \"b\"")->SerializeAsString();
+
+    Result result = evaluate("choice_b == b", replyType, serialized);
+    EXPECT_TRUE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+
+    result = evaluate("choice_a == 1", replyType, serialized);
+    EXPECT_FALSE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+}
+
+TEST_F(ReplyFilterTest, WrongWireTypeIsEvaluatedDecoded) {
+    // i32 encoded as fixed32 is an unknown field when decoded:
+    std::string serialized("\x0d\x05\x00\x00\x00", 5);
+
+    Result result = evaluate("i32 == 5", replyType, serialized);
+    EXPECT_FALSE(result.matches);
+    EXPECT_FALSE(result.rejectsSerialized);
+}
+
+TEST_F(ReplyFilterTest, InvalidExpressions) {
+    ReplyFilter filter;
+
+    EXPECT_FALSE(compile(filter, "unknown == 1", replyType));
+    EXPECT_FALSE(compile(filter, "items.x == 1", replyType));
+    EXPECT_FALSE(compile(filter, "numbers == 1", replyType));
+    EXPECT_FALSE(compile(filter, "inner == 1", replyType));
+    EXPECT_FALSE(compile(filter, "i32.x == 1", replyType));
+    EXPECT_FALSE(compile(filter, "i32 == abc", replyType));
+    EXPECT_FALSE(compile(filter, "u32 == -1", replyType));
+    EXPECT_FALSE(compile(filter, "flag == 1", replyType));
+    EXPECT_FALSE(compile(filter, "color == PURPLE", replyType));
+    EXPECT_FALSE(compile(filter, "d == 1.5x", replyType));
+    EXPECT_TRUE(compile(filter, "inner.name == x", replyType));
+}
+
+TEST_F(ReplyFilterTest, FieldPaths) {
+    ReplyFilter filter;
+    ASSERT_TRUE(compile(filter, "i32 == 1 || inner.child.x == 2", replyType));
+
+    auto paths = filter.getFieldPaths();
+
+    ASSERT_EQ(2, paths.size());
+    ASSERT_EQ(1, paths[0].size());
+    EXPECT_EQ("i32", paths[0][0]->name());
+    ASSERT_EQ(3, paths[1].size());
+    EXPECT_EQ("inner", paths[1][0]->name());
+    EXPECT_EQ("child", paths[1][1]->name());
+    EXPECT_EQ("x", paths[1][2]->name());
+}
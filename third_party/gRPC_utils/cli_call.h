@@ -82,6 +82,18 @@ class CliCall final {
   // Finish the RPC.
   Status Finish(IncomingMetadataContainer* server_trailing_metadata);
 
+  // MODIFIED by IBM
+  // Cancels the RPC. Thread-safe, may be called while another thread is
+  // blocked in Read().
+  void TryCancel() { ctx_.TryCancel(); }
+
+  // Initial metadata of the server. Available after a successful Read() or
+  // after Finish().
+  const IncomingMetadataContainer& GetServerInitialMetadata() {
+    return ctx_.GetServerInitialMetadata();
+  }
+  // END MODIFIED
+
  private:
   std::unique_ptr<grpc::GenericStub> stub_;
   grpc::ClientContext ctx_;
@@ -22,6 +22,9 @@
 // END MODIFIED
 
 #include <vector>
+// MODIFIED by IBM
+#include <thread>
+// END MODIFIED
 
 #include <grpc/support/log.h>
 
@@ -79,7 +82,12 @@ bool ProtoReflectionDescriptorDatabase::FindFileByName(
 
   if (response.message_response_case() ==
       ServerReflectionResponse::MessageResponseCase::kFileDescriptorResponse) {
-    AddFileFromResponse(response.file_descriptor_response());
+    // MODIFIED by IBM
+    // original: AddFileFromResponse(response.file_descriptor_response());
+    std::vector<string> added_files;
+    AddFileFromResponse(response.file_descriptor_response(), &added_files);
+    PrefetchDependencies(added_files);
+    // END MODIFIED
   } else if (response.message_response_case() ==
              ServerReflectionResponse::MessageResponseCase::kErrorResponse) {
     const ErrorResponse error = response.error_response();
@@ -126,7 +134,12 @@ bool ProtoReflectionDescriptorDatabase::FindFileContainingSymbol(
 
   if (response.message_response_case() ==
       ServerReflectionResponse::MessageResponseCase::kFileDescriptorResponse) {
-    AddFileFromResponse(response.file_descriptor_response());
+    // MODIFIED by IBM
+    // original: AddFileFromResponse(response.file_descriptor_response());
+    std::vector<string> added_files;
+    AddFileFromResponse(response.file_descriptor_response(), &added_files);
+    PrefetchDependencies(added_files);
+    // END MODIFIED
   } else if (response.message_response_case() ==
              ServerReflectionResponse::MessageResponseCase::kErrorResponse) {
     const ErrorResponse error = response.error_response();
@@ -298,17 +311,120 @@ ProtoReflectionDescriptorDatabase::ParseFileDescriptorProtoResponse(
   return file_desc_proto;
 }
 
+// MODIFIED by IBM
+// original: void ProtoReflectionDescriptorDatabase::AddFileFromResponse(
+//     const grpc::reflection::v1alpha::FileDescriptorResponse& response) {
 void ProtoReflectionDescriptorDatabase::AddFileFromResponse(
-    const grpc::reflection::v1alpha::FileDescriptorResponse& response) {
+    const grpc::reflection::v1alpha::FileDescriptorResponse& response,
+    std::vector<string>* added_files) {
+// END MODIFIED
   for (int i = 0; i < response.file_descriptor_proto_size(); ++i) {
     const protobuf::FileDescriptorProto file_proto =
         ParseFileDescriptorProtoResponse(response.file_descriptor_proto(i));
     if (known_files_.find(file_proto.name()) == known_files_.end()) {
       known_files_.insert(file_proto.name());
       cached_db_.Add(file_proto);
+      // MODIFIED by IBM
+      if (added_files != nullptr) {
+        added_files->push_back(file_proto.name());
+      }
+      // END MODIFIED
+    }
+  }
+}
+
+// MODIFIED by IBM
+void ProtoReflectionDescriptorDatabase::PrefetchDependencies(
+    const std::vector<string>& filenames) {
+  std::vector<string> added_files = filenames;
+  while (!added_files.empty()) {
+    // The frontier consists of all imports of the files added in the last
+    // round, which are not known yet:
+    std::vector<string> frontier;
+    std::unordered_set<string> requested;
+    for (const string& filename : added_files) {
+      protobuf::FileDescriptorProto file_proto;
+      if (!cached_db_.FindFileByName(filename, &file_proto)) {
+        continue;
+      }
+      for (const string& dependency : file_proto.dependency()) {
+        if (known_files_.find(dependency) == known_files_.end() &&
+            requested.insert(dependency).second) {
+          frontier.push_back(dependency);
+        }
+      }
+    }
+    added_files.clear();
+    if (frontier.empty()) {
+      return;
+    }
+
+    std::vector<ServerReflectionRequest> requests(frontier.size());
+    for (size_t i = 0; i < frontier.size(); ++i) {
+      requests[i].set_file_by_filename(frontier[i]);
     }
+    std::vector<ServerReflectionResponse> responses;
+    if (!DoPipelinedRequests(requests, responses)) {
+      // remaining files are still fetched lazily on lookup
+      return;
+    }
+
+    for (size_t i = 0; i < responses.size(); ++i) {
+      if (responses[i].message_response_case() ==
+          ServerReflectionResponse::MessageResponseCase::
+              kFileDescriptorResponse) {
+        AddFileFromResponse(responses[i].file_descriptor_response(),
+                            &added_files);
+      } else if (responses[i].message_response_case() ==
+                 ServerReflectionResponse::MessageResponseCase::
+                     kErrorResponse &&
+                 responses[i].error_response().error_code() ==
+                     StatusCode::NOT_FOUND) {
+        // Do not ask again on lookup. FindFileByName() still returns false,
+        // as the file is not part of cached_db_.
+        known_files_.insert(frontier[i]);
+        gpr_log(GPR_INFO, "NOT_FOUND from server for dependency %s",
+                frontier[i].c_str());
+      }
+    }
+  }
+}
+
+bool ProtoReflectionDescriptorDatabase::DoPipelinedRequests(
+    const std::vector<ServerReflectionRequest>& requests,
+    std::vector<ServerReflectionResponse>& responses) {
+  responses.resize(requests.size());
+  if (requests.size() == 1) {
+    return DoOneRequest(requests[0], responses[0]);
   }
+
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  const std::shared_ptr<ClientStream> stream = GetStream();
+
+  // Requests are written from a separate thread: If we only started reading
+  // after all writes, the server could block on flow control of unread
+  // responses while we are blocked writing requests.
+  bool write_ok = true;
+  std::thread writer([&stream, &requests, &write_ok]() {
+    for (const ServerReflectionRequest& request : requests) {
+      if (!stream->Write(request)) {
+        write_ok = false;
+        return;
+      }
+    }
+  });
+
+  bool read_ok = true;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    if (!stream->Read(&responses[i])) {
+      read_ok = false;
+      break;
+    }
+  }
+  writer.join();
+  return write_ok && read_ok;
 }
+// END MODIFIED
 
 const std::shared_ptr<ProtoReflectionDescriptorDatabase::ClientStream>
 ProtoReflectionDescriptorDatabase::GetStream() {
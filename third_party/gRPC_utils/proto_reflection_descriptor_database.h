@@ -88,8 +88,28 @@ class ProtoReflectionDescriptorDatabase : public protobuf::DescriptorDatabase {
   const protobuf::FileDescriptorProto ParseFileDescriptorProtoResponse(
       const grpc::string& byte_fd_proto);
 
+  // MODIFIED by IBM
+  // original: void AddFileFromResponse(
+  //     const grpc::reflection::v1alpha::FileDescriptorResponse& response);
+  // Names of files not known before are appended to added_files, if given.
   void AddFileFromResponse(
-      const grpc::reflection::v1alpha::FileDescriptorResponse& response);
+      const grpc::reflection::v1alpha::FileDescriptorResponse& response,
+      std::vector<string>* added_files = nullptr);
+
+  // Fetches all not yet known transitive dependencies of the given files.
+  // All files of one dependency level are requested at once, without waiting
+  // for responses in between, so the number of round trips is bounded by the
+  // depth of the import graph instead of the number of files.
+  void PrefetchDependencies(const std::vector<string>& filenames);
+
+  // Sends all requests on the stream before/while reading the responses.
+  // Responses are returned in request order.
+  bool DoPipelinedRequests(
+      const std::vector<grpc::reflection::v1alpha::ServerReflectionRequest>&
+          requests,
+      std::vector<grpc::reflection::v1alpha::ServerReflectionResponse>&
+          responses);
+  // END MODIFIED
 
   const std::shared_ptr<ClientStream> GetStream();
 